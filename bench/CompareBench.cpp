@@ -0,0 +1,132 @@
+// Compare kernel benchmark: times FindFirstMismatch's SSE2 and AVX2 kernels
+// against memcmp on equal buffers of several sizes, and checks the offset
+// each kernel finds against a byte-by-byte reference on generated
+// mismatches (every length and alignment near the vector widths, and random
+// ones).
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run CompareBench [seed]. Exits with 1
+// if a kernel disagrees with the reference.
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "FileVerify.h"
+
+static const double GB = 1024.0 * 1024.0 * 1024.0;
+
+// Buffer sizes timed: in L1, in L2, in L3, out of cache
+static const size_t SIZES[] = { 4 * 1024, 64 * 1024, 1024 * 1024, 64 * 1024 * 1024 };
+static const size_t BYTES_PER_SIZE = 4ull * 1024 * 1024 * 1024;    // compared per kernel and size
+
+static const size_t RANDOM_CHECKS = 200000;
+
+typedef size_t (*KernelFn)(const void* a, const void* b, size_t length);
+
+static size_t Reference(const void* a, const void* b, size_t length) {
+    const unsigned char* pa = static_cast<const unsigned char*>(a);
+    const unsigned char* pb = static_cast<const unsigned char*>(b);
+    for (size_t i = 0; i < length; i++) {
+        if (pa[i] != pb[i]) return i;
+    }
+    return length;
+}
+
+// memcmp only says whether (and which way) the buffers differ; timed as the
+// floor a kernel that also finds the offset is measured against
+static size_t Memcmp(const void* a, const void* b, size_t length) {
+    return memcmp(a, b, length) == 0 ? length : 0;
+}
+
+// GB/s comparing equal buffers of size bytes (the whole length is scanned)
+static double Time(KernelFn kernel, const unsigned char* a, const unsigned char* b, size_t size) {
+    size_t rounds = BYTES_PER_SIZE / size;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) sink += kernel(a, b, size);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sink != rounds * size) wprintf(L"  (buffers compared unequal)\n");
+    return seconds > 0 ? rounds * size / GB / seconds : 0;
+}
+
+// Mismatches checked where kernel and Reference disagree
+static size_t Check(KernelFn kernel, std::mt19937_64& rng, size_t& checked) {
+    const size_t AREA = 4096;
+    std::vector<unsigned char> a(AREA + 64), b(AREA + 64);
+    for (auto& byte : a) byte = static_cast<unsigned char>(rng());
+    size_t failures = 0;
+
+    b = a;
+    auto one = [&](size_t start, size_t length, size_t at, bool differ) {
+        differ = differ && at < length;
+        if (differ) b[start + at] ^= static_cast<unsigned char>(1 + rng() % 255);
+        checked++;
+        if (kernel(a.data() + start, b.data() + start, length) !=
+            Reference(a.data() + start, b.data() + start, length)) {
+            failures++;
+        }
+        if (differ) b[start + at] = a[start + at];
+    };
+
+    // Every alignment, every length up to a few vector widths, every position
+    for (size_t start = 0; start < 64; start++) {
+        for (size_t length = 0; length <= 160; length++) {
+            one(start, length, 0, false);
+            for (size_t at = 0; at < length; at++) one(start, length, at, true);
+        }
+    }
+
+    // Random lengths, alignments and positions over the larger area
+    for (size_t k = 0; k < RANDOM_CHECKS; k++) {
+        size_t start = rng() % 64;
+        size_t length = rng() % (AREA + 1);
+        size_t at = length ? rng() % length : 0;
+        one(start, length, at, rng() % 8 != 0);
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    std::mt19937_64 rng(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1);
+
+    struct Kernel {
+        const wchar_t* name;
+        KernelFn fn;
+        bool timeOnly;
+    };
+    std::vector<Kernel> kernels = {
+        { L"memcmp", Memcmp, true },
+        { L"SSE2", FindFirstMismatchSse2, false },
+    };
+    if (CpuHasAvx2()) {
+        kernels.push_back({ L"AVX2", FindFirstMismatchAvx2, false });
+    } else {
+        wprintf(L"No AVX2 on this CPU/OS; timing SSE2 only\n");
+    }
+
+    size_t failures = 0;
+    for (const Kernel& kernel : kernels) {
+        if (kernel.timeOnly) continue;
+        size_t checked = 0;
+        size_t failed = Check(kernel.fn, rng, checked);
+        wprintf(L"%-6ls %zu offsets checked against the reference, %zu wrong\n", kernel.name, checked, failed);
+        failures += failed;
+    }
+
+    size_t largest = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+    std::vector<unsigned char> a(largest), b(largest);
+    for (auto& byte : a) byte = static_cast<unsigned char>(rng());
+    b = a;
+
+    wprintf(L"\n  GB/s, equal buffers\n  %-10ls", L"Size");
+    for (const Kernel& kernel : kernels) wprintf(L" %9ls", kernel.name);
+    wprintf(L"\n");
+    for (size_t size : SIZES) {
+        wprintf(L"  %7zu KB", size / 1024);
+        for (const Kernel& kernel : kernels) wprintf(L" %9.1f", Time(kernel.fn, a.data(), b.data(), size));
+        wprintf(L"\n");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+// Copy engine benchmark: copies one large file with every queue depth x
+// chunk size in a sweep, and with the old scheme (two 16 MB buffers, one
+// read and one write in flight), and reports MB/s for each.
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run
+// CopyBench <source folder> <destination folder> [file MB].
+// Point the folders at the drives to measure; the source file is written
+// once and read unbuffered, so the cache doesn't flatter later runs.
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "CopyEngine.h"
+#include "BufferPool.h"
+
+static const double MB = 1024.0 * 1024.0;
+
+static const DWORD QUEUE_DEPTHS[] = { 1, 2, 4, 8, 16, 32 };
+static const DWORD CHUNK_SIZES[] = { 256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024 };
+
+// The copy before CopyEngine: two 16 MB buffers, a read of one overlapping
+// the write of the other
+static const DWORD OLD_CHUNK_SIZE = 16 * 1024 * 1024;
+
+static bool DoubleBufferCopy(const std::wstring& src, const std::wstring& dst, uint64_t fileSize) {
+    void* buffers[2];
+    buffers[0] = VirtualAlloc(nullptr, OLD_CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    buffers[1] = VirtualAlloc(nullptr, OLD_CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+    HANDLE hSrc = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr);
+    HANDLE hDst = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr);
+
+    bool ok = buffers[0] && buffers[1] && hSrc != INVALID_HANDLE_VALUE && hDst != INVALID_HANDLE_VALUE;
+    if (ok) {
+        LARGE_INTEGER preSize;
+        preSize.QuadPart = static_cast<LONGLONG>((fileSize + CopyEngine::SECTOR_ALIGN - 1) &
+                                                 ~(static_cast<uint64_t>(CopyEngine::SECTOR_ALIGN) - 1));
+        SetFilePointerEx(hDst, preSize, nullptr, FILE_BEGIN);
+        SetEndOfFile(hDst);
+    }
+
+    OVERLAPPED ovRead = {}, ovWrite = {};
+    ovRead.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    ovWrite.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+    uint64_t readPos = 0;
+    uint64_t writePos = 0;
+    int curBuf = 0;
+    bool writePending = false;
+    while (ok && readPos < fileSize) {
+        ovRead.Offset = static_cast<DWORD>(readPos);
+        ovRead.OffsetHigh = static_cast<DWORD>(readPos >> 32);
+        ResetEvent(ovRead.hEvent);
+        if (!ReadFile(hSrc, buffers[curBuf], OLD_CHUNK_SIZE, nullptr, &ovRead) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            ok = false;
+            break;
+        }
+
+        DWORD bytes;
+        if (writePending) {
+            ok = GetOverlappedResult(hDst, &ovWrite, &bytes, TRUE) != FALSE;
+            writePending = false;
+        }
+        if (!GetOverlappedResult(hSrc, &ovRead, &bytes, TRUE) || bytes == 0) {
+            ok = false;
+            break;
+        }
+        if (!ok) break;
+        readPos += bytes;
+
+        DWORD writeSize = (bytes + CopyEngine::SECTOR_ALIGN - 1) & ~(CopyEngine::SECTOR_ALIGN - 1);
+        memset(static_cast<char*>(buffers[curBuf]) + bytes, 0, writeSize - bytes);
+        ovWrite.Offset = static_cast<DWORD>(writePos);
+        ovWrite.OffsetHigh = static_cast<DWORD>(writePos >> 32);
+        ResetEvent(ovWrite.hEvent);
+        if (!WriteFile(hDst, buffers[curBuf], writeSize, nullptr, &ovWrite) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            ok = false;
+            break;
+        }
+        writePending = true;
+        writePos += writeSize;
+        curBuf = 1 - curBuf;
+    }
+    if (writePending) {
+        DWORD bytes;
+        ok = GetOverlappedResult(hDst, &ovWrite, &bytes, TRUE) && ok;
+    }
+
+    CloseHandle(ovRead.hEvent);
+    CloseHandle(ovWrite.hEvent);
+    if (hSrc != INVALID_HANDLE_VALUE) CloseHandle(hSrc);
+    if (hDst != INVALID_HANDLE_VALUE) CloseHandle(hDst);
+    if (buffers[0]) VirtualFree(buffers[0], 0, MEM_RELEASE);
+    if (buffers[1]) VirtualFree(buffers[1], 0, MEM_RELEASE);
+    return ok;
+}
+
+// Write fileSize bytes of non-repeating data to path, through to the disk
+static bool WriteSource(const std::wstring& path, uint64_t fileSize) {
+    HANDLE hFile = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_FLAG_WRITE_THROUGH, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    std::vector<uint64_t> block(OLD_CHUNK_SIZE / sizeof(uint64_t));
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    bool ok = true;
+    for (uint64_t written = 0; ok && written < fileSize; written += OLD_CHUNK_SIZE) {
+        for (auto& word : block) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            word = state;
+        }
+        DWORD size = static_cast<DWORD>(fileSize - written < OLD_CHUNK_SIZE ? fileSize - written : OLD_CHUNK_SIZE);
+        DWORD done = 0;
+        ok = WriteFile(hFile, block.data(), size, &done, nullptr) && done == size;
+    }
+    CloseHandle(hFile);
+    return ok;
+}
+
+// MB/s of one copy of src to dst (deleted afterwards); 0 if it failed
+template <typename CopyFn>
+static double TimeCopy(const std::wstring& dst, uint64_t fileSize, CopyFn copy) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = copy();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    DeleteFileW(dst.c_str());
+    return ok && seconds > 0 ? fileSize / MB / seconds : 0;
+}
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 3) {
+        wprintf(L"usage: CopyBench <source folder> <destination folder> [file MB]\n");
+        return 1;
+    }
+    uint64_t fileSize = static_cast<uint64_t>((argc > 3 ? std::wcstoull(argv[3], nullptr, 10) : 2048) * MB);
+    std::wstring src = std::wstring(argv[1]) + L"\\CopyBench.src";
+    std::wstring dst = std::wstring(argv[2]) + L"\\CopyBench.dst";
+
+    wprintf(L"Writing a %.0f MB source file...\n", fileSize / MB);
+    if (!WriteSource(src, fileSize)) {
+        wprintf(L"Can't write %ls (error %lu)\n", src.c_str(), GetLastError());
+        return 1;
+    }
+
+    // Room for the deepest queue of the largest chunks
+    BufferPool::Instance().SetBudget(1024ull * 1024 * 1024);
+
+    double old = TimeCopy(dst, fileSize, [&] { return DoubleBufferCopy(src, dst, fileSize); });
+    wprintf(L"\nOld double buffer (2 x 16 MB): %.0f MB/s\n\n", old);
+
+    wprintf(L"CopyEngine, MB/s (share of old) by queue depth and chunk size\n");
+    wprintf(L"  %-8ls", L"Depth");
+    for (DWORD chunk : CHUNK_SIZES) wprintf(L" %11.2f MB", chunk / MB);
+    wprintf(L"\n");
+    for (DWORD depth : QUEUE_DEPTHS) {
+        wprintf(L"  %-8lu", depth);
+        for (DWORD chunk : CHUNK_SIZES) {
+            CopyEngineOptions options;
+            options.queueDepth = depth;
+            options.chunkSize = chunk;
+            CopyEngine engine(options);
+            double rate = TimeCopy(dst, fileSize, [&] {
+                return engine.Copy(src, dst, fileSize, nullptr, nullptr, nullptr);
+            });
+            wprintf(L" %7.0f (%3.0f%%)", rate, old > 0 ? 100.0 * rate / old : 0);
+        }
+        wprintf(L"\n");
+    }
+
+    DeleteFileW(src.c_str());
+    return 0;
+}
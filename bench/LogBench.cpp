@@ -0,0 +1,101 @@
+// Transfer log benchmark: times a million AddEntry calls (new paths, then
+// the same paths again), Contains lookups, and the same adds with the
+// journal open, followed by Compact and a Load of the result.
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run LogBench <work folder> [entries].
+// The journal and catalog are written as <work folder>\LogBench.* and
+// deleted afterwards.
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "TransferLog.h"
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Report(const wchar_t* what, size_t count, double seconds) {
+    wprintf(L"  %-34ls %10.3f s %14.0f /s\n", what, seconds, seconds > 0 ? count / seconds : 0.0);
+}
+
+// Paths as a photo library lays them out: year, event, file
+static std::vector<std::wstring> GeneratePaths(size_t count) {
+    std::vector<std::wstring> paths;
+    paths.reserve(count);
+    wchar_t buf[96];
+    for (size_t k = 0; k < count; k++) {
+        swprintf_s(buf, L"Photos\\%zu\\Event %04zu\\IMG_%06zu.jpg", 2000 + k / 100000, k / 250, k);
+        paths.push_back(buf);
+    }
+    return paths;
+}
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 2) {
+        wprintf(L"usage: LogBench <work folder> [entries]\n");
+        return 1;
+    }
+    size_t count = argc > 2 ? std::wcstoul(argv[2], nullptr, 10) : 1000000;
+    std::wstring logPath = std::wstring(argv[1]) + L"\\LogBench.json";
+    std::vector<std::wstring> paths = GeneratePaths(count);
+    const std::wstring serial = TransferLog::FormatSerial(0x1234ABCD);
+
+    wprintf(L"%zu entries\n\n", count);
+
+    {
+        TransferLog log;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < count; k++) log.AddEntry(paths[k], serial, k, k * 31, k);
+        Report(L"AddEntry, new paths", count, Seconds(start));
+
+        start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < count; k++) log.AddEntry(paths[k], serial, k + 1, k * 37, k);
+        Report(L"AddEntry, same paths again", count, Seconds(start));
+
+        start = std::chrono::steady_clock::now();
+        size_t found = 0;
+        for (size_t k = 0; k < count; k++) found += log.Contains(paths[k]);
+        Report(L"Contains", count, Seconds(start));
+        if (found != count || log.GetEntryCount() != count) {
+            wprintf(L"  entries lost: %zu found, %zu counted\n", found, log.GetEntryCount());
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    {
+        TransferLog log;
+        if (!log.OpenJournal(logPath)) {
+            wprintf(L"Can't open the journal for %ls (error %lu)\n", logPath.c_str(), GetLastError());
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < count; k++) log.AddEntry(paths[k], serial, k, k * 31, k);
+        log.FlushJournal();
+        Report(L"AddEntry, journal open (+ flush)", count, Seconds(start));
+        log.CloseJournal();
+
+        start = std::chrono::steady_clock::now();
+        ok = log.Compact(logPath);
+        Report(L"Compact", count, Seconds(start));
+    }
+    if (ok) {
+        TransferLog log;
+        auto start = std::chrono::steady_clock::now();
+        log.Load(logPath);
+        Report(L"Load (catalog)", count, Seconds(start));
+        ok = log.GetEntryCount() == count;
+    }
+
+    DeleteFileW(TransferLog::GetJournalPath(logPath).c_str());
+    DeleteFileW(TransferLog::GetCatalogPath(logPath).c_str());
+    if (!ok) {
+        wprintf(L"  compacting or loading lost entries\n");
+        return 1;
+    }
+    return 0;
+}
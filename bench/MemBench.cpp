@@ -0,0 +1,112 @@
+// Path memory benchmark: interns a generated deep file tree in a PathStore
+// and a NodeTable and reports the bytes each holds per path, against a map
+// keyed by full relative path strings (how paths were kept before).
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run MemBench [million paths].
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "PathStore.h"
+#include "NodeTable.h"
+
+// Folders under each folder, by depth; the deepest folders hold the files
+static const size_t FOLDER_FANOUT[] = { 4, 6, 6, 6, 6 };
+static const int FOLDER_DEPTH = 5;
+
+// Heap bytes the old string-keyed map holds, counted by its allocator
+static size_t g_mapBytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+    typedef T value_type;
+    CountingAllocator() = default;
+    template <typename U> CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(size_t n) {
+        g_mapBytes += n * sizeof(T);
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        g_mapBytes -= n * sizeof(T);
+        ::operator delete(p);
+    }
+    template <typename U> bool operator==(const CountingAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+typedef std::basic_string<wchar_t, std::char_traits<wchar_t>, CountingAllocator<wchar_t>> CountedPath;
+
+struct CountedPathHash {
+    size_t operator()(const CountedPath& path) const {
+        return std::hash<std::wstring_view>()(std::wstring_view(path.data(), path.size()));
+    }
+};
+
+// Relative path -> file size, as the old file size and assignment maps kept it
+typedef std::unordered_map<CountedPath, uint64_t, CountedPathHash, std::equal_to<CountedPath>,
+                           CountingAllocator<std::pair<const CountedPath, uint64_t>>> PathMap;
+
+struct Stores {
+    PathStore paths;
+    NodeTable nodes;
+    PathMap map;
+    size_t filesPerFolder = 0;
+    size_t count = 0;
+};
+
+// Add folder's children to every store (all at once, as a scan lists them),
+// then recurse into the subfolders
+static void Build(Stores& stores, int depth, PathId pathId, NodeId nodeId, const std::wstring& path) {
+    bool leaf = depth == FOLDER_DEPTH;
+    size_t count = leaf ? stores.filesPerFolder : FOLDER_FANOUT[depth];
+
+    std::vector<NodeEntry> entries(count);
+    wchar_t name[64];
+    for (size_t i = 0; i < count; i++) {
+        if (leaf) {
+            swprintf_s(name, L"IMG_%06zu.jpg", stores.count + i);
+        } else {
+            swprintf_s(name, L"Project folder %02d-%02zu", depth, i);
+        }
+        entries[i].name = name;
+        entries[i].size = leaf ? 4000000 + i : 0;
+        entries[i].isDirectory = !leaf;
+    }
+    NodeId first = stores.nodes.AppendChildren(nodeId, entries.data(), count);
+
+    for (size_t i = 0; i < count; i++) {
+        PathId childPath = stores.paths.Child(pathId, entries[i].name);
+        std::wstring childPathText = path.empty() ? entries[i].name : path + L"\\" + entries[i].name;
+        stores.map.emplace(CountedPath(childPathText.data(), childPathText.size()), entries[i].size);
+        stores.count++;
+        if (!leaf) Build(stores, depth + 1, childPath, first + static_cast<NodeId>(i), childPathText);
+    }
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? std::strtod(argv[1], nullptr) : 2.0;
+    if (millions <= 0) millions = 2.0;
+
+    size_t folders = 1;
+    for (int d = 0; d < FOLDER_DEPTH; d++) folders *= FOLDER_FANOUT[d];
+
+    Stores stores;
+    stores.filesPerFolder = static_cast<size_t>(millions * 1000000.0 / folders) + 1;
+    stores.nodes.Reset(L"Source");
+    Build(stores, 0, NO_PATH, stores.nodes.GetRoot(), L"");
+
+    double n = static_cast<double>(stores.count);
+    wprintf(L"%zu paths, %d folders deep, %zu files per folder\n\n",
+        stores.count, FOLDER_DEPTH, stores.filesPerFolder);
+    wprintf(L"  %-40ls %10ls %12ls\n", L"Store", L"MB", L"Bytes/path");
+    wprintf(L"  %-40ls %10.1f %12.1f\n", L"unordered_map<wstring, size> (old)",
+        g_mapBytes / 1048576.0, g_mapBytes / n);
+    wprintf(L"  %-40ls %10.1f %12.1f\n", L"PathStore",
+        stores.paths.GetMemoryUsage() / 1048576.0, stores.paths.GetMemoryUsage() / n);
+    wprintf(L"  %-40ls %10.1f %12.1f\n", L"NodeTable (with sizes, times, links)",
+        stores.nodes.GetMemoryUsage() / 1048576.0, stores.nodes.GetMemoryUsage() / n);
+    return 0;
+}
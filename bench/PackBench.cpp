@@ -0,0 +1,175 @@
+// Packing benchmark: runs every PackMethod on generated file trees and
+// reports the bytes each leaves unassigned, the folders it splits across
+// drives, the predicted copy time and its own run time.
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run PackBench [seed].
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include "Packer.h"
+#include "PathStore.h"
+
+static const double MB = 1024.0 * 1024.0;
+
+// Room on the drives, as a share of the data: tight (some has to be left
+// over) and roomy (everything fits; only speed and folders tell the methods apart)
+static const double CAPACITY_SHARES[] = { 0.97, 1.5 };
+
+// How file sizes are drawn: a log-normal around a median, clamped
+struct SizeClass {
+    double share;           // of the files
+    double medianBytes;
+    double sigma;           // of the log
+    double maxBytes;
+};
+
+struct Distribution {
+    const wchar_t* name;
+    size_t files;
+    size_t filesPerFolder;
+    std::vector<SizeClass> classes;
+};
+
+// A destination drive: its share of the room and its speed
+struct BenchDrive {
+    const wchar_t* name;
+    double share;
+    double mbPerSecond;
+    double msPerFile;
+};
+
+static const BenchDrive DRIVES[] = {
+    { L"SSD", 0.50, 400, 0.5 },
+    { L"HDD", 0.30, 150, 8 },
+    { L"USB HDD", 0.20, 80, 10 },
+};
+
+// Files in folders of about filesPerFolder files, the folders two levels
+// deep, in tree order
+static std::vector<PackItem> Generate(const Distribution& dist, PathStore& paths, std::mt19937_64& rng) {
+    std::vector<PackItem> items;
+    items.reserve(dist.files);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_int_distribution<size_t> folderFiles(1, dist.filesPerFolder * 2);
+
+    PathId top = NO_PATH;
+    PathId folder = NO_PATH;
+    size_t leftInFolder = 0;
+    size_t folderCount = 0;
+    wchar_t name[32];
+    for (size_t k = 0; k < dist.files; k++) {
+        if (leftInFolder == 0) {
+            if (folderCount % 16 == 0) {
+                swprintf_s(name, L"top%zu", folderCount / 16);
+                top = paths.Child(NO_PATH, name);
+            }
+            swprintf_s(name, L"folder%zu", folderCount++);
+            folder = paths.Child(top, name);
+            leftInFolder = folderFiles(rng);
+        }
+        leftInFolder--;
+
+        double pick = unit(rng);
+        const SizeClass* cls = &dist.classes.back();
+        for (const SizeClass& c : dist.classes) {
+            if (pick < c.share) {
+                cls = &c;
+                break;
+            }
+            pick -= c.share;
+        }
+        double size = cls->medianBytes * std::exp(cls->sigma * normal(rng));
+        if (size > cls->maxBytes) size = cls->maxBytes;
+
+        swprintf_s(name, L"file%zu", k);
+        items.push_back({ paths.Child(folder, name), static_cast<uint64_t>(size) });
+    }
+    return items;
+}
+
+// Folders whose files went to more than one drive
+static size_t CountSplitFolders(const std::vector<PackItem>& items, const std::vector<int>& placement,
+                                const PathStore& paths) {
+    std::unordered_map<PathId, int> folderDrive;
+    size_t split = 0;
+    for (size_t k = 0; k < items.size(); k++) {
+        if (placement[k] < 0) continue;
+        auto [it, added] = folderDrive.emplace(paths.GetParent(items[k].path), placement[k]);
+        if (!added && it->second >= 0 && it->second != placement[k]) {
+            it->second = -1;
+            split++;
+        }
+    }
+    return split;
+}
+
+static void Run(const Distribution& dist, const std::vector<PackItem>& items, const PathStore& paths,
+                double capacityShare) {
+    uint64_t total = 0;
+    for (auto& item : items) total += item.size;
+
+    std::vector<PackDrive> drives;
+    uint64_t room = 0;
+    for (const BenchDrive& d : DRIVES) {
+        PackDrive drive;
+        drive.available = static_cast<uint64_t>(total * capacityShare * d.share);
+        drive.speed.bytesPerSecond = d.mbPerSecond * MB;
+        drive.speed.secondsPerFile = d.msPerFile / 1000.0;
+        drives.push_back(drive);
+        room += drive.available;
+    }
+
+    wprintf(L"\n%ls: %zu files, %.0f MB; drives hold %.0f MB (SSD/HDD/USB HDD)\n",
+        dist.name, items.size(), total / MB, room / MB);
+    wprintf(L"  %-26ls %14ls %9ls %8ls %10ls %9ls\n",
+        L"Method", L"Unassigned MB", L"Room used", L"Split", L"Finish s", L"Time ms");
+
+    for (int m = 0; m < static_cast<int>(PackMethod::Count); m++) {
+        PackMethod method = static_cast<PackMethod>(m);
+        std::vector<PackDrive> packed = drives;
+        std::vector<int> placement;
+
+        auto start = std::chrono::steady_clock::now();
+        Packer::Pack(method, items, paths, packed, placement);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t unused = 0;
+        double finish = 0;
+        for (auto& d : packed) {
+            unused += d.available;
+            finish = std::max(finish, d.seconds);
+        }
+        uint64_t placed = room - unused;
+        wprintf(L"  %-26ls %14.1f %8.4f%% %8zu %10.0f %9.1f\n",
+            Packer::GetName(method), (total - placed) / MB, 100.0 * placed / room,
+            CountSplitFolders(items, placement, paths), finish, ms);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::mt19937_64 rng(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1);
+
+    const double KB = 1024.0;
+    const double GB = 1024.0 * MB;
+    std::vector<Distribution> distributions = {
+        { L"Documents", 200000, 40, { { 1.0, 60 * KB, 2.0, 2 * GB } } },
+        { L"Photos", 50000, 200, { { 0.9, 4 * MB, 0.5, 64 * MB }, { 0.1, 40 * MB, 0.8, 1 * GB } } },
+        { L"Media", 3000, 20, { { 1.0, 1.5 * GB, 1.0, 40 * GB } } },
+        { L"Mixed", 300000, 50,
+          { { 0.8, 60 * KB, 2.0, 2 * GB }, { 0.19, 4 * MB, 0.5, 64 * MB }, { 0.01, 1.5 * GB, 1.0, 40 * GB } } },
+    };
+    for (auto& dist : distributions) {
+        PathStore paths;
+        std::vector<PackItem> items = Generate(dist, paths, rng);
+        for (double share : CAPACITY_SHARES) Run(dist, items, paths, share);
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Scan benchmark: builds a generated folder tree and times DirectoryScanner
+// over it with 1, 2, 4 and 8 threads, reporting folders per second and the
+// speed-up over a single thread.
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run
+// ScanBench <work folder> [folders] [files per folder].
+// The tree is created under <work folder>\ScanBench and deleted afterwards.
+// A warm-up scan runs first, so every timed scan reads the same cached
+// metadata and only the threading differs.
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "DirectoryScanner.h"
+#include "NodeTable.h"
+
+static const int THREAD_COUNTS[] = { 1, 2, 4, 8 };
+static const int FOLDER_FANOUT = 10;   // subfolders per folder, breadth first
+static const int RUNS = 3;             // timed scans per thread count (best kept)
+
+// Create folders folders under root, FOLDER_FANOUT per parent, each with
+// filesPerFolder empty files
+static bool BuildTree(const std::wstring& root, size_t folders, size_t filesPerFolder) {
+    if (!CreateDirectoryW(root.c_str(), nullptr)) return false;
+    std::vector<std::wstring> paths = { root };
+    wchar_t name[32];
+    for (size_t k = 0; k < paths.size(); k++) {
+        for (size_t f = 0; f < filesPerFolder; f++) {
+            swprintf_s(name, L"\\file%05zu.dat", f);
+            HANDLE h = CreateFileW((paths[k] + name).c_str(), GENERIC_WRITE, 0, nullptr,
+                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (h == INVALID_HANDLE_VALUE) return false;
+            CloseHandle(h);
+        }
+        for (int d = 0; d < FOLDER_FANOUT && paths.size() < folders; d++) {
+            swprintf_s(name, L"\\folder%02d", d);
+            std::wstring sub = paths[k] + name;
+            if (!CreateDirectoryW(sub.c_str(), nullptr)) return false;
+            paths.push_back(sub);
+        }
+    }
+    return true;
+}
+
+static void DeleteTree(const std::wstring& path) {
+    WIN32_FIND_DATAW fd;
+    HANDLE hFind = FindFirstFileW((path + L"\\*").c_str(), &fd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0) continue;
+            std::wstring child = path + L"\\" + fd.cFileName;
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                DeleteTree(child);
+            } else {
+                DeleteFileW(child.c_str());
+            }
+        } while (FindNextFileW(hFind, &fd));
+        FindClose(hFind);
+    }
+    RemoveDirectoryW(path.c_str());
+}
+
+// Seconds one scan of root takes with threads workers; nodes gets the tree
+static double TimeScan(const std::wstring& root, int threads, NodeTable& nodes) {
+    DirectoryScanner scanner(threads);
+    NodeId rootId = nodes.Reset(L"ScanBench");
+    auto start = std::chrono::steady_clock::now();
+    scanner.Scan(root, nodes, rootId);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 2) {
+        wprintf(L"usage: ScanBench <work folder> [folders] [files per folder]\n");
+        return 1;
+    }
+    size_t folders = argc > 2 ? std::wcstoul(argv[2], nullptr, 10) : 20000;
+    size_t filesPerFolder = argc > 3 ? std::wcstoul(argv[3], nullptr, 10) : 10;
+    if (folders < 1) folders = 1;
+    std::wstring root = std::wstring(argv[1]) + L"\\ScanBench";
+
+    wprintf(L"Creating %zu folders with %zu files each...\n", folders, filesPerFolder);
+    if (!BuildTree(root, folders, filesPerFolder)) {
+        wprintf(L"Can't create the tree under %ls (error %lu)\n", root.c_str(), GetLastError());
+        DeleteTree(root);
+        return 1;
+    }
+
+    NodeTable nodes;
+    TimeScan(root, THREAD_COUNTS[0], nodes);
+    wprintf(L"Listed %zu nodes\n\n", nodes.GetCount());
+
+    wprintf(L"  %-8ls %10ls %14ls %9ls\n", L"Threads", L"Time ms", L"Folders/s", L"Speed-up");
+    double single = 0;
+    for (int threads : THREAD_COUNTS) {
+        double best = 0;
+        for (int run = 0; run < RUNS; run++) {
+            double seconds = TimeScan(root, threads, nodes);
+            if (run == 0 || seconds < best) best = seconds;
+        }
+        if (threads == THREAD_COUNTS[0]) single = best;
+        wprintf(L"  %-8d %10.1f %14.0f %8.2fx\n", threads, best * 1000.0,
+            best > 0 ? folders / best : 0.0, best > 0 ? single / best : 0.0);
+    }
+
+    DeleteTree(root);
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Small-file copy benchmark: copies many small files (a million of 16 KB by
+// default) once through a SmallFilePool running CopySmallFile, as a drive
+// worker does, and once one at a time with CopyFileExW, as they were copied
+// before, and reports files per second for each.
+//
+// Build with -DDSPLIT_BUILD_BENCH=ON; run
+// SmallCopyBench <source folder> <destination folder> [files] [KB].
+// The files are created under <source folder>\SmallCopyBench, copied to
+// <destination folder>\SmallCopyBench and deleted afterwards.
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "SmallFileCopy.h"
+
+static const int POOL_THREADS = 8;             // MigrationParams::smallFileConcurrency
+static const size_t FILES_PER_FOLDER = 1000;
+
+struct Job {
+    std::vector<std::wstring> sources;
+    std::vector<std::wstring> destinations;
+    uint64_t fileSize = 0;
+    std::atomic<size_t> failures{ 0 };
+};
+
+static void CopyJob(size_t job, int, void* context) {
+    auto* jobs = static_cast<Job*>(context);
+    if (!CopySmallFile(jobs->sources[job], jobs->destinations[job], jobs->fileSize, nullptr, nullptr)) {
+        jobs->failures++;
+    }
+}
+
+// Folder k of a tree of FILES_PER_FOLDER-file folders under root
+static std::wstring FolderOf(const std::wstring& root, size_t k) {
+    wchar_t name[32];
+    swprintf_s(name, L"\\d%05zu", k / FILES_PER_FOLDER);
+    return root + name;
+}
+
+static bool CreateFolders(const std::wstring& root, size_t files) {
+    if (!CreateDirectoryW(root.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) return false;
+    for (size_t k = 0; k < files; k += FILES_PER_FOLDER) {
+        std::wstring folder = FolderOf(root, k);
+        if (!CreateDirectoryW(folder.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS) return false;
+    }
+    return true;
+}
+
+static void DeleteFiles(const std::vector<std::wstring>& paths) {
+    for (const auto& path : paths) DeleteFileW(path.c_str());
+}
+
+static void DeleteFolders(const std::wstring& root, size_t files) {
+    for (size_t k = 0; k < files; k += FILES_PER_FOLDER) RemoveDirectoryW(FolderOf(root, k).c_str());
+    RemoveDirectoryW(root.c_str());
+}
+
+static void Report(const wchar_t* what, size_t files, uint64_t fileSize, double seconds, size_t failures) {
+    wprintf(L"  %-36ls %9.1f s %10.0f files/s %8.1f MB/s", what, seconds,
+        seconds > 0 ? files / seconds : 0.0, seconds > 0 ? files * fileSize / (1024.0 * 1024.0) / seconds : 0.0);
+    if (failures) wprintf(L"  (%zu failed)", failures);
+    wprintf(L"\n");
+}
+
+int wmain(int argc, wchar_t** argv) {
+    if (argc < 3) {
+        wprintf(L"usage: SmallCopyBench <source folder> <destination folder> [files] [KB]\n");
+        return 1;
+    }
+    size_t files = argc > 3 ? std::wcstoul(argv[3], nullptr, 10) : 1000000;
+    uint64_t fileSize = (argc > 4 ? std::wcstoull(argv[4], nullptr, 10) : 16) * 1024;
+    std::wstring srcRoot = std::wstring(argv[1]) + L"\\SmallCopyBench";
+    std::wstring dstRoot = std::wstring(argv[2]) + L"\\SmallCopyBench";
+
+    Job jobs;
+    jobs.fileSize = fileSize;
+    jobs.sources.reserve(files);
+    jobs.destinations.reserve(files);
+    wchar_t name[32];
+    for (size_t k = 0; k < files; k++) {
+        swprintf_s(name, L"\\f%06zu.dat", k);
+        jobs.sources.push_back(FolderOf(srcRoot, k) + name);
+        jobs.destinations.push_back(FolderOf(dstRoot, k) + name);
+    }
+
+    wprintf(L"Creating %zu files of %llu KB...\n", files, fileSize / 1024);
+    if (!CreateFolders(srcRoot, files) || !CreateFolders(dstRoot, files)) {
+        wprintf(L"Can't create the folders (error %lu)\n", GetLastError());
+        return 1;
+    }
+    std::vector<char> content(static_cast<size_t>(fileSize), 'x');
+    for (size_t k = 0; k < files; k++) {
+        HANDLE h = CreateFileW(jobs.sources[k].c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, nullptr);
+        DWORD written = 0;
+        bool ok = h != INVALID_HANDLE_VALUE &&
+                  WriteFile(h, content.data(), static_cast<DWORD>(fileSize), &written, nullptr);
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+        if (!ok) {
+            wprintf(L"Can't write %ls (error %lu)\n", jobs.sources[k].c_str(), GetLastError());
+            return 1;
+        }
+    }
+    wprintf(L"\n");
+
+    int concurrency = 0;
+    {
+        auto start = std::chrono::steady_clock::now();
+        SmallFilePool pool(POOL_THREADS, CopyJob, &jobs);
+        for (size_t k = 0; k < files; k++) pool.Submit(k);
+        pool.WaitIdle();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        concurrency = pool.GetConcurrency();
+        Report(L"SmallFilePool + CopySmallFile", files, fileSize, seconds, jobs.failures);
+    }
+    DeleteFiles(jobs.destinations);
+
+    {
+        size_t failures = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t k = 0; k < files; k++) {
+            if (!CopyFileExW(jobs.sources[k].c_str(), jobs.destinations[k].c_str(), nullptr, nullptr, nullptr, 0)) {
+                failures++;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Report(L"CopyFileExW, one at a time (old)", files, fileSize, seconds, failures);
+    }
+    wprintf(L"\nPool concurrency settled at %d of %d threads\n", concurrency, POOL_THREADS);
+
+    DeleteFiles(jobs.destinations);
+    DeleteFiles(jobs.sources);
+    DeleteFolders(dstRoot, files);
+    DeleteFolders(srcRoot, files);
+    return 0;
+}
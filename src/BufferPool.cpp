@@ -0,0 +1,184 @@
+#include "BufferPool.h"
+
+static const size_t ALLOC_GRANULARITY = 64 * 1024;
+
+BufferPool& BufferPool::Instance() {
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::BufferPool() {
+    stats_.budget = DEFAULT_BUDGET;
+}
+
+BufferPool::~BufferPool() {
+    Trim();
+}
+
+size_t BufferPool::RoundSize(size_t size) const {
+    size_t unit = largePageSize_ ? largePageSize_ : ALLOC_GRANULARITY;
+    return (size + unit - 1) / unit * unit;
+}
+
+void* BufferPool::Acquire(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t rounded = RoundSize(size);
+
+    auto it = freeLists_.find(rounded);
+    if (it != freeLists_.end() && !it->second.empty()) {
+        void* buffer = it->second.back();
+        it->second.pop_back();
+        stats_.bytesCached -= rounded;
+        stats_.bytesInUse += rounded;
+        stats_.acquires++;
+        stats_.hits++;
+        return buffer;
+    }
+
+    // Miss: make room by dropping idle buffers of other sizes if needed
+    if (stats_.bytesInUse + stats_.bytesCached + rounded > stats_.budget) {
+        TrimLocked(rounded);
+        if (stats_.bytesInUse + stats_.bytesCached + rounded > stats_.budget) {
+            stats_.failures++;
+            return nullptr;
+        }
+    }
+
+    void* buffer = nullptr;
+    if (largePageSize_) {
+        buffer = VirtualAlloc(nullptr, rounded,
+            MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+    if (!buffer) {
+        buffer = VirtualAlloc(nullptr, rounded, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+    if (!buffer) {
+        stats_.failures++;
+        return nullptr;
+    }
+
+    stats_.bytesInUse += rounded;
+    stats_.acquires++;
+    uint64_t total = stats_.bytesInUse + stats_.bytesCached;
+    if (total > stats_.peakBytes) stats_.peakBytes = total;
+    return buffer;
+}
+
+void BufferPool::Release(void* buffer, size_t size) {
+    if (!buffer) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t rounded = RoundSize(size);
+    stats_.bytesInUse -= rounded;
+
+    if (stats_.bytesInUse + stats_.bytesCached + rounded > stats_.budget) {
+        VirtualFree(buffer, 0, MEM_RELEASE);
+        return;
+    }
+    freeLists_[rounded].push_back(buffer);
+    stats_.bytesCached += rounded;
+}
+
+void BufferPool::SetBudget(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.budget = bytes;
+    if (stats_.bytesInUse + stats_.bytesCached > bytes) {
+        TrimLocked(0);
+    }
+}
+
+// Free idle buffers until bytesNeeded more would fit in the budget (or the
+// cache is empty); 0 trims down to the budget. Caller holds mutex_.
+void BufferPool::TrimLocked(uint64_t bytesNeeded) {
+    for (auto& [sizeClass, buffers] : freeLists_) {
+        while (!buffers.empty()) {
+            if (stats_.bytesInUse + stats_.bytesCached + bytesNeeded <= stats_.budget)
+                return;
+            VirtualFree(buffers.back(), 0, MEM_RELEASE);
+            buffers.pop_back();
+            stats_.bytesCached -= sizeClass;
+        }
+    }
+}
+
+void BufferPool::Trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [sizeClass, buffers] : freeLists_) {
+        for (void* buffer : buffers) {
+            VirtualFree(buffer, 0, MEM_RELEASE);
+        }
+        stats_.bytesCached -= sizeClass * buffers.size();
+        buffers.clear();
+    }
+}
+
+bool BufferPool::EnableLargePages() {
+    SIZE_T minimum = GetLargePageMinimum();
+    if (minimum == 0) return false;
+
+    // Large pages require SeLockMemoryPrivilege to be held and enabled
+    HANDLE hToken;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken))
+        return false;
+
+    TOKEN_PRIVILEGES tp = {};
+    tp.PrivilegeCount = 1;
+    tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+                   AdjustTokenPrivileges(hToken, FALSE, &tp, 0, nullptr, nullptr) &&
+                   GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED if not held
+    CloseHandle(hToken);
+    if (!enabled) return false;
+
+    // Size classes change with the page size, so start from an empty cache
+    Trim();
+    std::lock_guard<std::mutex> lock(mutex_);
+    largePageSize_ = minimum;
+    stats_.largePages = true;
+    return true;
+}
+
+BufferPoolStats BufferPool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void BufferPool::ResetPeak() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.peakBytes = stats_.bytesInUse + stats_.bytesCached;
+}
+
+// --- PooledBuffer ---
+
+PooledBuffer::PooledBuffer(size_t size) {
+    buffer_ = BufferPool::Instance().Acquire(size);
+    if (buffer_) size_ = size;
+}
+
+PooledBuffer::~PooledBuffer() {
+    Reset();
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : buffer_(other.buffer_), size_(other.size_) {
+    other.buffer_ = nullptr;
+    other.size_ = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        buffer_ = other.buffer_;
+        size_ = other.size_;
+        other.buffer_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void PooledBuffer::Reset() {
+    if (buffer_) {
+        BufferPool::Instance().Release(buffer_, size_);
+        buffer_ = nullptr;
+        size_ = 0;
+    }
+}
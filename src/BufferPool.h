@@ -0,0 +1,88 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+struct BufferPoolStats {
+    uint64_t acquires = 0;      // successful checkouts
+    uint64_t hits = 0;          // checkouts served from the free lists
+    uint64_t failures = 0;      // checkouts refused (budget or allocation failure)
+    uint64_t bytesInUse = 0;    // checked out right now
+    uint64_t bytesCached = 0;   // allocated but idle in the free lists
+    uint64_t peakBytes = 0;     // high-water mark of bytesInUse + bytesCached
+    uint64_t budget = 0;
+    bool largePages = false;
+};
+
+// Process-wide pool of sector-aligned I/O buffers. Buffers come from
+// VirtualAlloc (64 KB aligned, zeroed once) and are recycled by size class
+// instead of being freed, so per-file copy/verify/hash work doesn't pay for
+// fresh pages every time. Total pool memory never exceeds the budget.
+class BufferPool {
+public:
+    static BufferPool& Instance();
+
+    // Check out a buffer of at least size bytes. Returns nullptr if the budget
+    // can't accommodate it even after trimming idle buffers.
+    void* Acquire(size_t size);
+
+    // Return a buffer obtained from Acquire with the same size
+    void Release(void* buffer, size_t size);
+
+    // Cap on in-use + cached bytes. Shrinking trims idle buffers immediately.
+    void SetBudget(uint64_t bytes);
+
+    // Try to back new buffers with large pages (needs SeLockMemoryPrivilege).
+    // Returns false and stays on normal pages if unavailable. Call before any
+    // buffers are checked out, since it changes the size classes.
+    bool EnableLargePages();
+
+    // Free all idle buffers
+    void Trim();
+
+    BufferPoolStats GetStats() const;
+
+    // Start peakBytes over from what the pool holds now
+    void ResetPeak();
+
+    static const uint64_t DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+private:
+    BufferPool();
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    size_t RoundSize(size_t size) const;
+    void TrimLocked(uint64_t bytesNeeded);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<size_t, std::vector<void*>> freeLists_; // size class -> idle buffers
+    BufferPoolStats stats_;
+    size_t largePageSize_ = 0;                                  // 0 = large pages off
+};
+
+// RAII checkout from the process-wide BufferPool
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+    explicit PooledBuffer(size_t size);
+    ~PooledBuffer();
+
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    void* Get() const { return buffer_; }
+    size_t Size() const { return size_; }
+    explicit operator bool() const { return buffer_ != nullptr; }
+
+    void Reset();
+
+private:
+    void* buffer_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,160 @@
+#include "ChangeWatcher.h"
+
+// 64 KB is the most ReadDirectoryChangesW accepts for a network share
+static const DWORD NOTIFY_BUFFER_SIZE = 64 * 1024;
+
+// Past this many stale folders, re-checking the whole tree is cheaper than
+// remembering them
+static const size_t MAX_STALE_FOLDERS = 10000;
+
+// Names and sizes are all the tree shows; attribute and time changes are
+// left out so a busy folder doesn't keep the watcher awake
+static const DWORD NOTIFY_FILTER =
+    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE;
+
+ChangeWatcher::ChangeWatcher() {}
+
+ChangeWatcher::~ChangeWatcher() {
+    Stop();
+}
+
+bool ChangeWatcher::Start(HWND hWndNotify, const std::wstring& path) {
+    Stop();
+
+    hDir_ = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (hDir_ == INVALID_HANDLE_VALUE) return false;
+
+    hWndNotify_ = hWndNotify;
+    hStopEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (hStopEvent_) {
+        hThread_ = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    }
+    if (!hThread_) {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+void ChangeWatcher::Stop() {
+    if (hThread_) {
+        SetEvent(hStopEvent_);
+        WaitForSingleObject(hThread_, INFINITE);
+        CloseHandle(hThread_);
+        hThread_ = nullptr;
+    }
+    if (hStopEvent_) {
+        CloseHandle(hStopEvent_);
+        hStopEvent_ = nullptr;
+    }
+    if (hDir_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(hDir_);
+        hDir_ = INVALID_HANDLE_VALUE;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stale_.clear();
+    lost_ = false;
+    notified_ = false;
+}
+
+bool ChangeWatcher::TakeChanges(std::vector<std::wstring>& folders) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool lost = lost_;
+    if (!lost) {
+        folders.reserve(folders.size() + stale_.size());
+        for (const auto& folder : stale_) folders.push_back(folder);
+    }
+    stale_.clear();
+    lost_ = false;
+    notified_ = false;
+    return lost;
+}
+
+DWORD WINAPI ChangeWatcher::ThreadProc(LPVOID param) {
+    static_cast<ChangeWatcher*>(param)->Run();
+    return 0;
+}
+
+void ChangeWatcher::Run() {
+    // DWORD elements keep the records DWORD-aligned, as the API requires
+    std::vector<DWORD> buffer(NOTIFY_BUFFER_SIZE / sizeof(DWORD));
+    OVERLAPPED ov = {};
+    ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!ov.hEvent) return;
+
+    std::vector<std::wstring> folders;
+    for (;;) {
+        // Changes made between two calls are buffered by the system, so
+        // nothing is missed while the last batch is being sorted out
+        ResetEvent(ov.hEvent);
+        if (!ReadDirectoryChangesW(hDir_, buffer.data(), NOTIFY_BUFFER_SIZE, TRUE,
+                                   NOTIFY_FILTER, nullptr, &ov, nullptr)) {
+            // The folder went away, or the share dropped
+            Queue(folders, true);
+            break;
+        }
+
+        HANDLE handles[2] = { hStopEvent_, ov.hEvent };
+        DWORD wait = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+        DWORD bytes = 0;
+        if (wait != WAIT_OBJECT_0 + 1) {
+            CancelIoEx(hDir_, &ov);
+            GetOverlappedResult(hDir_, &ov, &bytes, TRUE);
+            break;
+        }
+        if (!GetOverlappedResult(hDir_, &ov, &bytes, FALSE)) {
+            DWORD err = GetLastError();
+            Queue(folders, true);
+            if (err == ERROR_NOTIFY_ENUM_DIR) continue;     // overflow; keep watching
+            break;
+        }
+        if (bytes == 0) {
+            // The system's buffer overflowed and the changes were dropped
+            Queue(folders, true);
+            continue;
+        }
+
+        // Each record names an entry relative to the watched folder; the
+        // folder holding it is the one whose listing changed
+        const BYTE* p = reinterpret_cast<const BYTE*>(buffer.data());
+        for (;;) {
+            auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+            size_t length = info->FileNameLength / sizeof(wchar_t);
+            size_t sep = length;
+            while (sep > 0 && info->FileName[sep - 1] != L'\\') sep--;
+            folders.emplace_back(info->FileName, sep > 0 ? sep - 1 : 0);
+
+            if (info->NextEntryOffset == 0) break;
+            p += info->NextEntryOffset;
+        }
+        Queue(folders, false);
+    }
+
+    CloseHandle(ov.hEvent);
+}
+
+void ChangeWatcher::Queue(std::vector<std::wstring>& folders, bool lost) {
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lost) lost_ = true;
+        if (!lost_) {
+            for (auto& folder : folders) {
+                stale_.insert(std::move(folder));
+            }
+            if (stale_.size() > MAX_STALE_FOLDERS) lost_ = true;
+        }
+        if (lost_) stale_.clear();
+
+        notify = (lost_ || !stale_.empty()) && !notified_;
+        if (notify) notified_ = true;
+    }
+    folders.clear();
+
+    if (notify && hWndNotify_) {
+        PostMessageW(hWndNotify_, WM_SOURCE_CHANGED, 0, 0);
+    }
+}
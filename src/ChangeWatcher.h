@@ -0,0 +1,53 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+
+// Posted when changes have been queued since the last TakeChanges (at most
+// one is in flight at a time)
+#define WM_SOURCE_CHANGED       (WM_USER + 111)
+
+// Watches a source folder tree with ReadDirectoryChangesW on a background
+// thread. Changes are reduced to the set of folders whose listing is out of
+// date; the consumer re-lists just those. Memory is bounded: one fixed
+// notification buffer, and a cap on the folder set past which everything
+// is reported as stale instead. An idle tree costs a blocked thread.
+class ChangeWatcher {
+public:
+    ChangeWatcher();
+    ~ChangeWatcher();
+
+    ChangeWatcher(const ChangeWatcher&) = delete;
+    ChangeWatcher& operator=(const ChangeWatcher&) = delete;
+
+    // Start watching path and everything below it. hWndNotify may be null.
+    bool Start(HWND hWndNotify, const std::wstring& path);
+
+    // Stop watching and drop anything not taken yet
+    void Stop();
+
+    bool IsWatching() const { return hThread_ != nullptr; }
+
+    // Move the folders changed since the last call into folders, as paths
+    // relative to the watched folder (L"" is the folder itself). Returns
+    // true if changes were lost (the system's buffer or the folder cap
+    // overflowed, or the watch failed) and the whole tree has to be checked.
+    bool TakeChanges(std::vector<std::wstring>& folders);
+
+private:
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void Run();
+    void Queue(std::vector<std::wstring>& folders, bool lost);
+
+    HWND hWndNotify_ = nullptr;
+    HANDLE hDir_ = INVALID_HANDLE_VALUE;
+    HANDLE hStopEvent_ = nullptr;
+    HANDLE hThread_ = nullptr;
+
+    std::mutex mutex_;
+    std::unordered_set<std::wstring> stale_;    // folders to re-list
+    bool lost_ = false;
+    bool notified_ = false;                     // a WM_SOURCE_CHANGED is in flight
+};
@@ -0,0 +1,79 @@
+#include "CheckBits.h"
+#include <bitset>
+#include <algorithm>
+
+void CheckBits::Clear() {
+    words_.clear();
+    words_.shrink_to_fit();
+    count_ = 0;
+}
+
+void CheckBits::Resize(size_t count) {
+    words_.resize((count + 63) / 64, 0);
+    count_ = count;
+    ClearTail();
+}
+
+void CheckBits::Set(size_t index, bool value) {
+    if (index >= count_) {
+        if (!value) return;
+        Resize(index + 1);
+    }
+    uint64_t bit = 1ull << (index & 63);
+    if (value) words_[index >> 6] |= bit;
+    else words_[index >> 6] &= ~bit;
+}
+
+void CheckBits::SetRange(size_t begin, size_t end, bool value) {
+    if (end > count_) {
+        if (!value) end = count_;
+        else Resize(end);
+    }
+    if (begin >= end) return;
+
+    size_t first = begin >> 6;
+    size_t last = (end - 1) >> 6;
+    uint64_t headMask = ~0ull << (begin & 63);
+    uint64_t tailMask = ~0ull >> (63 - ((end - 1) & 63));
+    if (first == last) {
+        uint64_t mask = headMask & tailMask;
+        if (value) words_[first] |= mask;
+        else words_[first] &= ~mask;
+        return;
+    }
+    if (value) words_[first] |= headMask;
+    else words_[first] &= ~headMask;
+    std::fill(words_.begin() + first + 1, words_.begin() + last, value ? ~0ull : 0ull);
+    if (value) words_[last] |= tailMask;
+    else words_[last] &= ~tailMask;
+}
+
+void CheckBits::Fill(bool value) {
+    std::fill(words_.begin(), words_.end(), value ? ~0ull : 0ull);
+    ClearTail();
+}
+
+size_t CheckBits::CountRange(size_t begin, size_t end) const {
+    end = std::min(end, count_);
+    if (begin >= end) return 0;
+
+    size_t first = begin >> 6;
+    size_t last = (end - 1) >> 6;
+    uint64_t headMask = ~0ull << (begin & 63);
+    uint64_t tailMask = ~0ull >> (63 - ((end - 1) & 63));
+    if (first == last) {
+        return std::bitset<64>(words_[first] & headMask & tailMask).count();
+    }
+    size_t total = std::bitset<64>(words_[first] & headMask).count();
+    for (size_t w = first + 1; w < last; w++) {
+        total += std::bitset<64>(words_[w]).count();
+    }
+    return total + std::bitset<64>(words_[last] & tailMask).count();
+}
+
+// Keep the unused bits of the last word 0, so growing never exposes set bits
+void CheckBits::ClearTail() {
+    if (count_ & 63) {
+        words_.back() &= ~0ull >> (64 - (count_ & 63));
+    }
+}
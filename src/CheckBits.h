@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// A growable bitset for per-node flags, with whole-word range operations:
+// setting a run of bits writes its words directly (two masked edges, a fill
+// in between) and counting one is a popcount per word, so flagging or
+// tallying a block of a million siblings costs a few thousand word ops.
+// Bits past the current count read as 0.
+class CheckBits {
+public:
+    void Clear();
+
+    // Grow (or shrink) to count bits; new bits are 0
+    void Resize(size_t count);
+    size_t GetCount() const { return count_; }
+
+    bool Get(size_t index) const {
+        return index < count_ && ((words_[index >> 6] >> (index & 63)) & 1) != 0;
+    }
+
+    // Set one bit, or the bits in [begin, end). Growing past the count
+    // as needed.
+    void Set(size_t index, bool value);
+    void SetRange(size_t begin, size_t end, bool value);
+
+    // Set every bit below the count
+    void Fill(bool value);
+
+    // Number of set bits in [begin, end)
+    size_t CountRange(size_t begin, size_t end) const;
+
+    size_t GetMemoryUsage() const { return words_.capacity() * sizeof(uint64_t); }
+
+private:
+    void ClearTail();
+
+    std::vector<uint64_t> words_;
+    size_t count_ = 0;
+};
@@ -0,0 +1,154 @@
+#include "ContentHash.h"
+#include <cstring>
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+static const uint64_t PRIME4 = 9650029242287828579ULL;
+static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = Rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+ContentHash::ContentHash(uint64_t seed) {
+    Reset(seed);
+}
+
+void ContentHash::Reset(uint64_t seed) {
+    seed_ = seed;
+    acc_[0] = seed + PRIME1 + PRIME2;
+    acc_[1] = seed + PRIME2;
+    acc_[2] = seed;
+    acc_[3] = seed - PRIME1;
+    totalLength_ = 0;
+    pendingSize_ = 0;
+}
+
+void ContentHash::Update(const void* data, size_t length) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    totalLength_ += length;
+
+    // Top up a partial stripe left over from the previous call
+    if (pendingSize_ > 0) {
+        size_t take = sizeof(pending_) - pendingSize_;
+        if (take > length) take = length;
+        memcpy(pending_ + pendingSize_, p, take);
+        pendingSize_ += take;
+        p += take;
+        if (pendingSize_ < sizeof(pending_)) return;
+
+        acc_[0] = Round(acc_[0], Read64(pending_));
+        acc_[1] = Round(acc_[1], Read64(pending_ + 8));
+        acc_[2] = Round(acc_[2], Read64(pending_ + 16));
+        acc_[3] = Round(acc_[3], Read64(pending_ + 24));
+        pendingSize_ = 0;
+    }
+
+    // Four independent lanes per 32-byte stripe keep the multipliers busy
+    uint64_t v1 = acc_[0], v2 = acc_[1], v3 = acc_[2], v4 = acc_[3];
+    while (end - p >= 32) {
+        v1 = Round(v1, Read64(p));
+        v2 = Round(v2, Read64(p + 8));
+        v3 = Round(v3, Read64(p + 16));
+        v4 = Round(v4, Read64(p + 24));
+        p += 32;
+    }
+    acc_[0] = v1; acc_[1] = v2; acc_[2] = v3; acc_[3] = v4;
+
+    if (p < end) {
+        memcpy(pending_, p, end - p);
+        pendingSize_ = end - p;
+    }
+}
+
+uint64_t ContentHash::Digest() const {
+    uint64_t h;
+    if (totalLength_ >= 32) {
+        h = Rotl(acc_[0], 1) + Rotl(acc_[1], 7) + Rotl(acc_[2], 12) + Rotl(acc_[3], 18);
+        h = MergeRound(h, acc_[0]);
+        h = MergeRound(h, acc_[1]);
+        h = MergeRound(h, acc_[2]);
+        h = MergeRound(h, acc_[3]);
+    } else {
+        h = seed_ + PRIME5;
+    }
+    h += totalLength_;
+
+    const unsigned char* p = pending_;
+    const unsigned char* end = pending_ + pendingSize_;
+    while (end - p >= 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * PRIME1 + PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+        h = Rotl(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<uint64_t>(*p) * PRIME5;
+        h = Rotl(h, 11) * PRIME1;
+        p++;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t ContentHash::Compute(const void* data, size_t length, uint64_t seed) {
+    ContentHash hash(seed);
+    hash.Update(data, length);
+    return hash.Digest();
+}
+
+std::wstring ContentHash::Format(uint64_t digest) {
+    wchar_t buf[20];
+    swprintf_s(buf, L"%016llx", digest);
+    return buf;
+}
+
+bool ContentHash::Parse(const std::wstring& hex, uint64_t& digest) {
+    if (hex.size() != 16) return false;
+    uint64_t v = 0;
+    for (wchar_t ch : hex) {
+        int d;
+        if (ch >= L'0' && ch <= L'9') d = ch - L'0';
+        else if (ch >= L'a' && ch <= L'f') d = ch - L'a' + 10;
+        else if (ch >= L'A' && ch <= L'F') d = ch - L'A' + 10;
+        else return false;
+        v = (v << 4) | d;
+    }
+    digest = v;
+    return true;
+}
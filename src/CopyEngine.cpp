@@ -0,0 +1,280 @@
+#include "CopyEngine.h"
+#include "ContentHash.h"
+
+// Completion keys identify which handle a packet belongs to (for debugging;
+// the slot's own state says whether it was a read or a write)
+static const ULONG_PTR KEY_SOURCE = 1;
+static const ULONG_PTR KEY_DEST = 2;
+
+CopyEngine::CopyEngine(const CopyEngineOptions& options) : options_(options) {
+    if (options_.queueDepth < 1) options_.queueDepth = 1;
+    options_.chunkSize &= ~(SECTOR_ALIGN - 1);
+    if (options_.chunkSize < SECTOR_ALIGN) options_.chunkSize = SECTOR_ALIGN;
+    slots_.resize(options_.queueDepth);
+}
+
+CopyEngine::~CopyEngine() {
+    if (hPort_) CloseHandle(hPort_);
+}
+
+bool CopyEngine::EnsurePort() {
+    if (!hPort_) {
+        hPort_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    }
+    return hPort_ != nullptr;
+}
+
+bool CopyEngine::IssueRead(HANDLE hSrc, Slot& slot, uint64_t offset) {
+    slot.ov = OVERLAPPED{};
+    slot.ov.Offset = static_cast<DWORD>(offset);
+    slot.ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    slot.offset = offset;
+    slot.length = 0;
+    slot.writing = false;
+    slot.hashPending = false;
+    slot.parked = false;
+
+    BOOL ok = ReadFile(hSrc, slot.buffer.Get(), options_.chunkSize, nullptr, &slot.ov);
+    return ok || GetLastError() == ERROR_IO_PENDING;
+}
+
+bool CopyEngine::IssueWrite(HANDLE hDst, Slot& slot) {
+    // Round up write size to sector boundary (required for unbuffered I/O)
+    DWORD writeSize = (slot.length + SECTOR_ALIGN - 1) & ~(SECTOR_ALIGN - 1);
+    if (writeSize > slot.length) {
+        memset(static_cast<char*>(slot.buffer.Get()) + slot.length, 0, writeSize - slot.length);
+    }
+
+    slot.ov = OVERLAPPED{};
+    slot.ov.Offset = static_cast<DWORD>(slot.offset);
+    slot.ov.OffsetHigh = static_cast<DWORD>(slot.offset >> 32);
+    slot.writing = true;
+
+    BOOL ok = WriteFile(hDst, slot.buffer.Get(), writeSize, nullptr, &slot.ov);
+    return ok || GetLastError() == ERROR_IO_PENDING;
+}
+
+bool CopyEngine::Copy(const std::wstring& src, const std::wstring& dst, uint64_t fileSize,
+                      const std::atomic<bool>* cancelled, CopyProgressFn progress, void* context,
+                      uint64_t* digest) {
+    if (!EnsurePort()) return false;
+
+    // Open source: unbuffered + sequential scan + overlapped
+    HANDLE hSrc = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED,
+        nullptr);
+    if (hSrc == INVALID_HANDLE_VALUE) return false;
+
+    // Open destination: unbuffered + overlapped
+    HANDLE hDst = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
+        nullptr);
+    if (hDst == INVALID_HANDLE_VALUE) {
+        DWORD err = GetLastError();
+        CloseHandle(hSrc);
+        SetLastError(err);
+        return false;
+    }
+
+    // Pre-allocate destination to reduce fragmentation on HDDs
+    LARGE_INTEGER preSize;
+    preSize.QuadPart = static_cast<LONGLONG>((fileSize + SECTOR_ALIGN - 1) & ~((uint64_t)SECTOR_ALIGN - 1));
+    SetFilePointerEx(hDst, preSize, nullptr, FILE_BEGIN);
+    SetEndOfFile(hDst);
+
+    bool success = CreateIoCompletionPort(hSrc, hPort_, KEY_SOURCE, 0) != nullptr &&
+                   CreateIoCompletionPort(hDst, hPort_, KEY_DEST, 0) != nullptr;
+    DWORD error = success ? ERROR_SUCCESS : GetLastError();
+
+    // Check out the ring's buffers; under memory pressure run with a shallower
+    // queue rather than failing, as long as at least one buffer is available.
+    DWORD buffersAvailable = 0;
+    for (auto& slot : slots_) {
+        slot.buffer = PooledBuffer(options_.chunkSize);
+        slot.hashPending = false;
+        slot.parked = false;
+        if (slot.buffer) buffersAvailable++;
+    }
+    if (success && buffersAvailable == 0) {
+        success = false;
+        error = ERROR_NOT_ENOUGH_MEMORY;
+    }
+
+    auto fail = [&](DWORD err) {
+        if (!success) return;
+        success = false;
+        error = err;
+        // Abort everything still in flight; the drain loop collects the packets
+        CancelIoEx(hSrc, nullptr);
+        CancelIoEx(hDst, nullptr);
+    };
+
+    uint64_t nextRead = 0;
+    uint64_t bytesWritten = 0;
+    int inFlight = 0;
+
+    // Reads complete out of order but the hash must see the file in order:
+    // each completed read waits (still owning its slot) until every earlier
+    // chunk has been hashed. Its write proceeds meanwhile.
+    ContentHash hash;
+    uint64_t hashedUpTo = 0;
+
+    auto advanceHash = [&]() {
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            for (auto& slot : slots_) {
+                if (slot.hashPending && slot.offset == hashedUpTo) {
+                    hash.Update(slot.buffer.Get(), slot.length);
+                    hashedUpTo += options_.chunkSize;
+                    slot.hashPending = false;
+                    progressed = true;
+                }
+            }
+        }
+    };
+
+    // Hand a finished slot the next unread chunk, if any
+    auto refill = [&](Slot& slot) {
+        slot.parked = false;
+        if (nextRead >= fileSize) return;
+        if (!IssueRead(hSrc, slot, nextRead)) {
+            fail(GetLastError());
+            return;
+        }
+        nextRead += options_.chunkSize;
+        inFlight++;
+    };
+
+    // Prime the ring: one read per slot
+    for (auto& slot : slots_) {
+        if (!success || nextRead >= fileSize) break;
+        if (!slot.buffer) continue;
+        if (!IssueRead(hSrc, slot, nextRead)) {
+            fail(GetLastError());
+            break;
+        }
+        nextRead += options_.chunkSize;
+        inFlight++;
+    }
+
+    // Every completed read becomes a write at the same offset; every completed
+    // write frees its slot for the next unread chunk. After a failure we keep
+    // looping until all outstanding requests have completed, since the kernel
+    // still owns their buffers.
+    while (inFlight > 0) {
+        DWORD bytes = 0;
+        ULONG_PTR key = 0;
+        OVERLAPPED* pov = nullptr;
+        BOOL ok = GetQueuedCompletionStatus(hPort_, &bytes, &key, &pov, INFINITE);
+        if (!pov) {
+            fail(GetLastError());
+            break;
+        }
+        inFlight--;
+
+        Slot& slot = *reinterpret_cast<Slot*>(pov);
+        if (!ok) {
+            DWORD err = GetLastError();
+            if (slot.writing || err != ERROR_HANDLE_EOF) {
+                fail(err);
+                continue;
+            }
+            bytes = 0; // read at end of file
+        }
+        if (!success) continue;
+
+        if (cancelled && *cancelled) {
+            fail(ERROR_OPERATION_ABORTED);
+            continue;
+        }
+
+        if (!slot.writing) {
+            uint64_t expected = fileSize - slot.offset;
+            if (expected > options_.chunkSize) expected = options_.chunkSize;
+            if (bytes < expected) {
+                fail(ERROR_HANDLE_EOF); // source shrank underneath us
+                continue;
+            }
+            slot.length = static_cast<DWORD>(expected);
+            slot.hashPending = digest != nullptr;
+            if (!IssueWrite(hDst, slot)) {
+                fail(GetLastError());
+                continue;
+            }
+            inFlight++;
+
+            if (digest) {
+                advanceHash();
+                for (auto& other : slots_) {
+                    if (other.parked && !other.hashPending) refill(other);
+                }
+            }
+        } else {
+            bytesWritten += slot.length;
+            if (progress && !progress(bytesWritten, context)) {
+                fail(ERROR_OPERATION_ABORTED);
+                continue;
+            }
+            if (slot.hashPending) {
+                slot.parked = true;
+            } else {
+                refill(slot);
+            }
+        }
+    }
+
+    CloseHandle(hSrc);
+    CloseHandle(hDst);
+    for (auto& slot : slots_) {
+        slot.buffer.Reset();
+    }
+
+    if (success && digest) {
+        *digest = hash.Digest();
+    }
+
+    if (success) {
+        // Set exact file size (unbuffered writes are sector-padded, may overshoot)
+        HANDLE hFix = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hFix != INVALID_HANDLE_VALUE) {
+            LARGE_INTEGER liExact;
+            liExact.QuadPart = static_cast<LONGLONG>(fileSize);
+            SetFilePointerEx(hFix, liExact, nullptr, FILE_BEGIN);
+            SetEndOfFile(hFix);
+            CloseHandle(hFix);
+        }
+
+        // Copy timestamps from source
+        HANDLE hSrcInfo = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (hSrcInfo != INVALID_HANDLE_VALUE) {
+            FILETIME ftCreate, ftAccess, ftWrite;
+            if (GetFileTime(hSrcInfo, &ftCreate, &ftAccess, &ftWrite)) {
+                HANDLE hDstInfo = CreateFileW(dst.c_str(), FILE_WRITE_ATTRIBUTES, 0,
+                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if (hDstInfo != INVALID_HANDLE_VALUE) {
+                    SetFileTime(hDstInfo, &ftCreate, &ftAccess, &ftWrite);
+                    CloseHandle(hDstInfo);
+                }
+            }
+            CloseHandle(hSrcInfo);
+        }
+
+        // Copy file attributes
+        DWORD attrs = GetFileAttributesW(src.c_str());
+        if (attrs != INVALID_FILE_ATTRIBUTES) {
+            SetFileAttributesW(dst.c_str(), attrs);
+        }
+        return true;
+    }
+
+    if (!cancelled || !*cancelled) {
+        DeleteFileW(dst.c_str());
+    }
+    SetLastError(error);
+    return false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "BufferPool.h"
+
+// Progress callback: bytes of the current file written so far. Return false to cancel.
+typedef bool (*CopyProgressFn)(uint64_t bytesInFile, void* context);
+
+struct CopyEngineOptions {
+    DWORD queueDepth = 8;                 // I/O buffers in flight per file
+    DWORD chunkSize = 4 * 1024 * 1024;    // bytes per request (multiple of SECTOR_ALIGN)
+};
+
+// Unbuffered copy engine with a ring of aligned buffers completed through an
+// I/O completion port. Up to queueDepth reads and writes are outstanding at
+// once and complete in any order; each buffer cycles read -> write -> read.
+// One engine per thread: it owns a completion port; buffers are checked out
+// of the BufferPool for the duration of each copy.
+class CopyEngine {
+public:
+    explicit CopyEngine(const CopyEngineOptions& options = CopyEngineOptions());
+    ~CopyEngine();
+
+    CopyEngine(const CopyEngine&) = delete;
+    CopyEngine& operator=(const CopyEngine&) = delete;
+
+    // Copy src to dst (created or overwritten), then fix the exact size and copy
+    // timestamps and attributes. On failure the partial destination is deleted
+    // unless the copy was cancelled; GetLastError() describes the failure.
+    // If digest is non-null, the content hash of the bytes read is stored there.
+    bool Copy(const std::wstring& src, const std::wstring& dst, uint64_t fileSize,
+              const std::atomic<bool>* cancelled, CopyProgressFn progress, void* context,
+              uint64_t* digest = nullptr);
+
+    const CopyEngineOptions& GetOptions() const { return options_; }
+
+    static const DWORD SECTOR_ALIGN = 4096;
+
+private:
+    struct Slot {
+        OVERLAPPED ov;          // must stay first: completions are mapped back by address
+        PooledBuffer buffer;
+        uint64_t offset;
+        DWORD length;           // bytes read into buffer (before sector padding)
+        bool writing;
+        bool hashPending;       // read completed, not yet fed to the hash
+        bool parked;            // write done, waiting for the hash before reuse
+    };
+
+    bool EnsurePort();
+    bool IssueRead(HANDLE hSrc, Slot& slot, uint64_t offset);
+    bool IssueWrite(HANDLE hDst, Slot& slot);
+
+    CopyEngineOptions options_;
+    HANDLE hPort_ = nullptr;
+    std::vector<Slot> slots_;
+};
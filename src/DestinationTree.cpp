@@ -35,9 +35,11 @@ void DestinationTree::Clear() {
     }
     drives_.clear();
     driveNodes_.clear();
+    folderNodes_.clear();
+    fileNodes_.clear();
 }
 
-std::wstring DestinationTree::BuildDriveLabel(int index, uint64_t assignedBytes) const {
+std::wstring DestinationTree::BuildDriveLabel(int index, uint64_t assignedBytes, double finishSeconds) const {
     if (index < 0 || index >= static_cast<int>(drives_.size())) return L"";
     const auto& d = drives_[index];
     std::wstring label = d.driveLetter;
@@ -46,7 +48,9 @@ std::wstring DestinationTree::BuildDriveLabel(int index, uint64_t assignedBytes)
     }
     label += L" \u2014 " + Utils::FormatSize(d.freeBytes) + L" free";
     if (assignedBytes > 0) {
-        label += L" (" + Utils::FormatSize(assignedBytes) + L" assigned)";
+        label += L" (" + Utils::FormatSize(assignedBytes) + L" assigned";
+        if (finishSeconds > 0) label += L", ~" + Utils::FormatDuration(finishSeconds);
+        label += L")";
     }
     return label;
 }
@@ -56,100 +60,93 @@ HTREEITEM DestinationTree::GetDriveNode(int index) const {
     return driveNodes_[index];
 }
 
-uint64_t DestinationTree::GetAssignedBytes(int index,
-    const std::unordered_map<std::wstring, int>& assignments,
-    const std::unordered_map<std::wstring, uint64_t>& fileSizes) const
-{
-    uint64_t total = 0;
-    for (const auto& [path, driveIdx] : assignments) {
-        if (driveIdx == index) {
-            auto sizeIt = fileSizes.find(path);
-            if (sizeIt != fileSizes.end()) {
-                total += sizeIt->second;
-            }
-        }
-    }
-    return total;
+void DestinationTree::SetDriveLabel(int index, uint64_t assignedBytes, double finishSeconds) {
+    HTREEITEM hDrive = GetDriveNode(index);
+    if (!hDrive) return;
+    std::wstring label = BuildDriveLabel(index, assignedBytes, finishSeconds);
+    TVITEMW tvi = {};
+    tvi.mask = TVIF_TEXT;
+    tvi.hItem = hDrive;
+    tvi.pszText = const_cast<wchar_t*>(label.c_str());
+    TreeView_SetItem(hTree_, &tvi);
+}
+
+HTREEITEM DestinationTree::GetFolderNode(int driveIndex, PathId folder, const PathStore& paths) {
+    if (folder == NO_PATH) return driveNodes_[driveIndex];
+
+    uint64_t cacheKey = (static_cast<uint64_t>(driveIndex) << 32) | folder;
+    auto it = folderNodes_.find(cacheKey);
+    if (it != folderNodes_.end()) return it->second;
+
+    // Create the parent chain first, then this folder under it
+    HTREEITEM hParent = GetFolderNode(driveIndex, paths.GetParent(folder), paths);
+    std::wstring name = paths.GetName(folder);
+    TVINSERTSTRUCTW tvis = {};
+    tvis.hParent = hParent;
+    tvis.hInsertAfter = TVI_LAST;
+    tvis.item.mask = TVIF_TEXT;
+    tvis.item.pszText = const_cast<wchar_t*>(name.c_str());
+    HTREEITEM hFolder = TreeView_InsertItem(hTree_, &tvis);
+    folderNodes_[cacheKey] = hFolder;
+    return hFolder;
 }
 
-void DestinationTree::InsertPath(int driveIndex, const std::wstring& relativePath,
-                                  uint64_t fileSize,
-                                  std::unordered_map<std::wstring, HTREEITEM>& folderCache) {
+void DestinationTree::AddFile(int driveIndex, PathId path, uint64_t fileSize, const PathStore& paths) {
     if (driveIndex < 0 || driveIndex >= static_cast<int>(driveNodes_.size())) return;
 
-    HTREEITEM hDriveRoot = driveNodes_[driveIndex];
+    HTREEITEM hParent = GetFolderNode(driveIndex, paths.GetParent(path), paths);
 
-    // Split path into components
-    std::vector<std::wstring> parts;
-    size_t start = 0;
-    while (start < relativePath.size()) {
-        size_t sep = relativePath.find(L'\\', start);
-        if (sep == std::wstring::npos) {
-            parts.push_back(relativePath.substr(start));
-            break;
-        }
-        parts.push_back(relativePath.substr(start, sep - start));
-        start = sep + 1;
+    // File leaf node
+    std::wstring display = paths.GetName(path);
+    if (fileSize > 0) {
+        display += L"  (" + Utils::FormatSizeShort(fileSize) + L")";
     }
+    TVINSERTSTRUCTW tvis = {};
+    tvis.hParent = hParent;
+    tvis.hInsertAfter = TVI_LAST;
+    tvis.item.mask = TVIF_TEXT;
+    tvis.item.pszText = const_cast<wchar_t*>(display.c_str());
+    fileNodes_[path] = TreeView_InsertItem(hTree_, &tvis);
+}
+
+void DestinationTree::RemoveFile(int driveIndex, PathId path, const PathStore& paths) {
+    auto it = fileNodes_.find(path);
+    if (it == fileNodes_.end()) return;
+    TreeView_DeleteItem(hTree_, it->second);
+    fileNodes_.erase(it);
+
+    // Folders it leaves empty go too, up to the first one still in use
+    for (PathId folder = paths.GetParent(path); folder != NO_PATH; folder = paths.GetParent(folder)) {
+        auto folderIt = folderNodes_.find((static_cast<uint64_t>(driveIndex) << 32) | folder);
+        if (folderIt == folderNodes_.end() || TreeView_GetChild(hTree_, folderIt->second)) break;
+        TreeView_DeleteItem(hTree_, folderIt->second);
+        folderNodes_.erase(folderIt);
+    }
+}
 
-    // Create folder nodes for each intermediate component
-    HTREEITEM hParent = hDriveRoot;
-    std::wstring cumulPath;
-    // Prefix with drive index to scope folder cache per drive
-    wchar_t drivePrefix[16];
-    swprintf_s(drivePrefix, L"%d:", driveIndex);
-
-    for (size_t i = 0; i < parts.size(); i++) {
-        if (!cumulPath.empty()) cumulPath += L'\\';
-        cumulPath += parts[i];
-
-        std::wstring cacheKey = std::wstring(drivePrefix) + cumulPath;
-
-        bool isLast = (i == parts.size() - 1);
-
-        if (!isLast) {
-            // Folder node — look up in cache
-            auto it = folderCache.find(cacheKey);
-            if (it != folderCache.end()) {
-                hParent = it->second;
-            } else {
-                TVINSERTSTRUCTW tvis = {};
-                tvis.hParent = hParent;
-                tvis.hInsertAfter = TVI_LAST;
-                tvis.item.mask = TVIF_TEXT;
-                tvis.item.pszText = const_cast<wchar_t*>(parts[i].c_str());
-                HTREEITEM hFolder = TreeView_InsertItem(hTree_, &tvis);
-                folderCache[cacheKey] = hFolder;
-                hParent = hFolder;
-            }
-        } else {
-            // File leaf node
-            std::wstring display = parts[i];
-            if (fileSize > 0) {
-                display += L"  (" + Utils::FormatSizeShort(fileSize) + L")";
-            }
-            TVINSERTSTRUCTW tvis = {};
-            tvis.hParent = hParent;
-            tvis.hInsertAfter = TVI_LAST;
-            tvis.item.mask = TVIF_TEXT;
-            tvis.item.pszText = const_cast<wchar_t*>(display.c_str());
-            TreeView_InsertItem(hTree_, &tvis);
+int DestinationTree::FindFolderDrive(PathId path, const PathStore& paths) const {
+    for (PathId folder = paths.GetParent(path); folder != NO_PATH; folder = paths.GetParent(folder)) {
+        for (size_t i = 0; i < drives_.size(); i++) {
+            if (folderNodes_.count((static_cast<uint64_t>(i) << 32) | folder)) return static_cast<int>(i);
         }
     }
+    return -1;
 }
 
-void DestinationTree::Rebuild(const std::unordered_map<std::wstring, int>& assignments,
-                               const std::unordered_map<std::wstring, uint64_t>& fileSizes) {
+void DestinationTree::Rebuild(const std::unordered_map<PathId, int>& assignments,
+                               const std::unordered_map<PathId, uint64_t>& fileSizes,
+                               const PathStore& paths) {
     if (!hTree_) return;
 
     SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
     TreeView_DeleteAllItems(hTree_);
     driveNodes_.clear();
+    folderNodes_.clear();
+    fileNodes_.clear();
 
     // Create root nodes for each drive
     for (int i = 0; i < static_cast<int>(drives_.size()); i++) {
-        uint64_t assigned = GetAssignedBytes(i, assignments, fileSizes);
-        std::wstring label = BuildDriveLabel(i, assigned);
+        std::wstring label = BuildDriveLabel(i, 0, 0);
 
         TVINSERTSTRUCTW tvis = {};
         tvis.hParent = TVI_ROOT;
@@ -164,12 +161,11 @@ void DestinationTree::Rebuild(const std::unordered_map<std::wstring, int>& assig
     }
 
     // Insert assigned files under their drive nodes
-    std::unordered_map<std::wstring, HTREEITEM> folderCache;
     for (const auto& [path, driveIdx] : assignments) {
         uint64_t size = 0;
         auto sizeIt = fileSizes.find(path);
         if (sizeIt != fileSizes.end()) size = sizeIt->second;
-        InsertPath(driveIdx, path, size, folderCache);
+        AddFile(driveIdx, path, size, paths);
     }
 
     // Expand drive root nodes
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <cstdint>
 #include "DriveInfo.h"
+#include "PathStore.h"
 
 class DestinationTree {
 public:
@@ -21,21 +22,32 @@ public:
     const DriveEntry& GetDrive(int index) const;
     DriveEntry& GetDrive(int index);
 
-    // Rebuild the tree from the assignment map
-    // assignments: relativePath -> driveIndex
-    // fileSizes: relativePath -> size (for display)
-    void Rebuild(const std::unordered_map<std::wstring, int>& assignments,
-                 const std::unordered_map<std::wstring, uint64_t>& fileSizes);
+    // Rebuild the tree from the assignment map; drive labels start out
+    // bare, for SetDriveLabel
+    // assignments: path -> driveIndex
+    // fileSizes: path -> size (for display)
+    // paths: store the path ids come from
+    void Rebuild(const std::unordered_map<PathId, int>& assignments,
+                 const std::unordered_map<PathId, uint64_t>& fileSizes,
+                 const PathStore& paths);
+
+    // Patch one file in or out of the tree after a Rebuild, creating its
+    // folders as needed and removing them once they are empty
+    void AddFile(int driveIndex, PathId path, uint64_t fileSize, const PathStore& paths);
+    void RemoveFile(int driveIndex, PathId path, const PathStore& paths);
+
+    // Drive holding the nearest folder above path that has files in the
+    // tree (the lowest such drive if it is split), or -1
+    int FindFolderDrive(PathId path, const PathStore& paths) const;
+
+    // Show a drive's share of the plan in its label
+    void SetDriveLabel(int index, uint64_t assignedBytes, double finishSeconds);
 
     // Get the root HTREEITEM for a drive
     HTREEITEM GetDriveNode(int index) const;
 
-    // Sum of assigned file sizes for a specific drive
-    uint64_t GetAssignedBytes(int index, const std::unordered_map<std::wstring, int>& assignments,
-                              const std::unordered_map<std::wstring, uint64_t>& fileSizes) const;
-
-    // Build display label for a drive: "D: [Backup] - 120 GB free (45 GB assigned)"
-    std::wstring BuildDriveLabel(int index, uint64_t assignedBytes) const;
+    // Build display label for a drive: "D: [Backup] - 120 GB free (45 GB assigned, ~12:30)"
+    std::wstring BuildDriveLabel(int index, uint64_t assignedBytes, double finishSeconds) const;
 
     // Clear the tree and all drives
     void Clear();
@@ -44,8 +56,9 @@ private:
     HWND hTree_ = nullptr;
     std::vector<DriveEntry> drives_;
     std::vector<HTREEITEM> driveNodes_;
+    std::unordered_map<uint64_t, HTREEITEM> folderNodes_;  // (driveIndex << 32 | folder path id) -> node
+    std::unordered_map<PathId, HTREEITEM> fileNodes_;      // file path id -> node
 
-    // Insert a file path under the correct drive node, creating folder nodes as needed
-    void InsertPath(int driveIndex, const std::wstring& relativePath, uint64_t fileSize,
-                    std::unordered_map<std::wstring, HTREEITEM>& folderCache);
+    // Get a folder's node under a drive, creating it and its parents as needed
+    HTREEITEM GetFolderNode(int driveIndex, PathId folder, const PathStore& paths);
 };
@@ -0,0 +1,232 @@
+#include "DirectoryScanner.h"
+#include "Utils.h"
+#include <algorithm>
+#include <chrono>
+
+static const int MAX_SCAN_THREADS = 32;
+
+DirectoryScanner::DirectoryScanner(int threads) {
+    if (threads < 1) {
+        // Listing is mostly waiting on the file system, so run more workers
+        // than cores
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        threads = static_cast<int>(si.dwNumberOfProcessors) * 2;
+        if (threads < 4) threads = 4;
+    }
+    threads_ = threads < MAX_SCAN_THREADS ? threads : MAX_SCAN_THREADS;
+}
+
+void DirectoryScanner::Scan(const std::wstring& path, NodeTable& nodes, NodeId root,
+                            const NodeTable* previous,
+                            const std::atomic<bool>* cancelled,
+                            DirectoryListedFn listed, void* context) {
+    nodes_ = &nodes;
+    previous_ = previous && previous->GetRoot() != NO_NODE ? previous : nullptr;
+    cancelled_ = cancelled;
+    listed_ = listed;
+    context_ = context;
+    workers_.clear();
+    for (int i = 0; i < threads_; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->scanner = this;
+        worker->index = i;
+        workers_.push_back(std::move(worker));
+    }
+    Task rootTask{ path, root };
+    if (previous_) rootTask.previous = previous_->GetRoot();
+    Push(0, std::move(rootTask));
+
+    std::vector<HANDLE> threads;
+    for (auto& worker : workers_) {
+        HANDLE h = CreateThread(nullptr, 0, ThreadProc, worker.get(), 0, nullptr);
+        if (h) threads.push_back(h);
+    }
+    if (threads.empty()) {
+        // No threads available: list everything from here
+        WorkerLoop(0);
+    }
+    for (HANDLE h : threads) {
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+    }
+    workers_.clear();
+
+    // Children are complete now; total folder sizes bottom-up in one pass
+    nodes.SumFolderSizes();
+    nodes_ = nullptr;
+    previous_ = nullptr;
+}
+
+DWORD WINAPI DirectoryScanner::ThreadProc(LPVOID param) {
+    auto* worker = static_cast<Worker*>(param);
+    worker->scanner->WorkerLoop(worker->index);
+    return 0;
+}
+
+void DirectoryScanner::WorkerLoop(int index) {
+    for (;;) {
+        Task task;
+        if (PopOrSteal(index, task)) {
+            // After a cancel the queues are just drained
+            if (!cancelled_ || !*cancelled_) ProcessFolder(index, task);
+            if (--pending_ == 0) idleCv_.notify_all();
+            continue;
+        }
+        if (pending_ == 0) return;
+
+        // Nothing to steal yet: someone is still listing. The timeout covers
+        // a notify that lands between the failed steal and the wait.
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        idleCv_.wait_for(lock, std::chrono::milliseconds(2));
+    }
+}
+
+void DirectoryScanner::Push(int index, Task&& task) {
+    pending_++;
+    Worker& worker = *workers_[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    idleCv_.notify_one();
+}
+
+bool DirectoryScanner::PopOrSteal(int index, Task& task) {
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (int i = 1; i < threads_; i++) {
+        Worker& victim = *workers_[(index + i) % threads_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectoryScanner::ReadFolderIdentity(const std::wstring& path, uint64_t& mtime, uint64_t& fileId) {
+    HANDLE hDir = CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (hDir == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ok = GetFileInformationByHandle(hDir, &info) != FALSE;
+    CloseHandle(hDir);
+    if (!ok) return false;
+
+    mtime = (static_cast<uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) |
+            info.ftLastWriteTime.dwLowDateTime;
+    fileId = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    return true;
+}
+
+void DirectoryScanner::ProcessFolder(int index, Task& task) {
+    // Identity is read before the listing, so a change made while listing
+    // makes the next scan read the folder again
+    uint64_t mtime = 0, fileId = 0;
+    bool haveIdentity = ReadFolderIdentity(task.path, mtime, fileId);
+    nodes_->SetMtime(task.node, mtime);
+    nodes_->SetFileId(task.node, fileId);
+    bool reused = task.previous != NO_NODE && haveIdentity &&
+        mtime == previous_->GetMtime(task.previous) && fileId == previous_->GetFileId(task.previous);
+
+    std::vector<NodeEntry> entries;
+    if (reused) {
+        for (NodeId c = previous_->GetFirstChild(task.previous); c != NO_NODE;
+             c = previous_->GetNextSibling(c)) {
+            NodeEntry entry;
+            entry.name.assign(previous_->GetName(c), previous_->GetNameLength(c));
+            entry.size = previous_->GetSize(c);
+            entry.mtime = previous_->GetMtime(c);
+            entry.fileId = previous_->GetFileId(c);
+            entry.isDirectory = previous_->IsDirectory(c);
+            entries.push_back(std::move(entry));
+        }
+    } else {
+        ListDirectory(task.path, entries);
+    }
+    NodeId first = nodes_->AppendChildren(task.node, entries.data(), entries.size());
+
+    // Pair the subfolders with their previous versions by name; both lists
+    // hold folders first, sorted the same way
+    std::vector<Task> subfolders;
+    NodeId old = task.previous != NO_NODE ? previous_->GetFirstChild(task.previous) : NO_NODE;
+    for (size_t i = 0; first != NO_NODE && i < entries.size() && entries[i].isDirectory; i++) {
+        Task sub{ Utils::CombinePaths(task.path, entries[i].name), first + static_cast<NodeId>(i) };
+        const wchar_t* name = entries[i].name.c_str();
+        while (old != NO_NODE && previous_->IsDirectory(old) &&
+               _wcsicmp(previous_->GetName(old), name) < 0) {
+            old = previous_->GetNextSibling(old);
+        }
+        if (old != NO_NODE && previous_->IsDirectory(old) &&
+            _wcsicmp(previous_->GetName(old), name) == 0) {
+            sub.previous = old;
+            old = previous_->GetNextSibling(old);
+        }
+        subfolders.push_back(std::move(sub));
+    }
+
+    // The children are in the table, and chunks never move, so the listener
+    // can read them right away. Report before queueing the subfolders so a
+    // parent is always seen before its children.
+    if (listed_) listed_(task.node, reused, context_);
+    for (auto& sub : subfolders) {
+        Push(index, std::move(sub));
+    }
+}
+
+bool DirectoryScanner::ListDirectory(const std::wstring& path, std::vector<NodeEntry>& entries) {
+    // Basic info skips the 8.3 short name; large fetch asks the file system
+    // for bigger batches per round trip, which matters most over SMB
+    WIN32_FIND_DATAW fd;
+    std::wstring searchPath = path + L"\\*";
+    HANDLE hFind = FindFirstFileExW(searchPath.c_str(), FindExInfoBasic, &fd,
+        FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    entries.clear();
+    if (hFind == INVALID_HANDLE_VALUE) {
+        // Only an empty drive root has no "." and ".." to find
+        return GetLastError() == ERROR_FILE_NOT_FOUND;
+    }
+
+    do {
+        if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0)
+            continue;
+
+        NodeEntry child;
+        child.name = fd.cFileName;
+        child.mtime = (static_cast<uint64_t>(fd.ftLastWriteTime.dwHighDateTime) << 32) |
+                      fd.ftLastWriteTime.dwLowDateTime;
+
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            child.isDirectory = true;
+        } else {
+            child.size = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
+        }
+        entries.push_back(std::move(child));
+    } while (FindNextFileW(hFind, &fd));
+
+    FindClose(hFind);
+
+    // Sort in place: folders first, then files, each alphabetical
+    std::sort(entries.begin(), entries.end(), [](const NodeEntry& a, const NodeEntry& b) {
+        return CompareEntries(a.isDirectory, a.name.c_str(), b.isDirectory, b.name.c_str()) < 0;
+    });
+    return true;
+}
+
+int DirectoryScanner::CompareEntries(bool aIsDirectory, const wchar_t* aName,
+                                     bool bIsDirectory, const wchar_t* bName) {
+    if (aIsDirectory != bIsDirectory) return aIsDirectory ? -1 : 1;
+    return _wcsicmp(aName, bName);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "NodeTable.h"
+
+// Called on a worker thread as soon as dir's children are in the table (the
+// names, kinds and file sizes; folder sizes are only totalled once the whole
+// scan is done). A folder is always reported after its parent. reused: the
+// listing was taken from the previous scan instead of the file system.
+typedef void (*DirectoryListedFn)(NodeId dir, bool reused, void* context);
+
+// Parallel directory scanner. Each worker owns a deque of directories still
+// to be listed: it pushes the subfolders it finds and pops from the back
+// (depth first, warm caches), while idle workers steal from the front of
+// other deques, which holds the oldest and usually largest subtrees. Many
+// listings are in flight at once, which hides per-directory latency on
+// network shares and deep volumes.
+class DirectoryScanner {
+public:
+    // threads: number of workers (0 = pick from the processor count)
+    explicit DirectoryScanner(int threads = 0);
+
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+    // Scan path into nodes under root (a folder with no children yet),
+    // recursively: folders first, then files, each sorted by name; folder
+    // sizes are then the sum of their children. Blocks until the whole tree
+    // has been listed, or until *cancelled is set (folders not listed by then
+    // are left empty).
+    // previous: an earlier scan of the same path, root at its id 0. A folder
+    // whose last-write time and file ID still match it keeps its old listing
+    // without being read again. Adding, removing or renaming an entry
+    // updates a folder's last-write time; rewriting a file in place does
+    // not, so sizes of files changed that way stay as they were.
+    void Scan(const std::wstring& path, NodeTable& nodes, NodeId root,
+              const NodeTable* previous = nullptr,
+              const std::atomic<bool>* cancelled = nullptr,
+              DirectoryListedFn listed = nullptr, void* context = nullptr);
+
+    int GetThreadCount() const { return threads_; }
+
+    // List one folder's entries into entries (replacing them): folders
+    // first, then files, each sorted by name. Returns false if the folder
+    // couldn't be opened.
+    static bool ListDirectory(const std::wstring& path, std::vector<NodeEntry>& entries);
+
+    // Order of two entries in a listing: folders first, then by name
+    static int CompareEntries(bool aIsDirectory, const wchar_t* aName,
+                              bool bIsDirectory, const wchar_t* bName);
+
+private:
+    struct Task {
+        std::wstring path;
+        NodeId node;                    // children are added by whoever lists path
+        NodeId previous = NO_NODE;      // this folder in the previous scan
+    };
+
+    struct Worker {
+        DirectoryScanner* scanner;
+        int index;
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void WorkerLoop(int index);
+    void Push(int index, Task&& task);
+    bool PopOrSteal(int index, Task& task);
+    void ProcessFolder(int index, Task& task);
+    static bool ReadFolderIdentity(const std::wstring& path, uint64_t& mtime, uint64_t& fileId);
+
+    int threads_;
+    NodeTable* nodes_ = nullptr;
+    const NodeTable* previous_ = nullptr;
+    const std::atomic<bool>* cancelled_ = nullptr;
+    DirectoryListedFn listed_ = nullptr;
+    void* context_ = nullptr;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> pending_{ 0 };      // directories queued or being listed
+    std::mutex idleMutex_;
+    std::condition_variable idleCv_;        // work pushed or scan finished
+};
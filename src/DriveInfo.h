@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include "DriveProfile.h"
 
 struct DriveEntry {
     std::wstring rootPath;      // e.g. "C:\\"
@@ -12,6 +13,7 @@ struct DriveEntry {
     uint64_t totalBytes;
     uint64_t freeBytes;
     std::wstring displayString; // e.g. "C: [Local Disk] - 45.2 GB free / 256 GB"
+    DriveSpeed speed;           // predicted copy speed, for planning
 };
 
 namespace DriveInfo {
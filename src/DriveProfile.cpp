@@ -0,0 +1,115 @@
+#include "DriveProfile.h"
+#include "Utils.h"
+#include <winioctl.h>
+#include <algorithm>
+#include <cwchar>
+
+namespace DriveProfile {
+
+// Measurements shorter than this are mostly noise (caches, spin-up)
+static const double MIN_MEASURE_SECONDS = 2.0;
+static const double MIN_STREAM_SECONDS = 0.5;
+
+static const double MB = 1024.0 * 1024.0;
+
+// Guesses for drives never written to, from what Windows reports about the
+// device: whether it seeks (a hard disk) and whether it hangs off USB
+static DriveSpeed DefaultSpeed(const std::wstring& rootPath) {
+    bool seeks = true;
+    bool usb = false;
+
+    std::wstring device = L"\\\\.\\" + rootPath.substr(0, 2);
+    HANDLE hDevice = CreateFileW(device.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hDevice != INVALID_HANDLE_VALUE) {
+        STORAGE_PROPERTY_QUERY query = {};
+        query.QueryType = PropertyStandardQuery;
+        DWORD returned = 0;
+
+        query.PropertyId = StorageDeviceSeekPenaltyProperty;
+        DEVICE_SEEK_PENALTY_DESCRIPTOR penalty = {};
+        if (DeviceIoControl(hDevice, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                &penalty, sizeof(penalty), &returned, nullptr) && returned >= sizeof(penalty)) {
+            seeks = penalty.IncursSeekPenalty != FALSE;
+        }
+
+        query.PropertyId = StorageDeviceProperty;
+        STORAGE_DEVICE_DESCRIPTOR descriptor = {};
+        if (DeviceIoControl(hDevice, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query),
+                &descriptor, sizeof(descriptor), &returned, nullptr)) {
+            usb = descriptor.BusType == BusTypeUsb;
+        }
+        CloseHandle(hDevice);
+    }
+
+    DriveSpeed speed;
+    if (!seeks) {
+        speed.bytesPerSecond = (usb ? 200 : 400) * MB;
+        speed.secondsPerFile = usb ? 0.001 : 0.0005;
+    } else {
+        speed.bytesPerSecond = (usb ? 80 : 150) * MB;
+        speed.secondsPerFile = usb ? 0.010 : 0.008;
+    }
+    return speed;
+}
+
+static double ReadDouble(const std::wstring& profilePath, const std::wstring& section,
+                         const wchar_t* key) {
+    wchar_t buf[64] = {};
+    GetPrivateProfileStringW(section.c_str(), key, L"", buf, 64, profilePath.c_str());
+    return wcstod(buf, nullptr);
+}
+
+static void WriteDouble(const std::wstring& profilePath, const std::wstring& section,
+                        const wchar_t* key, double value) {
+    wchar_t buf[64];
+    swprintf_s(buf, L"%.6g", value);
+    WritePrivateProfileStringW(section.c_str(), key, buf, profilePath.c_str());
+}
+
+std::wstring GetProfilePath(const std::wstring& exeDir) {
+    return Utils::CombinePaths(Utils::CombinePaths(exeDir, L"logs"), L"DSplit_drives.ini");
+}
+
+DriveSpeed GetSpeed(const std::wstring& profilePath, const std::wstring& serialHex,
+                    const std::wstring& rootPath) {
+    double bytesPerSecond = ReadDouble(profilePath, serialHex, L"MBPerSecond") * MB;
+    double msPerFile = ReadDouble(profilePath, serialHex, L"MsPerFile");
+    if (bytesPerSecond <= 0 || msPerFile < 0) return DefaultSpeed(rootPath);
+
+    DriveSpeed speed;
+    speed.bytesPerSecond = bytesPerSecond;
+    speed.secondsPerFile = msPerFile / 1000;
+    speed.measured = true;
+    return speed;
+}
+
+void Record(const std::wstring& profilePath, const std::wstring& serialHex,
+            const std::wstring& rootPath, const DriveMeasurement& measurement) {
+    if (measurement.seconds < MIN_MEASURE_SECONDS || measurement.files == 0) return;
+
+    DriveSpeed previous = GetSpeed(profilePath, serialHex, rootPath);
+    double bytesPerSecond = measurement.streamSeconds >= MIN_STREAM_SECONDS
+        ? measurement.streamBytes / measurement.streamSeconds
+        : previous.bytesPerSecond;
+    // The per-file cost is what the run took beyond streaming its bytes;
+    // a run that also verified keeps the one from before
+    double secondsPerFile = measurement.verified ? previous.secondsPerFile : std::max(0.0,
+        (measurement.seconds - measurement.bytes / bytesPerSecond) / measurement.files);
+
+    // Average with what was measured before, so one odd run only moves the
+    // estimate halfway
+    if (previous.measured) {
+        bytesPerSecond = (bytesPerSecond + previous.bytesPerSecond) / 2;
+        secondsPerFile = (secondsPerFile + previous.secondsPerFile) / 2;
+    }
+
+    size_t sep = profilePath.find_last_of(L"\\/");
+    if (sep != std::wstring::npos) {
+        Utils::EnsureDirectoryExists(profilePath.substr(0, sep));
+    }
+    WriteDouble(profilePath, serialHex, L"MBPerSecond", bytesPerSecond / MB);
+    WriteDouble(profilePath, serialHex, L"MsPerFile", secondsPerFile * 1000);
+}
+
+} // namespace DriveProfile
@@ -0,0 +1,49 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+
+// How fast a destination drive takes files: a fixed cost per file (create,
+// open, close, metadata) on top of its sustained write rate
+struct DriveSpeed {
+    double bytesPerSecond = 150.0 * 1024 * 1024;
+    double secondsPerFile = 0.005;
+    bool measured = false;          // from earlier migrations, not a default
+
+    // Predicted seconds to write files files of bytes in total
+    double Predict(uint64_t bytes, uint64_t files) const {
+        return bytes / bytesPerSecond + files * secondsPerFile;
+    }
+};
+
+// What one migration saw on a drive: all it wrote, and the large files
+// copied while nothing else wrote to it, which stream and so give the
+// write rate
+struct DriveMeasurement {
+    uint64_t bytes = 0;
+    uint64_t files = 0;
+    double seconds = 0;
+    uint64_t streamBytes = 0;
+    double streamSeconds = 0;
+    bool verified = false;      // files were read back too, so seconds isn't all writing
+};
+
+// Drive speeds measured by earlier migrations, kept per volume serial in an
+// INI file shared by all sources
+namespace DriveProfile {
+
+// logs\DSplit_drives.ini beside the executable
+std::wstring GetProfilePath(const std::wstring& exeDir);
+
+// Speed of the drive at rootPath: as measured before if it has been written
+// to, else a default for its kind (SSD or hard disk, internal or USB)
+DriveSpeed GetSpeed(const std::wstring& profilePath, const std::wstring& serialHex,
+                    const std::wstring& rootPath);
+
+// Fold a migration's measurement into the drive's profile. The write rate
+// comes from the large files; the time the rate doesn't account for is put
+// down to per-file cost. Runs too short to say much are ignored.
+void Record(const std::wstring& profilePath, const std::wstring& serialHex,
+            const std::wstring& rootPath, const DriveMeasurement& measurement);
+
+} // namespace DriveProfile
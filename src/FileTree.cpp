@@ -1,353 +1,750 @@
 #include "FileTree.h"
+#include "TransferLog.h"
 #include "Utils.h"
-#include <algorithm>
+
+// nodePaths_ entry for a node whose path hasn't been interned yet
+static const PathId UNKNOWN_PATH = 0xFFFFFFFE;
 
 FileTree::FileTree() {}
 FileTree::~FileTree() {}
 
 void FileTree::SetTreeView(HWND hTree) {
     hTree_ = hTree;
+
+    // Third state image for folders with only some contents checked
+    TreeView_SetExtendedStyle(hTree_, TVS_EX_PARTIALCHECKBOXES, TVS_EX_PARTIALCHECKBOXES);
 }
 
-void FileTree::Populate(const std::wstring& folderPath) {
+void FileTree::Populate(const std::wstring& folderPath, const std::wstring& snapshotPath, HWND hWndNotify) {
     Clear();
     sourceFolder_ = folderPath;
-    root_.name = folderPath;
-    root_.fullPath = folderPath;
-    root_.isDirectory = true;
-    root_.size = 0;
+    nodes_.Reset(folderPath);
 
-    SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
+    // Watch first, so nothing changed during the scan is missed
+    watcher_.Start(hWndNotify, folderPath);
 
-    ScanFolder(folderPath, root_);
+    // Folders become readable as PumpScan takes them in
+    scanning_ = scan_.Start(hWndNotify, folderPath, nodes_, snapshotPath);
+}
 
-    // Insert items into TreeView
-    for (auto& child : root_.children) {
-        InsertNode(TVI_ROOT, child, child.name);
+bool FileTree::PumpScan(DWORD budgetMs) {
+    if (!scanning_) return false;
+
+    ULONGLONG start = GetTickCount64();
+    std::vector<NodeId> batch;
+    bool more = true;
+    bool redrawOff = false;
+    while (more && GetTickCount64() - start < budgetMs) {
+        batch.clear();
+        more = scan_.TakeBatch(batch, SCAN_BATCH_ITEMS);
+        if (batch.empty()) break;
+        if (!redrawOff) {
+            SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
+            redrawOff = true;
+        }
+        for (NodeId dir : batch) {
+            InsertListedFolder(dir);
+        }
     }
+    if (redrawOff) {
+        SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(hTree_, nullptr, TRUE);
+    }
+    return more;
+}
+
+bool FileTree::FinishScan() {
+    if (!scanning_ || scan_.IsRunning()) return false;
+    scan_.Wait();
 
-    SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
+    while (PumpScan(INFINITE)) {}
+    scanning_ = false;
+    listed_.clear();
+    listed_.shrink_to_fit();
+    expandWanted_.clear();
+
+    // Folder sizes are final now, and folders that turned out empty (or were
+    // never listed after a cancel) lose their expand button; both are
+    // picked up on the next paint
     InvalidateRect(hTree_, nullptr, TRUE);
+    return true;
+}
+
+void FileTree::CancelScan() {
+    scan_.Cancel();
 }
 
 void FileTree::Clear() {
+    // The scan thread writes into nodes_; it has to be gone first
+    scan_.Cancel();
+    scan_.Wait();
+    scanning_ = false;
+    listed_.clear();
+    expandWanted_.clear();
+    watcher_.Stop();
+    staleFolders_.clear();
+
     if (hTree_) {
         TreeView_DeleteAllItems(hTree_);
     }
-    itemMap_.clear();
-    root_.children.clear();
+    nodeItems_.clear();
+    checked_.Clear();
+    partial_.Clear();
+    tallySlots_.clear();
+    tallies_.clear();
+    nodePaths_.clear();
+    paths_.Clear();
+    nodes_.Clear();
     sourceFolder_.clear();
 }
 
-void FileTree::ScanFolder(const std::wstring& path, FileNode& node) {
-    WIN32_FIND_DATAW fd;
-    std::wstring searchPath = path + L"\\*";
-    HANDLE hFind = FindFirstFileW(searchPath.c_str(), &fd);
-    if (hFind == INVALID_HANDLE_VALUE) return;
+void FileTree::InsertListedFolder(NodeId dir) {
+    if (dir >= listed_.size()) listed_.resize(nodes_.GetCount(), 0);
+    listed_[dir] = 1;
+
+    // Children of a folder the user already checked arrive checked
+    bool checked = dir != nodes_.GetRoot() && IsChecked(dir);
+    ForEachChildRun(dir, [&](NodeId begin, NodeId end) {
+        checked_.SetRange(begin, end, checked);
+        partial_.SetRange(begin, end, false);
+    });
+
+    // Its files count towards it and every folder above it
+    int64_t bytes = 0, files = 0;
+    for (NodeId c = nodes_.GetFirstChild(dir); c != NO_NODE; c = nodes_.GetNextSibling(c)) {
+        if (nodes_.IsDirectory(c)) continue;
+        bytes += static_cast<int64_t>(nodes_.GetSize(c));
+        files++;
+    }
+    if (files > 0) {
+        AddToTallies(dir, bytes, files, checked ? bytes : 0, checked ? files : 0);
+    }
 
-    std::vector<FileNode> folders, files;
+    // Only the top level and folders the user has open get items now
+    if (dir == nodes_.GetRoot()) {
+        InsertChildItems(TVI_ROOT, dir);
+        return;
+    }
+    auto wanted = expandWanted_.find(dir);
+    if (wanted != expandWanted_.end()) {
+        expandWanted_.erase(wanted);
+        HTREEITEM hItem = FindItem(dir);
+        if (hItem) TreeView_Expand(hTree_, hItem, TVE_EXPAND);
+    }
+}
 
-    do {
-        if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0)
-            continue;
+// ---------- Items ----------
 
-        FileNode child;
-        child.name = fd.cFileName;
-        child.fullPath = Utils::CombinePaths(path, fd.cFileName);
-
-        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            child.isDirectory = true;
-            child.size = 0;
-            ScanFolder(child.fullPath, child);
-            // Sum children sizes
-            for (auto& c : child.children) {
-                child.size += c.size;
-            }
-            folders.push_back(std::move(child));
-        } else {
-            child.isDirectory = false;
-            child.size = (static_cast<uint64_t>(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow;
-            files.push_back(std::move(child));
-        }
-    } while (FindNextFileW(hFind, &fd));
+HTREEITEM FileTree::InsertItem(HTREEITEM hParent, NodeId node, HTREEITEM hInsertAfter) {
+    // Text and the expand button come from OnGetDispInfo, so an item costs
+    // the control nothing but its handle
+    TVINSERTSTRUCTW tvis = {};
+    tvis.hParent = hParent;
+    tvis.hInsertAfter = hInsertAfter;
+    tvis.item.mask = TVIF_TEXT | TVIF_STATE | TVIF_CHILDREN | TVIF_PARAM;
+    tvis.item.pszText = LPSTR_TEXTCALLBACKW;
+    tvis.item.stateMask = TVIS_STATEIMAGEMASK;
+    UINT image = GetCheckImage(node);
+    tvis.item.state = INDEXTOSTATEIMAGEMASK(image);
+    tvis.item.cChildren = I_CHILDRENCALLBACK;
+    tvis.item.lParam = static_cast<LPARAM>(node);
 
-    FindClose(hFind);
+    HTREEITEM hItem = TreeView_InsertItem(hTree_, &tvis);
+    if (hItem) nodeItems_[node] = { hItem, image };
+    return hItem;
+}
 
-    // Sort: folders first (alphabetical), then files (alphabetical)
-    std::sort(folders.begin(), folders.end(),
-        [](const FileNode& a, const FileNode& b) { return _wcsicmp(a.name.c_str(), b.name.c_str()) < 0; });
-    std::sort(files.begin(), files.end(),
-        [](const FileNode& a, const FileNode& b) { return _wcsicmp(a.name.c_str(), b.name.c_str()) < 0; });
+void FileTree::InsertChildItems(HTREEITEM hParent, NodeId dir) {
+    for (NodeId c = nodes_.GetFirstChild(dir); c != NO_NODE; c = nodes_.GetNextSibling(c)) {
+        InsertItem(hParent, c);
+    }
+}
 
-    for (auto& f : folders) node.children.push_back(std::move(f));
-    for (auto& f : files) node.children.push_back(std::move(f));
+HTREEITEM FileTree::FindItem(NodeId node) const {
+    auto it = nodeItems_.find(node);
+    return it != nodeItems_.end() ? it->second.hItem : nullptr;
 }
 
-HTREEITEM FileTree::InsertNode(HTREEITEM hParent, const FileNode& node, const std::wstring& relPath) {
-    // Build display text: "name (size)"
-    std::wstring display = node.name;
-    if (node.size > 0 || !node.isDirectory) {
-        display += L"  (" + Utils::FormatSizeShort(node.size) + L")";
+void FileTree::OnGetDispInfo(NMTVDISPINFOW* info) {
+    NodeId node = static_cast<NodeId>(info->item.lParam);
+    bool isDirectory = nodes_.IsDirectory(node);
+
+    if (info->item.mask & TVIF_TEXT) {
+        // "name  (size)". Folder sizes aren't known until the scan is done.
+        std::wstring display(nodes_.GetName(node), nodes_.GetNameLength(node));
+        uint64_t size = nodes_.GetSize(node);
+        if (!isDirectory || (!scanning_ && size > 0)) {
+            display += L"  (" + Utils::FormatSizeShort(size) + L")";
+        }
+        wcsncpy_s(info->item.pszText, info->item.cchTextMax, display.c_str(), _TRUNCATE);
+    }
+    if (info->item.mask & TVIF_CHILDREN) {
+        // A folder still being listed keeps its button, so it can be opened
+        // while its contents are on the way
+        info->item.cChildren = isDirectory &&
+            (!IsListed(node) || nodes_.GetFirstChild(node) != NO_NODE) ? 1 : 0;
     }
+}
 
-    TVINSERTSTRUCTW tvis = {};
-    tvis.hParent = hParent;
-    tvis.hInsertAfter = TVI_LAST;
-    tvis.item.mask = TVIF_TEXT | TVIF_STATE;
-    tvis.item.pszText = const_cast<wchar_t*>(display.c_str());
-    tvis.item.stateMask = TVIS_STATEIMAGEMASK;
-    tvis.item.state = INDEXTOSTATEIMAGEMASK(1); // unchecked
+void FileTree::OnItemExpanding(NMTREEVIEWW* tv) {
+    if (!(tv->action & TVE_EXPAND)) return;
+    HTREEITEM hItem = tv->itemNew.hItem;
+    if (TreeView_GetChild(hTree_, hItem)) return;
 
-    HTREEITEM hItem = TreeView_InsertItem(hTree_, &tvis);
+    NodeId node = static_cast<NodeId>(tv->itemNew.lParam);
+    if (IsListed(node)) {
+        InsertChildItems(hItem, node);
+    } else {
+        expandWanted_.insert(node);     // opened by InsertListedFolder
+    }
+}
 
-    // Store item data
-    ItemData data;
-    data.size = node.size;
-    data.isDirectory = node.isDirectory;
-    data.fullPath = node.fullPath;
-    data.relativePath = relPath;
-    itemMap_[hItem] = std::move(data);
+void FileTree::OnItemExpanded(NMTREEVIEWW* tv) {
+    // Release a collapsed folder's items; they come back on the next expand
+    if (collapsing_ || !(tv->action & TVE_COLLAPSE)) return;
+    collapsing_ = true;
+    TreeView_Expand(hTree_, tv->itemNew.hItem, TVE_COLLAPSE | TVE_COLLAPSERESET);
+    collapsing_ = false;
+}
 
-    // Insert children
-    for (auto& child : node.children) {
-        std::wstring childRelPath = relPath + L"\\" + child.name;
-        InsertNode(hItem, child, childRelPath);
+void FileTree::OnDeleteItem(NMTREEVIEWW* tv) {
+    auto it = nodeItems_.find(static_cast<NodeId>(tv->itemOld.lParam));
+    if (it != nodeItems_.end() && it->second.hItem == tv->itemOld.hItem) {
+        nodeItems_.erase(it);
     }
-
-    return hItem;
 }
 
-void FileTree::SetCheckState(HTREEITEM hItem, bool checked) {
+void FileTree::RefreshCheckImages() {
+    // Only items whose box changed are sent to the control, which repaints
+    // just those rows (and only if they are on screen)
     TVITEMW tvi = {};
     tvi.mask = TVIF_HANDLE | TVIF_STATE;
-    tvi.hItem = hItem;
     tvi.stateMask = TVIS_STATEIMAGEMASK;
-    tvi.state = INDEXTOSTATEIMAGEMASK(checked ? 2 : 1);
-    TreeView_SetItem(hTree_, &tvi);
+    for (auto& [node, item] : nodeItems_) {
+        UINT image = GetCheckImage(node);
+        if (image == item.image) continue;
+        item.image = image;
+        tvi.hItem = item.hItem;
+        tvi.state = INDEXTOSTATEIMAGEMASK(image);
+        TreeView_SetItem(hTree_, &tvi);
+    }
 }
 
-bool FileTree::GetCheckState(HTREEITEM hItem) const {
-    UINT state = TreeView_GetCheckState(hTree_, hItem);
-    return state == 1; // TreeView_GetCheckState returns 1 for checked
+// ---------- Paths ----------
+
+PathId FileTree::GetNodePath(NodeId node) {
+    if (node == nodes_.GetRoot()) return NO_PATH;
+    if (node < nodePaths_.size() && nodePaths_[node] != UNKNOWN_PATH) {
+        return nodePaths_[node];
+    }
+    PathId path = paths_.Child(GetNodePath(nodes_.GetParent(node)),
+                               nodes_.GetName(node), nodes_.GetNameLength(node));
+    if (node >= nodePaths_.size()) nodePaths_.resize(nodes_.GetCount(), UNKNOWN_PATH);
+    nodePaths_[node] = path;
+    return path;
 }
 
-void FileTree::SetChildrenCheckState(HTREEITEM hItem, bool checked) {
-    HTREEITEM hChild = TreeView_GetChild(hTree_, hItem);
-    while (hChild) {
-        SetCheckState(hChild, checked);
-        SetChildrenCheckState(hChild, checked);
-        hChild = TreeView_GetNextSibling(hTree_, hChild);
+PathId FileTree::FindNodePath(NodeId node) const {
+    if (node < nodePaths_.size() && nodePaths_[node] != UNKNOWN_PATH) {
+        return nodePaths_[node];
     }
+    return NO_PATH;
 }
 
-void FileTree::UpdateParentCheckState(HTREEITEM hItem) {
-    HTREEITEM hParent = TreeView_GetParent(hTree_, hItem);
-    if (!hParent) return;
+// ---------- Change tracking ----------
 
-    // Check if any child is checked
-    bool anyChecked = false;
-    HTREEITEM hChild = TreeView_GetChild(hTree_, hParent);
-    while (hChild) {
-        if (GetCheckState(hChild)) {
-            anyChecked = true;
-            break;
+bool FileTree::ApplyChanges(DWORD budgetMs, ChangeDelta& delta) {
+    if (scanning_ || sourceFolder_.empty()) return false;
+
+    std::vector<std::wstring> changed;
+    if (watcher_.TakeChanges(changed)) {
+        // Some changes were lost; every folder has to be checked
+        staleFolders_.clear();
+        QueueAllFolders(nodes_.GetRoot(), L"");
+    } else {
+        for (auto& folder : changed) {
+            staleFolders_.push_back(std::move(folder));
         }
-        hChild = TreeView_GetNextSibling(hTree_, hChild);
     }
 
-    SetCheckState(hParent, anyChecked);
-    UpdateParentCheckState(hParent);
+    ULONGLONG start = GetTickCount64();
+    bool redrawOff = false;
+    while (!staleFolders_.empty() && GetTickCount64() - start < budgetMs) {
+        if (!redrawOff) {
+            SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
+            redrawOff = true;
+        }
+        std::wstring folder = std::move(staleFolders_.front());
+        staleFolders_.pop_front();
+        RefreshFolder(folder, delta);
+    }
+    if (redrawOff) {
+        SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(hTree_, nullptr, TRUE);
+    }
+    return !staleFolders_.empty();
 }
 
-void FileTree::OnCheckChanged(HTREEITEM hItem) {
-    if (suppressCheckHandling_) return;
-    suppressCheckHandling_ = true;
+void FileTree::QueueAllFolders(NodeId node, const std::wstring& relativePath) {
+    staleFolders_.push_back(relativePath);
+    for (NodeId c = nodes_.GetFirstChild(node); c != NO_NODE && nodes_.IsDirectory(c);
+         c = nodes_.GetNextSibling(c)) {
+        std::wstring name(nodes_.GetName(c), nodes_.GetNameLength(c));
+        QueueAllFolders(c, relativePath.empty() ? name : relativePath + L"\\" + name);
+    }
+}
 
-    bool checked = GetCheckState(hItem);
+void FileTree::RefreshFolder(const std::wstring& relativePath, ChangeDelta& delta) {
+    // Order of an existing node against a listed entry
+    auto compare = [this](NodeId node, const NodeEntry& entry) {
+        return DirectoryScanner::CompareEntries(nodes_.IsDirectory(node), nodes_.GetName(node),
+                                                entry.isDirectory, entry.name.c_str());
+    };
+
+    // Find the folder, keeping the way down for the size update. A folder
+    // that isn't in the tree is new or gone, and its parent's refresh
+    // takes care of it.
+    std::vector<NodeId> chain{ nodes_.GetRoot() };
+    size_t pos = 0;
+    while (pos < relativePath.size()) {
+        size_t end = relativePath.find(L'\\', pos);
+        if (end == std::wstring::npos) end = relativePath.size();
+
+        NodeEntry key;
+        key.name = relativePath.substr(pos, end - pos);
+        key.isDirectory = true;
+        NodeId found = nodes_.GetFirstChild(chain.back());
+        while (found != NO_NODE && compare(found, key) < 0) {
+            found = nodes_.GetNextSibling(found);
+        }
+        if (found == NO_NODE || compare(found, key) != 0) return;
+        chain.push_back(found);
+        pos = end + 1;
+    }
+    NodeId dir = chain.back();
 
-    // Propagate to children
-    SetChildrenCheckState(hItem, checked);
+    std::vector<NodeEntry> listing;
+    if (!DirectoryScanner::ListDirectory(Utils::CombinePaths(sourceFolder_, relativePath), listing)) {
+        return;     // gone; removed when its parent is refreshed
+    }
 
-    // Update parents
-    UpdateParentCheckState(hItem);
+    // Items only need patching if the folder's children are showing
+    HTREEITEM hDir = dir == nodes_.GetRoot() ? TVI_ROOT : FindItem(dir);
+    bool showing = hDir == TVI_ROOT || (hDir && TreeView_GetChild(hTree_, hDir));
+
+    // Walk the old and new listings side by side (both sorted the same way),
+    // keeping entries that are in both and fixing up the rest
+    bool checked = dir != nodes_.GetRoot() && IsChecked(dir);
+    int64_t sizeChange = 0;
+    int64_t fileChange = 0, checkedBytesChange = 0, checkedFileChange = 0;
+    bool changed = false;
+    NodeId previous = NO_NODE;      // last node kept or added
+    HTREEITEM hAfter = TVI_FIRST;
+    NodeId old = nodes_.GetFirstChild(dir);
+
+    auto removeOld = [&]() {
+        NodeId next = nodes_.GetNextSibling(old);
+        HTREEITEM hItem = FindItem(old);
+        if (nodes_.IsDirectory(old)) {
+            FolderTally tally = GetTally(old);
+            fileChange -= static_cast<int64_t>(tally.files);
+            checkedBytesChange -= static_cast<int64_t>(tally.checkedBytes);
+            checkedFileChange -= static_cast<int64_t>(tally.checkedFiles);
+        } else {
+            fileChange--;
+            if (IsChecked(old)) {
+                checkedBytesChange -= static_cast<int64_t>(nodes_.GetSize(old));
+                checkedFileChange--;
+            }
+        }
+        ForgetNode(old, delta);
+        if (hItem) TreeView_DeleteItem(hTree_, hItem);
+        sizeChange -= static_cast<int64_t>(nodes_.GetSize(old));
+        nodes_.Unlink(old, previous);
+        changed = true;
+        old = next;
+    };
+
+    for (auto& entry : listing) {
+        while (old != NO_NODE && compare(old, entry) < 0) {
+            removeOld();
+        }
 
-    suppressCheckHandling_ = false;
-}
+        if (old != NO_NODE && compare(old, entry) == 0) {
+            uint64_t oldSize = nodes_.GetSize(old);
+            if (!nodes_.IsDirectory(old) && oldSize != entry.size) {
+                int64_t change = static_cast<int64_t>(entry.size) - static_cast<int64_t>(oldSize);
+                sizeChange += change;
+                nodes_.SetSize(old, entry.size);
+                nodes_.SetMtime(old, entry.mtime);
+                if (IsChecked(old)) {
+                    checkedBytesChange += change;
+                    delta.updated.push_back({ GetNodePath(old), entry.size, false });
+                }
+            }
+            if (showing) {
+                HTREEITEM hItem = FindItem(old);
+                if (hItem) hAfter = hItem;
+            }
+            previous = old;
+            old = nodes_.GetNextSibling(old);
+            continue;
+        }
 
-void FileTree::SelectAll() {
-    suppressCheckHandling_ = true;
-    SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
+        // New entry, in the checked state of its folder. A new folder is
+        // listed in its turn.
+        NodeId added = nodes_.InsertChild(dir, previous, entry);
+        if (added == NO_NODE) continue;
+        SetChecked(added, checked);
+        changed = true;
+        if (showing) {
+            HTREEITEM hItem = InsertItem(hDir, added, hAfter);
+            if (hItem) hAfter = hItem;
+        }
+        if (entry.isDirectory) {
+            staleFolders_.push_back(relativePath.empty() ? entry.name : relativePath + L"\\" + entry.name);
+        } else {
+            sizeChange += static_cast<int64_t>(entry.size);
+            fileChange++;
+            if (checked) {
+                checkedBytesChange += static_cast<int64_t>(entry.size);
+                checkedFileChange++;
+                delta.updated.push_back({ GetNodePath(added), entry.size, false });
+            }
+        }
+        previous = added;
+    }
+    while (old != NO_NODE) {
+        removeOld();
+    }
 
-    HTREEITEM hItem = TreeView_GetRoot(hTree_);
-    while (hItem) {
-        SetCheckState(hItem, true);
-        SetChildrenCheckState(hItem, true);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
+    // Carry the size change up to the root; the text follows on the next paint
+    if (sizeChange != 0) {
+        for (NodeId step : chain) {
+            nodes_.SetSize(step, nodes_.GetSize(step) + sizeChange);
+        }
+    }
+    if (changed || sizeChange != 0) {
+        AddToTallies(dir, sizeChange, fileChange, checkedBytesChange, checkedFileChange);
     }
 
-    SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
-    InvalidateRect(hTree_, nullptr, TRUE);
-    suppressCheckHandling_ = false;
+    // The folder's box follows its children's, and one may have gone or
+    // come in unchecked
+    if (changed && dir != nodes_.GetRoot()) {
+        UpdateFolderStates(dir);
+        RefreshCheckImages();
+    }
 }
 
-void FileTree::DeselectAll() {
-    suppressCheckHandling_ = true;
-    SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
-
-    HTREEITEM hItem = TreeView_GetRoot(hTree_);
-    while (hItem) {
-        SetCheckState(hItem, false);
-        SetChildrenCheckState(hItem, false);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
+void FileTree::ForgetNode(NodeId node, ChangeDelta& delta) {
+    for (NodeId c = nodes_.GetFirstChild(node); c != NO_NODE; c = nodes_.GetNextSibling(c)) {
+        ForgetNode(c, delta);
     }
-
-    SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
-    InvalidateRect(hTree_, nullptr, TRUE);
-    suppressCheckHandling_ = false;
+    // A file whose path was never asked for can't be in any assignment
+    PathId path = FindNodePath(node);
+    if (!nodes_.IsDirectory(node) && path != NO_PATH) {
+        delta.removed.push_back(path);
+    }
+    SetChecked(node, false);
+    partial_.Set(node, false);
+    if (FolderTally* tally = FindTally(node)) *tally = FolderTally();
 }
 
-void FileTree::CollectLeaves(HTREEITEM hItem, std::vector<LeafItem>& leaves) const {
-    HTREEITEM hChild = TreeView_GetChild(hTree_, hItem);
-    if (!hChild) {
-        // This is a leaf
-        auto it = itemMap_.find(hItem);
-        if (it != itemMap_.end() && !it->second.isDirectory) {
-            leaves.push_back({ hItem, it->second.size, it->second.relativePath });
+// ---------- Check state ----------
+
+template <typename Visit>
+void FileTree::ForEachInSubtree(NodeId top, Visit visit) const {
+    // Pre-order walk over the sibling links, without a stack; folders the
+    // scan hasn't handed out yet are not entered
+    NodeId node = top;
+    for (;;) {
+        if (visit(node) && nodes_.IsDirectory(node) && IsListed(node)) {
+            NodeId child = nodes_.GetFirstChild(node);
+            if (child != NO_NODE) {
+                node = child;
+                continue;
+            }
         }
-        return;
+        while (node != top && nodes_.GetNextSibling(node) == NO_NODE) {
+            node = nodes_.GetParent(node);
+        }
+        if (node == top) return;
+        node = nodes_.GetNextSibling(node);
     }
-    while (hChild) {
-        CollectLeaves(hChild, leaves);
-        hChild = TreeView_GetNextSibling(hTree_, hChild);
+}
+
+template <typename Run>
+void FileTree::ForEachChildRun(NodeId dir, Run run) const {
+    NodeId c = nodes_.GetFirstChild(dir);
+    while (c != NO_NODE) {
+        NodeId begin = c;
+        NodeId end = c + 1;
+        for (c = nodes_.GetNextSibling(c); c == end; c = nodes_.GetNextSibling(c)) {
+            end++;
+        }
+        run(begin, end);
     }
 }
 
-void FileTree::SetTransferredPaths(const std::unordered_map<std::wstring, std::wstring>* transferred) {
-    transferredPaths_ = transferred;
-    if (hTree_) InvalidateRect(hTree_, nullptr, TRUE);
+UINT FileTree::GetCheckImage(NodeId node) const {
+    // State images: 1 unchecked, 2 checked, 3 partly checked
+    if (checked_.Get(node)) return 2;
+    return partial_.Get(node) ? 3 : 1;
 }
 
-bool FileTree::IsTransferred(const std::wstring& relativePath) const {
-    if (!transferredPaths_) return false;
-    return transferredPaths_->count(relativePath) > 0;
+void FileTree::SetChecked(NodeId node, bool checked) {
+    checked_.Set(node, checked);
 }
 
-void FileTree::AutoSelect(uint64_t availableBytes) {
-    suppressCheckHandling_ = true;
-    SendMessageW(hTree_, WM_SETREDRAW, FALSE, 0);
-
-    // First deselect all
-    HTREEITEM hRoot = TreeView_GetRoot(hTree_);
-    HTREEITEM hItem = hRoot;
-    while (hItem) {
-        SetCheckState(hItem, false);
-        SetChildrenCheckState(hItem, false);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
-    }
-
-    // Collect all leaf files in tree order
-    std::vector<LeafItem> leaves;
-    hItem = hRoot;
-    while (hItem) {
-        CollectLeaves(hItem, leaves);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
-    }
-
-    // Greedy select until we exceed available space
-    uint64_t cumulative = 0;
-    for (auto& leaf : leaves) {
-        // Skip files already transferred
-        if (transferredPaths_ && transferredPaths_->count(leaf.relativePath)) {
-            continue;
+void FileTree::SetSubtreeChecked(NodeId node, bool checked) {
+    // Only the folders above see a change in their tallies
+    NodeId parent = nodes_.GetParent(node);
+    if (!nodes_.IsDirectory(node)) {
+        if (IsChecked(node) != checked) {
+            int64_t sign = checked ? 1 : -1;
+            AddToTallies(parent, 0, 0, sign * static_cast<int64_t>(nodes_.GetSize(node)), sign);
         }
-        if (cumulative + leaf.size > availableBytes) {
-            continue; // skip files that don't fit, try smaller ones
+        checked_.Set(node, checked);
+        return;
+    }
+    FolderTally before = GetTally(node);
+
+    checked_.Set(node, checked);
+    partial_.Set(node, false);
+
+    // Each folder's children go a run at a time; subfolders, sorted ahead
+    // of the files, are queued for the same
+    std::vector<NodeId> folders;
+    if (nodes_.IsDirectory(node)) folders.push_back(node);
+    while (!folders.empty()) {
+        NodeId dir = folders.back();
+        folders.pop_back();
+        if (!IsListed(dir)) continue;      // its children inherit once listed
+        ForEachChildRun(dir, [&](NodeId begin, NodeId end) {
+            checked_.SetRange(begin, end, checked);
+            partial_.SetRange(begin, end, false);
+        });
+        for (NodeId c = nodes_.GetFirstChild(dir); c != NO_NODE && nodes_.IsDirectory(c);
+             c = nodes_.GetNextSibling(c)) {
+            folders.push_back(c);
         }
-        cumulative += leaf.size;
-        SetCheckState(leaf.hItem, true);
-
-        // Check parent folders
-        HTREEITEM hParent = TreeView_GetParent(hTree_, leaf.hItem);
-        while (hParent) {
-            SetCheckState(hParent, true);
-            hParent = TreeView_GetParent(hTree_, hParent);
+        if (FolderTally* tally = FindTally(dir)) {
+            tally->checkedBytes = checked ? tally->bytes : 0;
+            tally->checkedFiles = checked ? tally->files : 0;
         }
     }
 
-    SendMessageW(hTree_, WM_SETREDRAW, TRUE, 0);
-    InvalidateRect(hTree_, nullptr, TRUE);
-    suppressCheckHandling_ = false;
+    FolderTally after = GetTally(node);
+    AddToTallies(parent,
+        0, 0,
+        static_cast<int64_t>(after.checkedBytes) - static_cast<int64_t>(before.checkedBytes),
+        static_cast<int64_t>(after.checkedFiles) - static_cast<int64_t>(before.checkedFiles));
 }
 
-uint64_t FileTree::GetSelectedSize() const {
-    uint64_t total = 0;
-    for (auto& [hItem, data] : itemMap_) {
-        if (!data.isDirectory && GetCheckState(hItem)) {
-            total += data.size;
+FileTree::FolderTally FileTree::GetTally(NodeId dir) const {
+    if (dir >= tallySlots_.size() || tallySlots_[dir] == NO_TALLY) return FolderTally();
+    return tallies_[tallySlots_[dir]];
+}
+
+FileTree::FolderTally* FileTree::FindTally(NodeId dir) {
+    if (dir >= tallySlots_.size() || tallySlots_[dir] == NO_TALLY) return nullptr;
+    return &tallies_[tallySlots_[dir]];
+}
+
+void FileTree::AddToTallies(NodeId dir, int64_t bytes, int64_t files,
+                            int64_t checkedBytes, int64_t checkedFiles) {
+    // A folder's parent has a lower id, so the slots only need to reach dir
+    if (dir != NO_NODE && dir >= tallySlots_.size()) {
+        tallySlots_.resize(nodes_.GetCount() > dir ? nodes_.GetCount() : dir + 1, NO_TALLY);
+    }
+
+    // Up the parent links: O(depth)
+    for (; dir != NO_NODE; dir = nodes_.GetParent(dir)) {
+        uint32_t& slot = tallySlots_[dir];
+        if (slot == NO_TALLY) {
+            slot = static_cast<uint32_t>(tallies_.size());
+            tallies_.emplace_back();
         }
+        FolderTally& tally = tallies_[slot];
+        tally.bytes += static_cast<uint64_t>(bytes);
+        tally.files += static_cast<uint64_t>(files);
+        tally.checkedBytes += static_cast<uint64_t>(checkedBytes);
+        tally.checkedFiles += static_cast<uint64_t>(checkedFiles);
     }
-    return total;
 }
 
-void FileTree::CollectCheckedFiles(HTREEITEM hItem, std::vector<SelectedFile>& files) const {
-    auto it = itemMap_.find(hItem);
-    if (it != itemMap_.end() && GetCheckState(hItem)) {
-        SelectedFile sf;
-        sf.sourcePath = it->second.fullPath;
-        sf.relativePath = it->second.relativePath;
-        sf.size = it->second.size;
-        sf.isDirectory = it->second.isDirectory;
-        files.push_back(sf);
-    }
+bool FileTree::UpdateFolderState(NodeId dir) {
+    // Checked if all children are, partly checked if some are (or are
+    // partly checked themselves). An empty folder keeps its own box.
+    size_t children = 0, checked = 0;
+    bool partial = false;
+    ForEachChildRun(dir, [&](NodeId begin, NodeId end) {
+        children += end - begin;
+        checked += checked_.CountRange(begin, end);
+        if (!partial) partial = partial_.CountRange(begin, end) > 0;
+    });
+    if (children == 0) return false;
+
+    bool all = checked == children;
+    bool some = !all && (checked > 0 || partial);
+    if (checked_.Get(dir) == all && partial_.Get(dir) == some) return false;
+    checked_.Set(dir, all);
+    partial_.Set(dir, some);
+    return true;
+}
 
-    HTREEITEM hChild = TreeView_GetChild(hTree_, hItem);
-    while (hChild) {
-        CollectCheckedFiles(hChild, files);
-        hChild = TreeView_GetNextSibling(hTree_, hChild);
+void FileTree::UpdateFolderStates(NodeId dir) {
+    // Up from dir until a folder's box stays the same
+    for (; dir != NO_NODE; dir = nodes_.GetParent(dir)) {
+        if (!UpdateFolderState(dir)) break;
     }
 }
 
-std::vector<FileTree::SelectedFile> FileTree::GetSelectedFiles() const {
-    std::vector<SelectedFile> files;
-    HTREEITEM hItem = TreeView_GetRoot(hTree_);
-    while (hItem) {
-        CollectCheckedFiles(hItem, files);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
+void FileTree::OnCheckChanged(HTREEITEM hItem, ChangeDelta& delta) {
+    if (suppressCheckHandling_) return;
+
+    // The control has already moved the item's box on; the model decides
+    // where it lands: a checked item is cleared, anything else is checked
+    TVITEMW tvi = {};
+    tvi.mask = TVIF_HANDLE | TVIF_PARAM;
+    tvi.hItem = hItem;
+    if (!TreeView_GetItem(hTree_, &tvi)) return;
+    NodeId node = static_cast<NodeId>(tvi.lParam);
+    bool checked = !IsChecked(node);
+
+    // A file whose path was never asked for can't be in any assignment
+    ForEachInSubtree(node, [&](NodeId n) {
+        if (nodes_.IsDirectory(n)) return checked ? !IsChecked(n) : IsSelected(n);
+        if (IsChecked(n) == checked) return false;
+        if (checked) {
+            delta.updated.push_back({ GetNodePath(n), nodes_.GetSize(n), false });
+        } else {
+            PathId path = FindNodePath(n);
+            if (path != NO_PATH) delta.removed.push_back(path);
+        }
+        return false;
+    });
+
+    suppressCheckHandling_ = true;
+    SetSubtreeChecked(node, checked);
+    UpdateFolderStates(nodes_.GetParent(node));
+    auto item = nodeItems_.find(node);
+    if (item != nodeItems_.end()) item->second.image = 0;  // the control's guess
+    RefreshCheckImages();
+    suppressCheckHandling_ = false;
+}
+
+void FileTree::SelectAll() {
+    suppressCheckHandling_ = true;
+    checked_.Resize(nodes_.GetCount());
+    checked_.Fill(true);
+    partial_.Fill(false);
+    for (auto& tally : tallies_) {
+        tally.checkedBytes = tally.bytes;
+        tally.checkedFiles = tally.files;
     }
-    return files;
+    RefreshCheckImages();
+    suppressCheckHandling_ = false;
 }
 
-std::vector<FileTree::LeafFile> FileTree::GetAllLeafFiles() const {
-    std::vector<LeafItem> leaves;
-    HTREEITEM hItem = TreeView_GetRoot(hTree_);
-    while (hItem) {
-        CollectLeaves(hItem, leaves);
-        hItem = TreeView_GetNextSibling(hTree_, hItem);
+void FileTree::DeselectAll() {
+    suppressCheckHandling_ = true;
+    checked_.Fill(false);
+    partial_.Fill(false);
+    for (auto& tally : tallies_) {
+        tally.checkedBytes = 0;
+        tally.checkedFiles = 0;
     }
+    RefreshCheckImages();
+    suppressCheckHandling_ = false;
+}
+
+void FileTree::SetTransferredPaths(const TransferLog* transferred) {
+    transferredPaths_ = transferred;
+    if (hTree_) InvalidateRect(hTree_, nullptr, TRUE);
+}
+
+bool FileTree::IsItemTransferred(LPARAM itemParam) const {
+    if (!transferredPaths_) return false;
+    return transferredPaths_->Contains(nodes_.GetPath(static_cast<NodeId>(itemParam)));
+}
+
+std::wstring FileTree::GetFullPath(PathId path) const {
+    return Utils::CombinePaths(sourceFolder_, paths_.GetPath(path));
+}
+
+uint64_t FileTree::GetSelectedSize() const {
+    NodeId root = nodes_.GetRoot();
+    return root != NO_NODE ? GetTally(root).checkedBytes : 0;
+}
 
+uint64_t FileTree::GetSelectedCount() const {
+    NodeId root = nodes_.GetRoot();
+    return root != NO_NODE ? GetTally(root).checkedFiles : 0;
+}
+
+std::vector<FileTree::SelectedFile> FileTree::GetSelectedFiles() {
+    std::vector<SelectedFile> files;
+    NodeId root = nodes_.GetRoot();
+    if (root == NO_NODE) return files;
+    ForEachInSubtree(root, [&](NodeId n) {
+        if (n == root) return true;
+        if (!IsSelected(n)) return false;
+        bool isDirectory = nodes_.IsDirectory(n);
+        files.push_back({ GetNodePath(n),
+                          isDirectory && scanning_ ? 0 : nodes_.GetSize(n), isDirectory });
+        return true;
+    });
+    return files;
+}
+
+std::vector<FileTree::LeafFile> FileTree::GetAllLeafFiles() {
     std::vector<LeafFile> result;
-    result.reserve(leaves.size());
-    for (auto& l : leaves) {
-        result.push_back({ l.hItem, l.relativePath, l.size });
-    }
+    NodeId root = nodes_.GetRoot();
+    if (root == NO_NODE) return result;
+    ForEachInSubtree(root, [&](NodeId n) {
+        if (!nodes_.IsDirectory(n)) {
+            result.push_back({ n, GetNodePath(n), nodes_.GetSize(n) });
+        }
+        return true;
+    });
     return result;
 }
 
-void FileTree::SetItemChecked(HTREEITEM hItem, bool checked) {
-    SetCheckState(hItem, checked);
+void FileTree::SetNodeChecked(NodeId node, bool checked) {
+    SetChecked(node, checked);
 }
 
 void FileTree::PropagateCheckStates() {
-    // For each leaf that is checked, ensure parents are checked
-    // Simple approach: walk all items, check parents bottom-up
-    for (auto& [hItem, data] : itemMap_) {
-        if (GetCheckState(hItem)) {
-            HTREEITEM hParent = TreeView_GetParent(hTree_, hItem);
-            while (hParent) {
-                if (GetCheckState(hParent)) break; // already checked up
-                SetCheckState(hParent, true);
-                hParent = TreeView_GetParent(hTree_, hParent);
+    // Children come after their parents in tree order, so one backward pass
+    // over the folders settles each from children that are already settled
+    std::vector<NodeId> folders;
+    NodeId root = nodes_.GetRoot();
+    if (root == NO_NODE) return;
+    ForEachInSubtree(root, [&](NodeId n) {
+        if (nodes_.IsDirectory(n)) folders.push_back(n);
+        return true;
+    });
+    for (size_t i = folders.size(); i-- > 0;) {
+        NodeId dir = folders[i];
+        if (i > 0) UpdateFolderState(dir);
+
+        // Tallies too: direct files plus subfolders, which are done already
+        uint64_t checkedBytes = 0, checkedFiles = 0;
+        for (NodeId c = nodes_.GetFirstChild(dir); c != NO_NODE; c = nodes_.GetNextSibling(c)) {
+            if (nodes_.IsDirectory(c)) {
+                FolderTally sub = GetTally(c);
+                checkedBytes += sub.checkedBytes;
+                checkedFiles += sub.checkedFiles;
+            } else if (IsChecked(c)) {
+                checkedBytes += nodes_.GetSize(c);
+                checkedFiles++;
             }
         }
+        if (FolderTally* tally = FindTally(dir)) {
+            tally->checkedBytes = checkedBytes;
+            tally->checkedFiles = checkedFiles;
+        }
     }
+    RefreshCheckImages();
 }
@@ -5,15 +5,15 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
 #include <cstdint>
+#include "PathStore.h"
+#include "DirectoryScanner.h"
+#include "SourceScan.h"
+#include "ChangeWatcher.h"
+#include "CheckBits.h"
 
-struct FileNode {
-    std::wstring name;
-    std::wstring fullPath;
-    uint64_t size;          // file size, or sum of children for folders
-    bool isDirectory;
-    std::vector<FileNode> children;
-};
+class TransferLog;
 
 class FileTree {
 public:
@@ -23,91 +23,198 @@ public:
     // Set the TreeView control handle
     void SetTreeView(HWND hTree);
 
-    // Scan a folder and populate the TreeView
-    void Populate(const std::wstring& folderPath);
+    // Start scanning a folder in the background. Folders become readable, and
+    // expandable in the TreeView, as PumpScan takes them in; WM_SCAN_COMPLETE is posted
+    // to hWndNotify when the scan thread is done. Folders unchanged since the
+    // scan saved in snapshotPath are not listed again. The folder is watched
+    // from then on, and WM_SOURCE_CHANGED is posted when something changes.
+    void Populate(const std::wstring& folderPath, const std::wstring& snapshotPath, HWND hWndNotify);
+
+    // Take in folders listed since the last call, for at most about budgetMs.
+    // Returns false once everything has been taken in.
+    bool PumpScan(DWORD budgetMs);
+
+    // On WM_SCAN_COMPLETE: take in what's left and show folder sizes.
+    // Returns false for a stale message (no scan, or a newer one running).
+    bool FinishScan();
+
+    void CancelScan();
+    bool IsScanning() const { return scanning_; }
+    const SourceScan& GetScan() const { return scan_; }
+
+    // Collect all checked items (files and folders) in tree order
+    struct SelectedFile {
+        PathId path;
+        uint64_t size;
+        bool isDirectory;
+    };
+
+    // What ApplyChanges or a check box did to the selection, for the
+    // assignment model
+    struct ChangeDelta {
+        std::vector<PathId> removed;            // files that are gone or were unchecked
+        std::vector<SelectedFile> updated;      // checked files that appeared, changed size or were checked
+    };
+
+    // Re-list the folders the watcher reported as changed, for at most about
+    // budgetMs, patching the model, and any items showing it, in place. Returns true while
+    // folders are still waiting. Nothing is applied during a scan; the
+    // changes wait for the next call after it.
+    bool ApplyChanges(DWORD budgetMs, ChangeDelta& delta);
 
     // Clear the tree
     void Clear();
 
-    // Handle checkbox toggle notification (TVN_ITEMCHANGED or NM_CLICK)
-    void OnCheckChanged(HTREEITEM hItem);
+    // TreeView notifications for the source tree. Items are virtual: text
+    // and expand buttons are asked for on demand, a folder's children are
+    // inserted when it is first expanded and released when it is collapsed.
+    void OnGetDispInfo(NMTVDISPINFOW* info);
+    void OnItemExpanding(NMTREEVIEWW* tv);
+    void OnItemExpanded(NMTREEVIEWW* tv);
+    void OnDeleteItem(NMTREEVIEWW* tv);
+
+    // Handle checkbox toggle notification (TVN_ITEMCHANGED or NM_CLICK).
+    // The files whose box flipped go into delta; folders that were already
+    // all one way are skipped whole, so this costs what changed.
+    void OnCheckChanged(HTREEITEM hItem, ChangeDelta& delta);
 
     // Select/deselect all items
     void SelectAll();
     void DeselectAll();
 
-    // Set pointer to transferred paths (for dimming in custom draw)
-    void SetTransferredPaths(const std::unordered_map<std::wstring, std::wstring>* transferred);
-
-    // Auto-select items that fit within availableBytes, skipping transferred files
-    void AutoSelect(uint64_t availableBytes);
+    // Set the transfer log used to find transferred paths (for dimming in custom draw)
+    void SetTransferredPaths(const TransferLog* transferred);
 
-    // Get total size of all checked items
+    // Total size and number of checked files, kept up to date as boxes
+    // change (O(1))
     uint64_t GetSelectedSize() const;
+    uint64_t GetSelectedCount() const;
 
-    // Collect full paths of all checked files (not folders)
-    struct SelectedFile {
-        std::wstring sourcePath;
-        std::wstring relativePath;
-        uint64_t size;
-        bool isDirectory;
-    };
-    std::vector<SelectedFile> GetSelectedFiles() const;
+    std::vector<SelectedFile> GetSelectedFiles();
 
     // Get the source root folder
     const std::wstring& GetSourceFolder() const { return sourceFolder_; }
 
+    // Paths of the scanned items; ids stay valid until the next Populate/Clear
+    const PathStore& GetPaths() const { return paths_; }
+    std::wstring GetRelativePath(PathId path) const { return paths_.GetPath(path); }
+    std::wstring GetFullPath(PathId path) const;
+
     // Get all leaf (non-directory) files in tree order
     struct LeafFile {
-        HTREEITEM hItem;
-        std::wstring relativePath;
+        NodeId node;
+        PathId path;
         uint64_t size;
     };
-    std::vector<LeafFile> GetAllLeafFiles() const;
+    std::vector<LeafFile> GetAllLeafFiles();
 
-    // Public checkbox control
-    void SetItemChecked(HTREEITEM hItem, bool checked);
+    // Public checkbox control. Check states live in the tree model, not in
+    // the TreeView, so they cover folders that were never expanded. Folder
+    // boxes and totals catch up on PropagateCheckStates.
+    void SetNodeChecked(NodeId node, bool checked);
 
     // Bottom-up parent check propagation after bulk changes
     void PropagateCheckStates();
 
-    // Const reference to the item map
-    struct ItemData {
-        uint64_t size;
-        bool isDirectory;
-        std::wstring fullPath;
-        std::wstring relativePath;
-    };
-    const std::unordered_map<HTREEITEM, ItemData>& GetItemMap() const { return itemMap_; }
-
-    // Check if a relative path is transferred (for custom draw)
-    bool IsTransferred(const std::wstring& relativePath) const;
+    // Check if an item, by its lParam, is transferred (for custom draw)
+    bool IsItemTransferred(LPARAM itemParam) const;
 
 private:
     HWND hTree_ = nullptr;
     std::wstring sourceFolder_;
-    FileNode root_;
-
-    std::unordered_map<HTREEITEM, ItemData> itemMap_;
-
-    // Internal recursive helpers
-    void ScanFolder(const std::wstring& path, FileNode& node);
-    HTREEITEM InsertNode(HTREEITEM hParent, const FileNode& node, const std::wstring& relPath);
-    void SetCheckState(HTREEITEM hItem, bool checked);
-    bool GetCheckState(HTREEITEM hItem) const;
-    void SetChildrenCheckState(HTREEITEM hItem, bool checked);
-    void UpdateParentCheckState(HTREEITEM hItem);
-    void CollectCheckedFiles(HTREEITEM hItem, std::vector<SelectedFile>& files) const;
-    uint64_t CalcCheckedSize(HTREEITEM hItem) const;
-
-    // For auto-select: collect all leaf items in tree order
-    struct LeafItem {
+    NodeTable nodes_;
+    PathStore paths_;
+
+    // Check boxes, indexed by NodeId: checked_ for a fully checked node,
+    // partial_ for a folder with only some of its contents checked. A
+    // folder's children sit in one run of ids (two or more after live
+    // changes), so whole-folder updates go a word at a time.
+    CheckBits checked_;
+    CheckBits partial_;
+
+    std::vector<PathId> nodePaths_;         // interned on first use, by NodeId
+
+    // Items currently in the TreeView; each item's lParam is its NodeId.
+    // The state image last given to each is kept, so a check change only
+    // touches (and repaints) the items whose box actually changed.
+    struct ItemInfo {
         HTREEITEM hItem;
-        uint64_t size;
-        std::wstring relativePath;
+        UINT image;
     };
-    void CollectLeaves(HTREEITEM hItem, std::vector<LeafItem>& leaves) const;
+    std::unordered_map<NodeId, ItemInfo> nodeItems_;
+    bool collapsing_ = false;
+
+    // Background scan into nodes_ (declared after nodes_, so it stops first).
+    // While it runs, only the children of folders it has handed out may be
+    // read.
+    SourceScan scan_;
+    bool scanning_ = false;
+    std::vector<uint8_t> listed_;                   // folders handed out so far
+    std::unordered_set<NodeId> expandWanted_;       // expanded before they were listed
+
+    static const size_t SCAN_BATCH_ITEMS = 2000;
+
+    void InsertListedFolder(NodeId dir);
+    bool IsListed(NodeId node) const {
+        return !scanning_ || (node < listed_.size() && listed_[node]);
+    }
+
+    // Change tracking
+    ChangeWatcher watcher_;
+    std::deque<std::wstring> staleFolders_;         // relative paths waiting to be re-listed
+
+    void RefreshFolder(const std::wstring& relativePath, ChangeDelta& delta);
+    void ForgetNode(NodeId node, ChangeDelta& delta);
+    void QueueAllFolders(NodeId node, const std::wstring& relativePath);
+
+    // Items
+    HTREEITEM InsertItem(HTREEITEM hParent, NodeId node, HTREEITEM hInsertAfter = TVI_LAST);
+    void InsertChildItems(HTREEITEM hParent, NodeId dir);
+    HTREEITEM FindItem(NodeId node) const;
+    void RefreshCheckImages();
+
+    // Paths
+    PathId GetNodePath(NodeId node);
+    PathId FindNodePath(NodeId node) const;
+
+    // Check state
+    bool IsChecked(NodeId node) const { return checked_.Get(node); }
+    bool IsSelected(NodeId node) const { return checked_.Get(node) || partial_.Get(node); }
+    UINT GetCheckImage(NodeId node) const;
+    void SetChecked(NodeId node, bool checked);
+    void SetSubtreeChecked(NodeId node, bool checked);
+    bool UpdateFolderState(NodeId dir);
+    void UpdateFolderStates(NodeId dir);
+
+    // Call run(begin, end) for each run of consecutive ids among dir's children
+    template <typename Run>
+    void ForEachChildRun(NodeId dir, Run run) const;
+
+    // Per-folder totals of the files below it, all and checked, so the
+    // selection size never needs a walk. A box change adjusts the folders
+    // above it (O(depth)); checking a whole folder resets the ones below.
+    // Kept densely, one per folder, and found through a slot per node id,
+    // so a lookup is two array reads.
+    struct FolderTally {
+        uint64_t bytes = 0;             // listed so far, while scanning
+        uint64_t files = 0;
+        uint64_t checkedBytes = 0;
+        uint64_t checkedFiles = 0;
+    };
+    static const uint32_t NO_TALLY = 0xFFFFFFFF;
+    std::vector<uint32_t> tallySlots_;      // by node id: index into tallies_, or NO_TALLY
+    std::vector<FolderTally> tallies_;
+
+    FolderTally GetTally(NodeId dir) const;
+    FolderTally* FindTally(NodeId dir);
+    void AddToTallies(NodeId dir, int64_t bytes, int64_t files,
+                      int64_t checkedBytes, int64_t checkedFiles);
+
+    // Visit node and, where visit returns true, its listed descendants, in
+    // tree order
+    template <typename Visit>
+    void ForEachInSubtree(NodeId node, Visit visit) const;
 
     bool suppressCheckHandling_ = false;
-    const std::unordered_map<std::wstring, std::wstring>* transferredPaths_ = nullptr;
+    const TransferLog* transferredPaths_ = nullptr;
 };
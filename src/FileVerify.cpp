@@ -0,0 +1,292 @@
+#include "FileVerify.h"
+#include "BufferPool.h"
+#include "ContentHash.h"
+#include <vector>
+#include <intrin.h>
+
+static const DWORD READBACK_CHUNK_SIZE = 1024 * 1024;       // unbuffered read size (sector multiple)
+static const DWORD READBACK_QUEUE_DEPTH = 4;                // reads in flight per file
+
+// --- Compare kernel ---
+
+static size_t FirstSetBit(unsigned int mask) {
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+}
+
+size_t FindFirstMismatchSse2(const void* a, const void* b, size_t length) {
+    const unsigned char* pa = static_cast<const unsigned char*>(a);
+    const unsigned char* pb = static_cast<const unsigned char*>(b);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+        unsigned int eq = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+        if (eq != 0xFFFF) return i + FirstSetBit(~eq & 0xFFFF);
+    }
+    for (; i < length; i++) {
+        if (pa[i] != pb[i]) return i;
+    }
+    return length;
+}
+
+size_t FindFirstMismatchAvx2(const void* a, const void* b, size_t length) {
+    const unsigned char* pa = static_cast<const unsigned char*>(a);
+    const unsigned char* pb = static_cast<const unsigned char*>(b);
+    size_t i = 0;
+    // Two 32-byte lanes per step; locate the exact byte only once a difference shows
+    for (; i + 64 <= length; i += 64) {
+        __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + i));
+        __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb + i));
+        __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + i + 32));
+        __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb + i + 32));
+        __m256i eq0 = _mm256_cmpeq_epi8(a0, b0);
+        __m256i eq1 = _mm256_cmpeq_epi8(a1, b1);
+        if (static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1))) != 0xFFFFFFFFu) {
+            unsigned int m0 = static_cast<unsigned int>(_mm256_movemask_epi8(eq0));
+            if (m0 != 0xFFFFFFFFu) return i + FirstSetBit(~m0);
+            unsigned int m1 = static_cast<unsigned int>(_mm256_movemask_epi8(eq1));
+            return i + 32 + FirstSetBit(~m1);
+        }
+    }
+    return i + FindFirstMismatchSse2(pa + i, pb + i, length - i);
+}
+
+bool CpuHasAvx2() {
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // OSXSAVE + AVX, and the OS must save YMM state on context switches
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+}
+
+size_t FindFirstMismatch(const void* a, const void* b, size_t length) {
+    static const bool useAvx2 = CpuHasAvx2();
+    return useAvx2 ? FindFirstMismatchAvx2(a, b, length)
+                   : FindFirstMismatchSse2(a, b, length);
+}
+
+// --- Unbuffered chunk reader ---
+
+namespace {
+
+// Reads one file unbuffered through a ring of overlapped requests. Requests
+// are issued and consumed round-robin, so chunks come back in file order while
+// the rest of the ring keeps the device busy.
+class ChunkReader {
+public:
+    ChunkReader(HANDLE hFile, uint64_t fileSize) : hFile_(hFile), fileSize_(fileSize) {
+        // Only as many buffers as the file has chunks, so small files stay cheap
+        uint64_t chunks = (fileSize + READBACK_CHUNK_SIZE - 1) / READBACK_CHUNK_SIZE;
+        ring_.resize(static_cast<size_t>(chunks < READBACK_QUEUE_DEPTH ? chunks : READBACK_QUEUE_DEPTH));
+    }
+
+    ~ChunkReader() {
+        // On early exit the kernel still owns any outstanding buffers
+        bool anyPending = false;
+        for (auto& req : ring_) anyPending |= req.pending;
+        if (anyPending) {
+            CancelIoEx(hFile_, nullptr);
+            for (auto& req : ring_) {
+                DWORD bytes;
+                if (req.pending) GetOverlappedResult(hFile_, &req.ov, &bytes, TRUE);
+            }
+        }
+        for (auto& req : ring_) {
+            if (req.hEvent) CloseHandle(req.hEvent);
+        }
+    }
+
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    // Check out buffers and prime the ring. Under memory pressure a shallower
+    // ring is used; fails only if not even one buffer is available.
+    bool Start() {
+        for (auto& req : ring_) {
+            req.buffer = PooledBuffer(READBACK_CHUNK_SIZE);
+            req.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (!req.buffer || !req.hEvent) break;
+            usable_++;
+        }
+        if (usable_ == 0) return ring_.empty();
+
+        for (size_t i = 0; i < usable_ && nextRead_ < fileSize_; i++) {
+            if (!Issue(ring_[i])) return false;
+        }
+        return true;
+    }
+
+    // Wait for the next chunk in file order. length is 0 at end of file.
+    bool Next(const void*& data, DWORD& length) {
+        length = 0;
+        if (usable_ == 0 || !ring_[current_].pending) return true;
+
+        Request& req = ring_[current_];
+        DWORD bytes = 0;
+        BOOL done = GetOverlappedResult(hFile_, &req.ov, &bytes, TRUE);
+        req.pending = false;
+        if (!done && GetLastError() != ERROR_HANDLE_EOF) return false;
+
+        uint64_t expected = fileSize_ - req.offset;
+        if (expected > READBACK_CHUNK_SIZE) expected = READBACK_CHUNK_SIZE;
+        if (bytes < expected) return false; // file shrank underneath us
+
+        data = req.buffer.Get();
+        length = static_cast<DWORD>(expected);
+        return true;
+    }
+
+    // Done with the chunk from the last Next: refill its buffer with the next read
+    bool Recycle() {
+        Request& req = ring_[current_];
+        current_ = (current_ + 1) % usable_;
+        return nextRead_ >= fileSize_ || Issue(req);
+    }
+
+private:
+    struct Request {
+        OVERLAPPED ov;
+        HANDLE hEvent = nullptr;
+        PooledBuffer buffer;
+        uint64_t offset = 0;
+        bool pending = false;
+    };
+
+    bool Issue(Request& req) {
+        req.ov = OVERLAPPED{};
+        req.ov.hEvent = req.hEvent;
+        req.ov.Offset = static_cast<DWORD>(nextRead_);
+        req.ov.OffsetHigh = static_cast<DWORD>(nextRead_ >> 32);
+        req.offset = nextRead_;
+        nextRead_ += READBACK_CHUNK_SIZE;
+        if (!ReadFile(hFile_, req.buffer.Get(), READBACK_CHUNK_SIZE, nullptr, &req.ov) &&
+            GetLastError() != ERROR_IO_PENDING) {
+            return false;
+        }
+        req.pending = true;
+        return true;
+    }
+
+    HANDLE hFile_;
+    uint64_t fileSize_;
+    uint64_t nextRead_ = 0;
+    std::vector<Request> ring_;
+    size_t usable_ = 0;
+    size_t current_ = 0;
+};
+
+} // namespace
+
+// Push anything still dirty in the cache to the disk. A read-only destination
+// can't be opened for writing; a noncached read still forces its dirty pages
+// out, so that case carries on without the explicit flush.
+static bool FlushDestination(const std::wstring& dstPath) {
+    HANDLE hFlush = CreateFileW(dstPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFlush == INVALID_HANDLE_VALUE) return true;
+    bool flushed = FlushFileBuffers(hFlush) != FALSE;
+    CloseHandle(hFlush);
+    return flushed;
+}
+
+// Open for unbuffered overlapped reading and check the size
+static HANDLE OpenUnbuffered(const std::wstring& path, uint64_t expectedSize) {
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return h;
+
+    LARGE_INTEGER liSize;
+    if (!GetFileSizeEx(h, &liSize) || static_cast<uint64_t>(liSize.QuadPart) != expectedSize) {
+        CloseHandle(h);
+        return INVALID_HANDLE_VALUE;
+    }
+    return h;
+}
+
+bool VerifyFilesMatch(const std::wstring& srcPath, const std::wstring& dstPath,
+                      uint64_t expectedSize, const std::atomic<bool>& cancelled,
+                      uint64_t* mismatchOffset) {
+    if (mismatchOffset) *mismatchOffset = NO_MISMATCH_OFFSET;
+    if (!FlushDestination(dstPath)) return false;
+
+    HANDLE hSrc = OpenUnbuffered(srcPath, expectedSize);
+    if (hSrc == INVALID_HANDLE_VALUE) return false;
+    HANDLE hDst = OpenUnbuffered(dstPath, expectedSize);
+    if (hDst == INVALID_HANDLE_VALUE) {
+        CloseHandle(hSrc);
+        return false;
+    }
+
+    bool match;
+    {
+        ChunkReader src(hSrc, expectedSize);
+        ChunkReader dst(hDst, expectedSize);
+        match = src.Start() && dst.Start();
+
+        uint64_t offset = 0;
+        while (match && !cancelled) {
+            const void* a = nullptr;
+            const void* b = nullptr;
+            DWORD lenA = 0, lenB = 0;
+            if (!src.Next(a, lenA) || !dst.Next(b, lenB) || lenA != lenB) {
+                match = false;
+                break;
+            }
+            if (lenA == 0) break;
+
+            size_t diff = FindFirstMismatch(a, b, lenA);
+            if (diff != lenA) {
+                if (mismatchOffset) *mismatchOffset = offset + diff;
+                match = false;
+                break;
+            }
+            offset += lenA;
+            match = src.Recycle() && dst.Recycle();
+        }
+        if (cancelled) match = false;
+    }
+
+    CloseHandle(hSrc);
+    CloseHandle(hDst);
+    return match;
+}
+
+bool VerifyDestinationHash(const std::wstring& dstPath, uint64_t expectedSize,
+                           uint64_t expectedHash, const std::atomic<bool>& cancelled) {
+    if (!FlushDestination(dstPath)) return false;
+
+    HANDLE hDst = OpenUnbuffered(dstPath, expectedSize);
+    if (hDst == INVALID_HANDLE_VALUE) return false;
+
+    bool ok;
+    ContentHash hash;
+    {
+        ChunkReader dst(hDst, expectedSize);
+        ok = dst.Start();
+        while (ok && !cancelled) {
+            const void* data = nullptr;
+            DWORD length = 0;
+            if (!dst.Next(data, length)) {
+                ok = false;
+                break;
+            }
+            if (length == 0) break;
+            hash.Update(data, length);
+            ok = dst.Recycle();
+        }
+        if (cancelled) ok = false;
+    }
+
+    CloseHandle(hDst);
+    return ok && hash.Digest() == expectedHash;
+}
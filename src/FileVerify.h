@@ -0,0 +1,34 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+#include <atomic>
+
+// Sentinel for "no mismatch offset known"
+static const uint64_t NO_MISMATCH_OFFSET = ~0ull;
+
+// Compare source and destination byte-by-byte. Returns true if they match.
+// Both files are read unbuffered with several overlapped reads in flight on
+// each, so the two devices work concurrently and the compare runs at about the
+// slower one's speed. On a content mismatch, *mismatchOffset (if given) gets
+// the offset of the first differing byte.
+bool VerifyFilesMatch(const std::wstring& srcPath, const std::wstring& dstPath,
+                      uint64_t expectedSize, const std::atomic<bool>& cancelled,
+                      uint64_t* mismatchOffset = nullptr);
+
+// Flush the destination, then read it back unbuffered (FILE_FLAG_NO_BUFFERING)
+// with several overlapped reads in flight and check its length and content
+// hash. Bypassing the cache means the check sees what is on the disk rather
+// than pages left over from the copy, and doesn't evict useful cache.
+bool VerifyDestinationHash(const std::wstring& dstPath, uint64_t expectedSize,
+                           uint64_t expectedHash, const std::atomic<bool>& cancelled);
+
+// Index of the first byte where a and b differ, or length if they are equal.
+// Vectorized (AVX2 when the CPU and OS support it, otherwise SSE2).
+size_t FindFirstMismatch(const void* a, const void* b, size_t length);
+
+// The kernels FindFirstMismatch picks between (exposed for CompareBench).
+// The AVX2 one may only run if CpuHasAvx2() is true.
+size_t FindFirstMismatchSse2(const void* a, const void* b, size_t length);
+size_t FindFirstMismatchAvx2(const void* a, const void* b, size_t length);
+bool CpuHasAvx2();
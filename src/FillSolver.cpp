@@ -0,0 +1,255 @@
+#include "FillSolver.h"
+#include <algorithm>
+
+static const int MAX_FILL_THREADS = 32;
+
+// Tasks per thread, so threads that draw easy branches pick up more
+static const uint32_t TASKS_PER_THREAD = 16;
+static const uint32_t MAX_PREFIX_LENGTH = 16;
+
+// Search steps between looks at the clock
+static const uint32_t CLOCK_CHECK_STEPS = 1024;
+
+FillSolver::FillSolver(DWORD budgetMs, int threads, const std::atomic<bool>* cancel)
+    : budgetMs_(budgetMs), cancel_(cancel) {
+    if (threads < 1) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        threads = static_cast<int>(si.dwNumberOfProcessors);
+        if (threads < 1) threads = 1;
+    }
+    threads_ = threads < MAX_FILL_THREADS ? threads : MAX_FILL_THREADS;
+}
+
+void FillSolver::Solve(const std::vector<PackItem>& items, std::vector<uint64_t>& available,
+                       std::vector<int>& placement) {
+    placement.assign(items.size(), -1);
+    optimal_ = true;
+    if (items.empty() || available.empty()) return;
+
+    // Largest first, ties in the order given
+    std::vector<std::pair<uint64_t, uint32_t>> order(items.size());
+    for (size_t k = 0; k < items.size(); k++) order[k] = { items[k].size, static_cast<uint32_t>(k) };
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first > b.first;
+        return a.second < b.second;
+    });
+
+    ULONGLONG end = GetTickCount64() + budgetMs_;
+    std::vector<uint32_t> candidates;
+    for (size_t drive = 0; drive < available.size(); drive++) {
+        uint64_t room = available[drive];
+
+        // What's left that fits here at all
+        candidates.clear();
+        sizes_.clear();
+        uint64_t total = 0;
+        for (auto& [size, k] : order) {
+            if (placement[k] >= 0 || size > room) continue;
+            candidates.push_back(k);
+            sizes_.push_back(size);
+            total += size;
+        }
+        if (candidates.empty()) continue;
+
+        if (total <= room) {
+            bestSet_.resize(candidates.size());
+            for (uint32_t i = 0; i < candidates.size(); i++) bestSet_[i] = i;
+        } else {
+            // The rest of the budget, shared by the drives still to fill
+            ULONGLONG now = GetTickCount64();
+            if (cancel_ && *cancel_) end = now;
+            ULONGLONG deadline = now < end ? now + (end - now) / (available.size() - drive) : now;
+            if (!FillDrive(room, deadline)) optimal_ = false;
+        }
+
+        for (uint32_t i : bestSet_) {
+            uint32_t k = candidates[i];
+            placement[k] = static_cast<int>(drive);
+            available[drive] -= items[k].size;
+        }
+    }
+}
+
+uint32_t FillSolver::FirstFit(uint32_t pos, uint64_t room) const {
+    auto it = std::partition_point(sizes_.begin() + pos, sizes_.end(),
+        [room](uint64_t size) { return size > room; });
+    return static_cast<uint32_t>(it - sizes_.begin());
+}
+
+bool FillSolver::FillDrive(uint64_t room, ULONGLONG deadline) {
+    uint32_t n = static_cast<uint32_t>(sizes_.size());
+    suffix_.assign(n + 1, 0);
+    nextSmaller_.assign(n, n);
+    for (uint32_t i = n; i-- > 0;) {
+        suffix_[i] = suffix_[i + 1] + sizes_[i];
+        if (i + 1 < n) nextSmaller_[i] = sizes_[i + 1] < sizes_[i] ? i + 1 : nextSmaller_[i + 1];
+    }
+    room_ = room;
+    deadline_ = deadline;
+
+    // Start from the greedy fill: largest first, everything that fits
+    bestSet_.clear();
+    uint64_t sum = 0;
+    for (uint32_t i = FirstFit(0, room); i < n; i = FirstFit(i + 1, room - sum)) {
+        bestSet_.push_back(i);
+        sum += sizes_[i];
+    }
+    best_ = sum;
+    if (sum == room) return true;
+
+    prefixLength_ = 0;
+    while (prefixLength_ < MAX_PREFIX_LENGTH && prefixLength_ < n &&
+           (1u << prefixLength_) < static_cast<uint32_t>(threads_) * TASKS_PER_THREAD) {
+        prefixLength_++;
+    }
+    taskCount_ = 1u << prefixLength_;
+    nextTask_ = 0;
+    stop_ = false;
+    timedOut_ = false;
+
+    std::vector<HANDLE> threads;
+    for (int i = 0; i < threads_; i++) {
+        HANDLE h = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+        if (h) threads.push_back(h);
+    }
+    if (threads.empty()) {
+        // No threads available: search from here
+        WorkerLoop();
+    }
+    for (HANDLE h : threads) {
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+    }
+    return !timedOut_;
+}
+
+DWORD WINAPI FillSolver::ThreadProc(LPVOID param) {
+    static_cast<FillSolver*>(param)->WorkerLoop();
+    return 0;
+}
+
+void FillSolver::WorkerLoop() {
+    while (!stop_) {
+        uint32_t task = nextTask_++;
+        if (task >= taskCount_) return;
+        // All of the prefix taken first, then fewer and fewer
+        RunTask(taskCount_ - 1 - task);
+    }
+}
+
+void FillSolver::RunTask(uint32_t mask) {
+    uint32_t n = static_cast<uint32_t>(sizes_.size());
+
+    // The first prefixLength_ files are taken or not by the mask. Files of
+    // equal size are taken in order, and left-out files keep the rest of
+    // their size out too.
+    std::vector<uint32_t> prefix;
+    uint64_t sum = 0;
+    uint32_t pos = prefixLength_;
+    for (uint32_t i = 0; i < prefixLength_; i++) {
+        if (mask & (1u << (prefixLength_ - 1 - i))) {
+            if (i > 0 && sizes_[i - 1] == sizes_[i] &&
+                !(mask & (1u << (prefixLength_ - i)))) return;
+            prefix.push_back(i);
+            sum += sizes_[i];
+        } else {
+            pos = std::max(pos, nextSmaller_[i]);
+        }
+    }
+    if (sum > room_) return;
+    if (sum + std::min(room_ - sum, suffix_[std::min(pos, n)]) <= best_) return;
+
+    std::vector<uint32_t> stack;
+    uint32_t steps = 0;
+    for (;;) {
+        // Take everything that fits from pos on
+        for (uint32_t i = FirstFit(pos, room_ - sum); i < n; i = FirstFit(i + 1, room_ - sum)) {
+            stack.push_back(i);
+            sum += sizes_[i];
+        }
+        if (sum > best_) Record(prefix, stack, sum);
+        if (sum == room_) stop_ = true;
+        if (stop_) return;
+        if (++steps % CLOCK_CHECK_STEPS == 0 &&
+            (GetTickCount64() >= deadline_ || (cancel_ && *cancel_))) {
+            timedOut_ = true;
+            stop_ = true;
+            return;
+        }
+
+        // Back up to the last file taken whose leaving out could still
+        // beat the best fill
+        bool resumed = false;
+        while (!stack.empty()) {
+            uint32_t j = stack.back();
+            stack.pop_back();
+            sum -= sizes_[j];
+            uint32_t next = nextSmaller_[j];
+            if (next < n && sum + std::min(room_ - sum, suffix_[next]) > best_) {
+                pos = next;
+                resumed = true;
+                break;
+            }
+        }
+        if (!resumed) return;
+    }
+}
+
+void FillSolver::Record(const std::vector<uint32_t>& prefix, const std::vector<uint32_t>& stack,
+                        uint64_t sum) {
+    std::lock_guard<std::mutex> lock(bestMutex_);
+    if (sum <= best_) return;
+    best_ = sum;
+    bestSet_ = prefix;
+    bestSet_.insert(bestSet_.end(), stack.begin(), stack.end());
+}
+
+// --- BackgroundFill ---
+
+BackgroundFill::~BackgroundFill() {
+    Cancel();
+    Wait();
+}
+
+void BackgroundFill::Start(HWND hWndNotify, std::vector<PackItem> items, std::vector<PackDrive> drives,
+                           DWORD budgetMs) {
+    Cancel();
+    Wait();
+
+    hWndNotify_ = hWndNotify;
+    items_ = std::move(items);
+    drives_ = std::move(drives);
+    placement_.clear();
+    report_ = FillReport();
+    report_.budgetMs = budgetMs;
+    report_.cancel = &cancelled_;
+    cancelled_ = false;
+    finished_ = false;
+
+    hThread_ = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    if (!hThread_) Run();
+}
+
+void BackgroundFill::Cancel() {
+    cancelled_ = true;
+}
+
+void BackgroundFill::Wait() {
+    if (hThread_) {
+        WaitForSingleObject(hThread_, INFINITE);
+        CloseHandle(hThread_);
+        hThread_ = nullptr;
+    }
+}
+
+DWORD WINAPI BackgroundFill::ThreadProc(LPVOID param) {
+    static_cast<BackgroundFill*>(param)->Run();
+    return 0;
+}
+
+void BackgroundFill::Run() {
+    Packer::Pack(PackMethod::OptimalFill, items_, noPaths_, drives_, placement_, &report_);
+    finished_ = true;
+    if (hWndNotify_) PostMessageW(hWndNotify_, WM_FILL_COMPLETE, 0, 0);
+}
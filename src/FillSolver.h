@@ -0,0 +1,120 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include "Packer.h"
+#include "PathStore.h"
+
+// Posted when a BackgroundFill has finished
+#define WM_FILL_COMPLETE        (WM_USER + 120)
+
+// Fills drives one at a time with the set of files that comes closest to
+// the drive's room (subset sum), within a time budget. Each drive's files
+// are searched depth-first, largest first, taking every file that still
+// fits before trying without it. A branch is cut once even all the files
+// after it couldn't beat the best fill so far, and files of equal size are
+// only ever taken in order, so duplicates cost nothing. The first few
+// decisions split the search into tasks for a pool of threads sharing the
+// best fill. The search starts from the greedy fill, so the result is never
+// worse; a drive whose search runs to the end is filled as fully as it can be.
+class FillSolver {
+public:
+    // threads: number of workers (0 = one per processor). Setting *cancel
+    // ends the search like the budget running out.
+    explicit FillSolver(DWORD budgetMs, int threads = 0, const std::atomic<bool>* cancel = nullptr);
+
+    FillSolver(const FillSolver&) = delete;
+    FillSolver& operator=(const FillSolver&) = delete;
+
+    // Place items on drives that have available[i] bytes free, taking what
+    // is placed off available. placement[k] is set to the drive items[k]
+    // went to, or -1.
+    void Solve(const std::vector<PackItem>& items, std::vector<uint64_t>& available,
+               std::vector<int>& placement);
+
+    // True if every drive's search ran to the end
+    bool IsOptimal() const { return optimal_; }
+
+private:
+    // Fill one drive of the given room from sizes_ (largest first); the
+    // chosen positions end up in bestSet_. Returns false if time ran out.
+    bool FillDrive(uint64_t room, ULONGLONG deadline);
+
+    // First position at or after pos whose size is at most room
+    uint32_t FirstFit(uint32_t pos, uint64_t room) const;
+
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void WorkerLoop();
+    void RunTask(uint32_t mask);
+    void Record(const std::vector<uint32_t>& prefix, const std::vector<uint32_t>& stack, uint64_t sum);
+
+    DWORD budgetMs_;
+    int threads_;
+    const std::atomic<bool>* cancel_;
+    bool optimal_ = true;
+
+    // The drive being filled
+    std::vector<uint64_t> sizes_;           // candidates, largest first
+    std::vector<uint64_t> suffix_;          // suffix_[i]: total size from i on
+    std::vector<uint32_t> nextSmaller_;     // first position after i with a smaller size
+    uint64_t room_ = 0;
+    ULONGLONG deadline_ = 0;
+    uint32_t prefixLength_ = 0;             // decisions fixed by each task
+    uint32_t taskCount_ = 0;
+    std::atomic<uint32_t> nextTask_{ 0 };
+    std::atomic<bool> stop_{ false };
+    std::atomic<bool> timedOut_{ false };
+
+    std::atomic<uint64_t> best_{ 0 };
+    std::mutex bestMutex_;
+    std::vector<uint32_t> bestSet_;
+};
+
+// An optimal fill (Packer::Pack with PackMethod::OptimalFill) on a thread of
+// its own, so the search's time budget never holds up the window. Posts
+// WM_FILL_COMPLETE when done; the results are read after Wait.
+class BackgroundFill {
+public:
+    BackgroundFill() = default;
+    ~BackgroundFill();
+
+    BackgroundFill(const BackgroundFill&) = delete;
+    BackgroundFill& operator=(const BackgroundFill&) = delete;
+
+    // Pack items onto drives within budgetMs. If no thread can be started,
+    // the fill runs here instead (the message is still posted).
+    void Start(HWND hWndNotify, std::vector<PackItem> items, std::vector<PackDrive> drives, DWORD budgetMs);
+
+    // End the search early; the fill then finishes with what it has
+    void Cancel();
+
+    // Block until the fill thread has exited
+    void Wait();
+
+    // True until the fill has finished (or was never started)
+    bool IsRunning() const { return hThread_ != nullptr && !finished_; }
+
+    // Valid after Wait: the items, where they went (-1: nowhere), the drives
+    // with what was placed taken off their room, and how the fill did
+    const std::vector<PackItem>& GetItems() const { return items_; }
+    const std::vector<int>& GetPlacement() const { return placement_; }
+    const std::vector<PackDrive>& GetDrives() const { return drives_; }
+    const FillReport& GetReport() const { return report_; }
+
+private:
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void Run();
+
+    HWND hWndNotify_ = nullptr;
+    HANDLE hThread_ = nullptr;
+    std::atomic<bool> cancelled_{ false };
+    std::atomic<bool> finished_{ false };
+
+    std::vector<PackItem> items_;
+    std::vector<PackDrive> drives_;
+    std::vector<int> placement_;
+    FillReport report_;
+    PathStore noPaths_;                     // the fill doesn't look at folders
+};
@@ -0,0 +1,193 @@
+#include "JsonReader.h"
+#include <cstring>
+#include <intrin.h>
+
+// Position of the next '"' or '\\' at or after p, or end
+static const char* FindQuoteOrEscape(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash))));
+        if (mask) {
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return p + index;
+        }
+        p += 16;
+    }
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+// Append UTF-8 bytes to out as UTF-16. Pure ASCII runs (the common case for
+// paths) are widened inline; anything else goes through MultiByteToWideChar.
+static void AppendUtf8(std::wstring& out, const char* p, size_t length) {
+    if (length == 0) return;
+
+    size_t i = 0;
+    while (i < length && static_cast<unsigned char>(p[i]) < 0x80) i++;
+    size_t old = out.size();
+    if (i == length) {
+        out.resize(old + length);
+        wchar_t* dst = &out[old];
+        for (size_t k = 0; k < length; k++) dst[k] = static_cast<wchar_t>(p[k]);
+        return;
+    }
+
+    int wideLen = MultiByteToWideChar(CP_UTF8, 0, p, static_cast<int>(length), nullptr, 0);
+    if (wideLen <= 0) return;
+    out.resize(old + wideLen);
+    MultiByteToWideChar(CP_UTF8, 0, p, static_cast<int>(length), &out[old], wideLen);
+}
+
+static int HexDigit(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+JsonReader::JsonReader(const char* data, size_t size) : p_(data), end_(data + size) {
+    // Skip UTF-8 BOM if present
+    if (size >= 3 &&
+        (unsigned char)data[0] == 0xEF &&
+        (unsigned char)data[1] == 0xBB &&
+        (unsigned char)data[2] == 0xBF) {
+        p_ += 3;
+    }
+}
+
+void JsonReader::SkipWS() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n'))
+        p_++;
+}
+
+bool JsonReader::Peek(char ch) {
+    SkipWS();
+    return p_ < end_ && *p_ == ch;
+}
+
+bool JsonReader::Expect(char ch) {
+    if (!Peek(ch)) return false;
+    p_++;
+    return true;
+}
+
+bool JsonReader::AtEnd() {
+    SkipWS();
+    return p_ >= end_;
+}
+
+bool JsonReader::KeyIs(const char* key, size_t length, const char* name) {
+    return strlen(name) == length && memcmp(key, name, length) == 0;
+}
+
+bool JsonReader::ParseKey(const char*& key, size_t& length) {
+    if (!Expect('"')) return false;
+    const char* stop = FindQuoteOrEscape(p_, end_);
+    if (stop >= end_ || *stop != '"') {
+        // Keys in this schema never need escapes; skip anything else
+        p_--;
+        SkipString();
+        key = nullptr;
+        length = 0;
+        return true;
+    }
+    key = p_;
+    length = stop - p_;
+    p_ = stop + 1;
+    return true;
+}
+
+bool JsonReader::ParseString(std::wstring& out) {
+    out.clear();
+    if (!Expect('"')) return false;
+
+    for (;;) {
+        const char* stop = FindQuoteOrEscape(p_, end_);
+        AppendUtf8(out, p_, stop - p_);
+        p_ = stop;
+        if (p_ >= end_) return false;
+        if (*p_ == '"') {
+            p_++;
+            return true;
+        }
+
+        // Escape sequence
+        p_++;
+        if (p_ >= end_) return false;
+        char ch = *p_++;
+        switch (ch) {
+        case 'n':  out += L'\n'; break;
+        case 't':  out += L'\t'; break;
+        case 'r':  out += L'\r'; break;
+        case 'b':  out += L'\b'; break;
+        case 'f':  out += L'\f'; break;
+        case 'u': {
+            // One UTF-16 unit; surrogate pairs arrive as two escapes in a row
+            unsigned int unit = 0;
+            for (int i = 0; i < 4; i++) {
+                int d = (p_ < end_) ? HexDigit(*p_) : -1;
+                if (d < 0) return false;
+                unit = (unit << 4) | d;
+                p_++;
+            }
+            out += static_cast<wchar_t>(unit);
+            break;
+        }
+        default:   out += static_cast<wchar_t>(ch); break; // '"', '\\', '/'
+        }
+    }
+}
+
+uint64_t JsonReader::ParseNumber() {
+    SkipWS();
+    uint64_t val = 0;
+    while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+        val = val * 10 + (*p_ - '0');
+        p_++;
+    }
+    return val;
+}
+
+void JsonReader::SkipString() {
+    p_++; // opening quote
+    for (;;) {
+        p_ = FindQuoteOrEscape(p_, end_);
+        if (p_ >= end_) return;
+        if (*p_ == '"') {
+            p_++;
+            return;
+        }
+        // Backslash and the escaped char; a log cut off after the backslash ends here
+        p_ = (end_ - p_ > 1) ? p_ + 2 : end_;
+    }
+}
+
+void JsonReader::SkipValue() {
+    SkipWS();
+    if (p_ >= end_) return;
+    if (*p_ == '"') {
+        SkipString();
+    } else if (*p_ == '{' || *p_ == '[') {
+        int depth = 0;
+        while (p_ < end_) {
+            char ch = *p_;
+            if (ch == '"') {
+                SkipString();
+                continue;
+            }
+            if (ch == '{' || ch == '[') depth++;
+            else if (ch == '}' || ch == ']') depth--;
+            p_++;
+            if (depth == 0) break;
+        }
+    } else {
+        // number, true, false, null
+        while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']'
+               && *p_ != ' ' && *p_ != '\t' && *p_ != '\r' && *p_ != '\n')
+            p_++;
+    }
+}
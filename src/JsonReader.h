@@ -0,0 +1,43 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+
+// Forward-only pull parser over UTF-8 JSON in memory (typically a mapped
+// file). Nothing is copied or widened until a value is asked for: keys are
+// compared as raw bytes, and strings are scanned 16 bytes at a time for the
+// closing quote or an escape, then widened once, straight into the caller's
+// string.
+class JsonReader {
+public:
+    JsonReader(const char* data, size_t size);
+
+    // Skip whitespace; true if the next char is ch (not consumed)
+    bool Peek(char ch);
+
+    // Skip whitespace; consume ch if it is next
+    bool Expect(char ch);
+
+    // Read a string with no escapes as raw UTF-8 bytes (object keys)
+    bool ParseKey(const char*& key, size_t& length);
+
+    // Read a string value, decoding escapes, into out (replaces its contents)
+    bool ParseString(std::wstring& out);
+
+    // Read an unsigned integer value
+    uint64_t ParseNumber();
+
+    // Skip any value (string, number, object, array, literal)
+    void SkipValue();
+
+    bool AtEnd();
+
+    static bool KeyIs(const char* key, size_t length, const char* name);
+
+private:
+    void SkipWS();
+    void SkipString();
+
+    const char* p_;
+    const char* end_;
+};
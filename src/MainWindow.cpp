@@ -3,6 +3,7 @@
 #include <windowsx.h>
 #include <shobjidl.h>
 #include <shlobj.h>
+#include <algorithm>
 
 const wchar_t* MainWindow::CLASS_NAME = L"DSplitMainWindow";
 
@@ -12,6 +13,29 @@ static const int BUTTON_HEIGHT = 28;
 static const int LABEL_HEIGHT = 18;
 static const int SPLITTER_GAP = 12;
 
+// Source scan: how often scanned folders are moved into the tree, and for
+// how long each time, so input is never held up for more than a frame or two
+static const UINT SCAN_PUMP_INTERVAL_MS = 100;
+static const DWORD SCAN_PUMP_BUDGET_MS = 30;
+
+// Changes tend to come in bursts (a copy, an unzip); let one settle before
+// re-listing the folders it touched
+static const UINT SOURCE_SETTLE_MS = 500;
+
+// Check box changes patch the plan in place; once the bytes patched in or
+// out since the last full packing pass this share of the plan, it is
+// packed again
+static const uint64_t REPACK_CHURN_PERCENT = 25;
+
+// Time the optimal fill may search for, over all drives; it runs on a
+// worker thread. A check box patch places only the files that changed, on
+// the UI thread, so it gets a short budget of its own.
+static const DWORD FILL_BUDGETS_MS[] = { 500, 2000, 5000, 10000 };
+static const wchar_t* FILL_BUDGET_NAMES[] = { L"0.5 s", L"2 s", L"5 s", L"10 s" };
+static const int FILL_BUDGET_COUNT = 4;
+static const int DEFAULT_FILL_BUDGET = 1;
+static const DWORD PATCH_FILL_BUDGET_MS = 50;
+
 // ---------- Window registration & creation ----------
 
 bool MainWindow::Register(HINSTANCE hInstance) {
@@ -72,10 +96,7 @@ LRESULT CALLBACK MainWindow::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
                 case CDDS_PREPAINT:
                     return CDRF_NOTIFYITEMDRAW;
                 case CDDS_ITEMPREPAINT: {
-                    HTREEITEM hItem = reinterpret_cast<HTREEITEM>(cd->nmcd.dwItemSpec);
-                    auto& itemMap = self->fileTree_.GetItemMap();
-                    auto it = itemMap.find(hItem);
-                    if (it != itemMap.end() && self->fileTree_.IsTransferred(it->second.relativePath)) {
+                    if (self->fileTree_.IsItemTransferred(cd->nmcd.lItemlParam)) {
                         cd->clrText = GetSysColor(COLOR_GRAYTEXT);
                     }
                     return CDRF_DODEFAULT;
@@ -86,7 +107,7 @@ LRESULT CALLBACK MainWindow::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
         return 0;
 
     case WM_MIGRATION_PROGRESS:
-        if (self) self->OnMigrationProgress(static_cast<int>(wParam));
+        if (self) self->OnMigrationProgress(static_cast<int>(wParam), static_cast<int>(lParam));
         return 0;
 
     case WM_MIGRATION_FILE:
@@ -109,11 +130,35 @@ LRESULT CALLBACK MainWindow::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
         }
         return 0;
 
+    case WM_SCAN_COMPLETE:
+        if (self) self->OnScanComplete(wParam != 0);
+        return 0;
+
+    case WM_FILL_COMPLETE:
+        if (self) self->OnFillComplete();
+        return 0;
+
+    case WM_SOURCE_CHANGED:
+        if (self) self->OnSourceChanged();
+        return 0;
+
+    case WM_TIMER:
+        if (self && wParam == IDT_SCAN_PUMP) {
+            self->OnScanTimer();
+            return 0;
+        }
+        if (self && wParam == IDT_SOURCE_CHANGES) {
+            self->OnSourceChangesTimer();
+            return 0;
+        }
+        break;
+
     case WM_TREE_CHECK_CHANGED:
         if (self) {
             HTREEITEM hItem = reinterpret_cast<HTREEITEM>(lParam);
-            self->fileTree_.OnCheckChanged(hItem);
-            self->UpdateAssignments();
+            FileTree::ChangeDelta delta;
+            self->fileTree_.OnCheckChanged(hItem, delta);
+            self->ApplySelectionDelta(delta);
         }
         return 0;
 
@@ -144,6 +189,7 @@ void MainWindow::OnCreate(HWND hWnd) {
     } else {
         exeDir_ = L".";
     }
+    driveProfilePath_ = DriveProfile::GetProfilePath(exeDir_);
 
     // Create font
     NONCLIENTMETRICSW ncm = {};
@@ -185,6 +231,20 @@ void MainWindow::OnCreate(HWND hWnd) {
         BS_PUSHBUTTON, IDC_ADD_DRIVE_BTN);
     hRemoveDriveBtn_ = createCtrl(L"BUTTON", L"Remove",
         BS_PUSHBUTTON, IDC_REMOVE_DRIVE_BTN);
+    hPackMethodCombo_ = createCtrl(L"COMBOBOX", L"",
+        CBS_DROPDOWNLIST | WS_VSCROLL, IDC_PACK_METHOD);
+    for (int m = 0; m < static_cast<int>(PackMethod::Count); m++) {
+        SendMessageW(hPackMethodCombo_, CB_ADDSTRING, 0,
+            reinterpret_cast<LPARAM>(Packer::GetName(static_cast<PackMethod>(m))));
+    }
+    SendMessageW(hPackMethodCombo_, CB_SETCURSEL, 0, 0);
+    hFillBudgetCombo_ = createCtrl(L"COMBOBOX", L"",
+        CBS_DROPDOWNLIST | WS_VSCROLL, IDC_FILL_BUDGET);
+    for (int b = 0; b < FILL_BUDGET_COUNT; b++) {
+        SendMessageW(hFillBudgetCombo_, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(FILL_BUDGET_NAMES[b]));
+    }
+    SendMessageW(hFillBudgetCombo_, CB_SETCURSEL, DEFAULT_FILL_BUDGET, 0);
+    EnableWindow(hFillBudgetCombo_, FALSE);
 
     // Destination TreeView (no checkboxes — display only)
     hDestTreeView_ = CreateWindowExW(
@@ -221,6 +281,11 @@ void MainWindow::OnCreate(HWND hWnd) {
     hVerifyCheck_ = createCtrl(L"BUTTON", L"Verify before delete",
         BS_AUTOCHECKBOX, IDC_VERIFY_CHECK);
     SendMessageW(hVerifyCheck_, BM_SETCHECK, BST_CHECKED, 0);
+    hVerifyModeCombo_ = createCtrl(L"COMBOBOX", L"",
+        CBS_DROPDOWNLIST | WS_VSCROLL, IDC_VERIFY_MODE);
+    SendMessageW(hVerifyModeCombo_, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"Hash (read dest)"));
+    SendMessageW(hVerifyModeCombo_, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(L"Byte compare"));
+    SendMessageW(hVerifyModeCombo_, CB_SETCURSEL, 0, 0);
 
     // Progress section (hidden by default)
     hProgressBar_ = CreateWindowExW(0, PROGRESS_CLASSW, L"",
@@ -272,12 +337,19 @@ void MainWindow::OnSize(int width, int height) {
     MoveWindow(hSourceLabel_, leftX, y, halfWidth, LABEL_HEIGHT, TRUE);
 
     // --- Right column: Destination label + buttons ---
+    int packWidth = 160;
+    int budgetWidth = 60;
     int addBtnWidth = 80;
     int rmBtnWidth = 70;
-    int labelWidth = halfWidth - addBtnWidth - rmBtnWidth - 12;
+    int labelWidth = halfWidth - packWidth - budgetWidth - addBtnWidth - rmBtnWidth - 20;
     MoveWindow(hDestLabel_, rightX, y, labelWidth, LABEL_HEIGHT, TRUE);
-    MoveWindow(hAddDriveBtn_, rightX + labelWidth + 6, y - 3, addBtnWidth, CONTROL_HEIGHT, TRUE);
-    MoveWindow(hRemoveDriveBtn_, rightX + labelWidth + 6 + addBtnWidth + 4, y - 3, rmBtnWidth, CONTROL_HEIGHT, TRUE);
+    int hx = rightX + labelWidth + 6;
+    MoveWindow(hPackMethodCombo_, hx, y - 2, packWidth, 120, TRUE);
+    hx += packWidth + 4;
+    MoveWindow(hFillBudgetCombo_, hx, y - 2, budgetWidth, 100, TRUE);
+    hx += budgetWidth + 4;
+    MoveWindow(hAddDriveBtn_, hx, y - 3, addBtnWidth, CONTROL_HEIGHT, TRUE);
+    MoveWindow(hRemoveDriveBtn_, hx + addBtnWidth + 4, y - 3, rmBtnWidth, CONTROL_HEIGHT, TRUE);
 
     y += LABEL_HEIGHT + 4;
 
@@ -327,7 +399,9 @@ void MainWindow::OnSize(int width, int height) {
     bx += actionBtnWidth + btnSpacing;
     MoveWindow(hMoveBtn_, bx, y, actionBtnWidth, BUTTON_HEIGHT, TRUE);
     bx += actionBtnWidth + btnSpacing;
-    MoveWindow(hVerifyCheck_, bx, y, 160, BUTTON_HEIGHT, TRUE);
+    MoveWindow(hVerifyCheck_, bx, y, 140, BUTTON_HEIGHT, TRUE);
+    bx += 140 + btnSpacing;
+    MoveWindow(hVerifyModeCombo_, bx, y + 2, 130, 100, TRUE);
     y += BUTTON_HEIGHT + MARGIN;
 
     // Progress bar + label + cancel
@@ -335,7 +409,7 @@ void MainWindow::OnSize(int width, int height) {
     MoveWindow(hProgressBar_, MARGIN, y, contentWidth - cancelWidth - 6, CONTROL_HEIGHT, TRUE);
     MoveWindow(hCancelBtn_, MARGIN + contentWidth - cancelWidth, y, cancelWidth, CONTROL_HEIGHT, TRUE);
     y += CONTROL_HEIGHT + 2;
-    int speedWidth = 160;
+    int speedWidth = 280;
     MoveWindow(hProgressLabel_, MARGIN, y, contentWidth - speedWidth - 6, LABEL_HEIGHT, TRUE);
     MoveWindow(hSpeedLabel_, MARGIN + contentWidth - speedWidth, y, speedWidth, LABEL_HEIGHT, TRUE);
 }
@@ -366,6 +440,15 @@ void MainWindow::OnCommand(WORD id, WORD code) {
     case IDC_ADD_DRIVE_BTN:
         OnAddDrive();
         break;
+    case IDC_PACK_METHOD:
+        if (code == CBN_SELCHANGE) {
+            EnableWindow(hFillBudgetCombo_, GetPackMethod() == PackMethod::OptimalFill);
+            UpdateAssignments();
+        }
+        break;
+    case IDC_FILL_BUDGET:
+        if (code == CBN_SELCHANGE) UpdateAssignments();
+        break;
     case IDC_REMOVE_DRIVE_BTN:
         OnRemoveDrive();
         break;
@@ -386,6 +469,14 @@ void MainWindow::OnNotify(NMHDR* pnm) {
                 PostMessageW(hWnd_, WM_TREE_CHECK_CHANGED, 0,
                     reinterpret_cast<LPARAM>(hItem));
             }
+        } else if (pnm->code == TVN_GETDISPINFOW) {
+            fileTree_.OnGetDispInfo(reinterpret_cast<NMTVDISPINFOW*>(pnm));
+        } else if (pnm->code == TVN_ITEMEXPANDINGW) {
+            fileTree_.OnItemExpanding(reinterpret_cast<NMTREEVIEWW*>(pnm));
+        } else if (pnm->code == TVN_ITEMEXPANDEDW) {
+            fileTree_.OnItemExpanded(reinterpret_cast<NMTREEVIEWW*>(pnm));
+        } else if (pnm->code == TVN_DELETEITEMW) {
+            fileTree_.OnDeleteItem(reinterpret_cast<NMTREEVIEWW*>(pnm));
         } else if (pnm->code == TVN_KEYDOWN) {
             auto* kd = reinterpret_cast<NMTVKEYDOWN*>(pnm);
             if (kd->wVKey == VK_SPACE) {
@@ -452,7 +543,10 @@ void MainWindow::OnAddDrive() {
     DestroyMenu(hMenu);
 
     if (sel >= 1000 && sel < 1000 + static_cast<int>(available.size())) {
-        destTree_.AddDrive(available[sel - 1000]);
+        DriveEntry drive = available[sel - 1000];
+        drive.speed = DriveProfile::GetSpeed(driveProfilePath_,
+            TransferLog::FormatSerial(drive.serialNumber), drive.rootPath);
+        destTree_.AddDrive(drive);
         UpdateAssignments();
     }
 }
@@ -491,24 +585,26 @@ void MainWindow::OnRemoveDrive() {
     if (MessageBoxW(hWnd_, msg.c_str(), L"DSplit", MB_YESNO | MB_ICONQUESTION) != IDYES)
         return;
 
-    // Clear assignments for this drive, re-index remaining
-    std::unordered_map<std::wstring, int> newAssignments;
-    for (auto& [path, idx] : assignments_) {
-        if (idx == driveIndex) continue;
-        int newIdx = (idx > driveIndex) ? idx - 1 : idx;
-        newAssignments[path] = newIdx;
-    }
-    assignments_ = std::move(newAssignments);
-
+    // Pack the selection again onto the drives left
     destTree_.RemoveDrive(driveIndex);
-    OnAssignmentsChanged();
+    UpdateAssignments();
 }
 
 // ---------- Assignment model ----------
 
 void MainWindow::UpdateAssignments() {
+    // A fill still searching is stopped; once it has, the plan is packed again
+    if (fillPending_) {
+        fillStale_ = true;
+        fill_.Cancel();
+        return;
+    }
+
     assignments_.clear();
     fileSizes_.clear();
+    RecountAssignments();
+    churnBytes_ = 0;
+    fillReport_.clear();
 
     int driveCount = destTree_.GetDriveCount();
     if (driveCount == 0) {
@@ -522,38 +618,266 @@ void MainWindow::UpdateAssignments() {
     // Build file sizes map
     for (auto& f : selectedFiles) {
         if (!f.isDirectory) {
-            fileSizes_[f.relativePath] = f.size;
+            fileSizes_[f.path] = f.size;
         }
     }
 
-    // Track available space per drive
-    std::vector<uint64_t> available(driveCount);
-    for (int i = 0; i < driveCount; i++) {
-        available[i] = destTree_.GetDrive(i).freeBytes;
-    }
-
-    // Assign files to drives: skip transferred, assign to first drive with room
+    // Assign files to drives with the chosen packing, skipping transferred
+    std::vector<PackItem> items;
     for (auto& f : selectedFiles) {
         if (f.isDirectory) continue;
+        if (transferLog_.Contains(fileTree_.GetRelativePath(f.path))) continue;
+        items.push_back({ f.path, f.size });
+    }
+    PackSelection(std::move(items), {});
+}
 
-        // Skip already transferred
-        if (transferLog_.Contains(f.relativePath)) continue;
+PackMethod MainWindow::GetPackMethod() const {
+    LRESULT sel = SendMessageW(hPackMethodCombo_, CB_GETCURSEL, 0, 0);
+    if (sel < 0 || sel >= static_cast<LRESULT>(PackMethod::Count)) return PackMethod::FirstFit;
+    return static_cast<PackMethod>(sel);
+}
 
-        // Find first drive with enough space
-        for (int i = 0; i < driveCount; i++) {
-            if (f.size <= available[i]) {
-                assignments_[f.relativePath] = i;
-                available[i] -= f.size;
-                break;
-            }
-        }
+DWORD MainWindow::GetFillBudget() const {
+    LRESULT sel = SendMessageW(hFillBudgetCombo_, CB_GETCURSEL, 0, 0);
+    if (sel < 0 || sel >= FILL_BUDGET_COUNT) sel = DEFAULT_FILL_BUDGET;
+    return FILL_BUDGETS_MS[sel];
+}
+
+// Pack items onto the drives with the chosen method and put the result in
+// place. An optimal fill searches on a worker thread instead: the plan stays
+// empty until OnFillComplete applies it.
+void MainWindow::PackSelection(std::vector<PackItem> items, std::vector<NodeId> nodes) {
+    std::vector<PackDrive> drives = GetPackDrives();
+    PackMethod method = GetPackMethod();
+    if (method == PackMethod::OptimalFill) {
+        fillNodes_ = std::move(nodes);
+        fillPending_ = true;
+        fillStale_ = false;
+        fillReport_ = L" | Filling drives...";
+        UpdateActionButtons();
+        fill_.Start(hWnd_, std::move(items), std::move(drives), GetFillBudget());
+        OnAssignmentsChanged();
+        return;
     }
 
+    std::vector<int> placement;
+    fillReport_.clear();
+    Packer::Pack(method, items, fileTree_.GetPaths(), drives, placement);
+    ApplyPacking(items, placement, nodes);
+}
+
+// Each placed file joins the plan on its drive; with nodes (auto-select),
+// its box is checked too
+void MainWindow::ApplyPacking(const std::vector<PackItem>& items, const std::vector<int>& placement,
+                              const std::vector<NodeId>& nodes) {
+    if (!nodes.empty()) SendMessageW(hTreeView_, WM_SETREDRAW, FALSE, 0);
+
+    for (size_t k = 0; k < items.size(); k++) {
+        if (placement[k] < 0) continue;
+        if (!nodes.empty()) fileTree_.SetNodeChecked(nodes[k], true);
+        fileSizes_[items[k].path] = items[k].size;
+        assignments_[items[k].path] = placement[k];
+    }
+
+    if (!nodes.empty()) {
+        fileTree_.PropagateCheckStates();
+        SendMessageW(hTreeView_, WM_SETREDRAW, TRUE, 0);
+        InvalidateRect(hTreeView_, nullptr, TRUE);
+    }
+
+    churnBytes_ = 0;
     OnAssignmentsChanged();
 }
 
+// The background fill is done. If the selection or drives changed while it
+// searched, its result is dropped and the plan packed again; otherwise it is
+// applied, with a status bar note on how it did against greedy.
+void MainWindow::OnFillComplete() {
+    fill_.Wait();
+    fillPending_ = false;
+    UpdateActionButtons();
+    std::vector<NodeId> nodes = std::move(fillNodes_);
+    fillNodes_.clear();
+    fillReport_.clear();
+
+    if (fillStale_) {
+        fillStale_ = false;
+        UpdateAssignments();
+        return;
+    }
+
+    const FillReport& fill = fill_.GetReport();
+    if (fill.room > 0) {
+        // Each drive's search is exact for that drive given the ones before
+        // it; only with one drive is that the best of the whole plan
+        const wchar_t* note = L"";
+        if (fill.optimal) {
+            note = fill_.GetDrives().size() == 1 ? L", best possible" : L", each drive filled exactly";
+        }
+        wchar_t buf[112];
+        swprintf_s(buf, L" | Fill: %.2f%% (greedy %.2f%%%s)",
+            100.0 * fill.placedBytes / fill.room, 100.0 * fill.greedyBytes / fill.room, note);
+        fillReport_ = buf;
+    }
+    ApplyPacking(fill_.GetItems(), fill_.GetPlacement(), nodes);
+}
+
+// Auto-Select, Copy and Move need the whole tree and a settled plan: they
+// wait while a migration, scan or fill runs
+void MainWindow::UpdateActionButtons() {
+    bool enable = !migrating_ && !fileTree_.IsScanning() && !fillPending_;
+    EnableWindow(hAutoSelectBtn_, enable);
+    EnableWindow(hCopyBtn_, enable);
+    EnableWindow(hMoveBtn_, enable);
+}
+
+std::vector<PackDrive> MainWindow::GetPackDrives() const {
+    std::vector<PackDrive> drives(destTree_.GetDriveCount());
+    for (int i = 0; i < destTree_.GetDriveCount(); i++) {
+        const DriveEntry& drive = destTree_.GetDrive(i);
+        uint64_t assigned = i < static_cast<int>(driveLoads_.size()) ? driveLoads_[i].bytes : 0;
+        drives[i].available = drive.freeBytes > assigned ? drive.freeBytes - assigned : 0;
+        drives[i].speed = drive.speed;
+        drives[i].seconds = i < static_cast<int>(finishSeconds_.size()) ? finishSeconds_[i] : 0;
+    }
+    return drives;
+}
+
+void MainWindow::RecountAssignments() {
+    int driveCount = destTree_.GetDriveCount();
+    driveLoads_.assign(driveCount, DriveLoad());
+    assignedBytes_ = 0;
+
+    // Predicted copy time of the plan on each drive
+    std::vector<PackItem> items;
+    std::vector<int> drives;
+    std::vector<DriveSpeed> speeds;
+    items.reserve(assignments_.size());
+    drives.reserve(assignments_.size());
+    for (auto& [path, idx] : assignments_) {
+        auto sizeIt = fileSizes_.find(path);
+        uint64_t size = sizeIt != fileSizes_.end() ? sizeIt->second : 0;
+        items.push_back({ path, size });
+        drives.push_back(idx);
+        driveLoads_[idx].bytes += size;
+        driveLoads_[idx].files++;
+        assignedBytes_ += size;
+    }
+    for (int i = 0; i < driveCount; i++) {
+        speeds.push_back(destTree_.GetDrive(i).speed);
+    }
+    finishSeconds_ = Packer::Simulate(items, drives, speeds);
+}
+
+void MainWindow::UpdateDriveLabels() {
+    for (int i = 0; i < destTree_.GetDriveCount(); i++) {
+        destTree_.SetDriveLabel(i, driveLoads_[i].bytes, finishSeconds_[i]);
+    }
+}
+
 void MainWindow::OnAssignmentsChanged() {
-    destTree_.Rebuild(assignments_, fileSizes_);
+    RecountAssignments();
+    destTree_.Rebuild(assignments_, fileSizes_, fileTree_.GetPaths());
+    UpdateDriveLabels();
+    UpdateStatusBar();
+}
+
+void MainWindow::AssignFile(PathId path, uint64_t size, int drive) {
+    assignments_[path] = drive;
+    driveLoads_[drive].bytes += size;
+    driveLoads_[drive].files++;
+    assignedBytes_ += size;
+    destTree_.AddFile(drive, path, size, fileTree_.GetPaths());
+}
+
+int MainWindow::UnassignFile(PathId path) {
+    auto it = assignments_.find(path);
+    if (it == assignments_.end()) return -1;
+    int drive = it->second;
+    uint64_t size = fileSizes_[path];
+    driveLoads_[drive].bytes -= size;
+    driveLoads_[drive].files--;
+    assignedBytes_ -= size;
+    destTree_.RemoveFile(drive, path, fileTree_.GetPaths());
+    assignments_.erase(it);
+    return drive;
+}
+
+// Patch the plan for a change in the selection, from a check box or from
+// files changing on disk: files that are gone or unchecked come off their
+// drive, and new, resized or checked files are packed onto the room left
+// (a resized file stays put if it still fits). Costs what changed, not the
+// size of the selection; once the patches add up, the plan is packed again.
+void MainWindow::ApplySelectionDelta(const FileTree::ChangeDelta& delta) {
+    if (delta.removed.empty() && delta.updated.empty()) return;
+
+    // No plan to patch while a fill searches: it starts over instead
+    if (fillPending_) {
+        UpdateAssignments();
+        return;
+    }
+
+    int driveCount = destTree_.GetDriveCount();
+    if (driveCount == 0) {
+        UpdateStatusBar();
+        return;
+    }
+
+    SendMessageW(hDestTreeView_, WM_SETREDRAW, FALSE, 0);
+
+    for (PathId path : delta.removed) {
+        if (UnassignFile(path) >= 0) churnBytes_ += fileSizes_[path];
+        fileSizes_.erase(path);
+    }
+
+    std::vector<PackItem> items;
+    for (auto& f : delta.updated) {
+        int previous = UnassignFile(f.path);
+        uint64_t previousSize = fileSizes_[f.path];
+        fileSizes_[f.path] = f.size;
+        if (transferLog_.Contains(fileTree_.GetRelativePath(f.path))) continue;
+
+        if (previous >= 0 &&
+            driveLoads_[previous].bytes + f.size <= destTree_.GetDrive(previous).freeBytes) {
+            AssignFile(f.path, f.size, previous);
+            continue;
+        }
+        if (previous >= 0) churnBytes_ += previousSize;
+        items.push_back({ f.path, f.size });
+    }
+
+    if (!items.empty()) {
+        // Files joining a folder the plan already has go to its drive
+        if (GetPackMethod() == PackMethod::KeepFoldersTogether) {
+            for (auto& item : items) item.home = destTree_.FindFolderDrive(item.path, fileTree_.GetPaths());
+        }
+        std::vector<PackDrive> drives = GetPackDrives();
+        std::vector<int> placement;
+        FillReport fill;
+        fill.budgetMs = PATCH_FILL_BUDGET_MS;
+        Packer::Pack(GetPackMethod(), items, fileTree_.GetPaths(), drives, placement, &fill);
+        for (size_t k = 0; k < items.size(); k++) {
+            if (placement[k] < 0) continue;
+            AssignFile(items[k].path, items[k].size, placement[k]);
+            churnBytes_ += items[k].size;
+        }
+    }
+
+    SendMessageW(hDestTreeView_, WM_SETREDRAW, TRUE, 0);
+
+    // Patches are placed greedily in the order they come; once they make up
+    // a good share of the plan, pack it all again the chosen way
+    if (churnBytes_ * 100 > assignedBytes_ * REPACK_CHURN_PERCENT) {
+        UpdateAssignments();
+        return;
+    }
+
+    for (int i = 0; i < driveCount; i++) {
+        finishSeconds_[i] = destTree_.GetDrive(i).speed.Predict(driveLoads_[i].bytes, driveLoads_[i].files);
+    }
+    UpdateDriveLabels();
+    InvalidateRect(hDestTreeView_, nullptr, TRUE);
     UpdateStatusBar();
 }
 
@@ -593,10 +917,11 @@ void MainWindow::OnBrowseFolder() {
                     transferLog_.SetSourcePath(path);
 
                     // Set transferred paths for dimming
-                    fileTree_.SetTransferredPaths(&transferLog_.GetPathMap());
+                    fileTree_.SetTransferredPaths(&transferLog_);
 
-                    // Populate source tree
-                    fileTree_.Populate(path);
+                    // Populate source tree in the background
+                    fileTree_.Populate(path, TransferLog::GetScanPath(jsonLogPath_), hWnd_);
+                    SetScanInProgress(true);
 
                     UpdateAssignments();
                     CoTaskMemFree(path);
@@ -627,47 +952,26 @@ void MainWindow::OnAutoSelect() {
         return;
     }
 
-    // Calculate total available across all drives
-    uint64_t totalAvailable = 0;
-    for (int i = 0; i < driveCount; i++) {
-        totalAvailable += destTree_.GetDrive(i).freeBytes;
-    }
-
-    // Deselect all first
+    // Deselect all first, and start from empty drives
     fileTree_.DeselectAll();
+    assignments_.clear();
+    fileSizes_.clear();
+    RecountAssignments();
 
     // Get all leaf files
     auto leaves = fileTree_.GetAllLeafFiles();
 
-    // Track available space per drive
-    std::vector<uint64_t> available(driveCount);
-    for (int i = 0; i < driveCount; i++) {
-        available[i] = destTree_.GetDrive(i).freeBytes;
-    }
-
-    // Greedy fill across drives
-    SendMessageW(hTreeView_, WM_SETREDRAW, FALSE, 0);
-
+    // Fill the drives with the chosen packing, skipping transferred files,
+    // and keep the plan that chose them (packing just the chosen files again
+    // need not place them all, with an optimal fill cut short by its budget)
+    std::vector<PackItem> items;
+    std::vector<NodeId> nodes;
     for (auto& leaf : leaves) {
-        // Skip transferred
-        if (transferLog_.Contains(leaf.relativePath)) continue;
-
-        // Find first drive with space
-        for (int i = 0; i < driveCount; i++) {
-            if (leaf.size <= available[i]) {
-                available[i] -= leaf.size;
-                fileTree_.SetItemChecked(leaf.hItem, true);
-                break;
-            }
-        }
+        if (transferLog_.Contains(fileTree_.GetRelativePath(leaf.path))) continue;
+        items.push_back({ leaf.path, leaf.size });
+        nodes.push_back(leaf.node);
     }
-
-    fileTree_.PropagateCheckStates();
-
-    SendMessageW(hTreeView_, WM_SETREDRAW, TRUE, 0);
-    InvalidateRect(hTreeView_, nullptr, TRUE);
-
-    UpdateAssignments();
+    PackSelection(std::move(items), std::move(nodes));
 }
 
 void MainWindow::OnCopy() {
@@ -684,7 +988,11 @@ void MainWindow::OnMove() {
 }
 
 void MainWindow::OnCancel() {
-    migration_.Cancel();
+    if (fileTree_.IsScanning()) {
+        fileTree_.CancelScan();
+    } else {
+        migration_.Cancel();
+    }
 }
 
 void MainWindow::StartMigration(bool moveMode) {
@@ -723,7 +1031,10 @@ void MainWindow::StartMigration(bool moveMode) {
     params.moveMode = moveMode;
     params.verifyBeforeDelete = moveMode &&
         (SendMessageW(hVerifyCheck_, BM_GETCHECK, 0, 0) == BST_CHECKED);
+    params.verifyMethod = SendMessageW(hVerifyModeCombo_, CB_GETCURSEL, 0, 0) == 1
+        ? VerifyMethod::Compare : VerifyMethod::Hash;
     params.jsonLogPath = jsonLogPath_;
+    params.driveProfilePath = driveProfilePath_;
 
     // Build drives list
     for (int i = 0; i < destTree_.GetDriveCount(); i++) {
@@ -740,33 +1051,34 @@ void MainWindow::StartMigration(bool moveMode) {
     // First pass: collect all checked items (dirs + files)
     auto selectedFiles = fileTree_.GetSelectedFiles();
 
+    // Every (folder, drive) pair that has an assigned file somewhere below it:
+    // walk each file's ancestors, stopping at the first one already recorded
+    const PathStore& paths = fileTree_.GetPaths();
+    std::unordered_set<uint64_t> dirDrives;
+    for (auto& [path, idx] : assignments_) {
+        for (PathId dir = paths.GetParent(path); dir != NO_PATH; dir = paths.GetParent(dir)) {
+            if (!dirDrives.insert((static_cast<uint64_t>(dir) << 32) | static_cast<uint32_t>(idx)).second)
+                break;
+        }
+    }
+
     uint64_t totalBytes = 0;
     for (auto& f : selectedFiles) {
         MigrationItem item;
-        item.sourcePath = f.sourcePath;
-        item.relativePath = f.relativePath;
+        item.sourcePath = fileTree_.GetFullPath(f.path);
+        item.relativePath = fileTree_.GetRelativePath(f.path);
         item.fileSize = f.size;
         item.isDirectory = f.isDirectory;
 
         if (f.isDirectory) {
-            // Directories go to all drives that have files in them
-            // We'll set driveIndex = 0 and handle dir creation for all drives
-            item.destDriveIndex = -1; // will be handled specially in migration
-            // Actually, we need to create dirs on all destination drives.
-            // Add a dir item for each drive that has files under this dir.
-            std::unordered_set<int> drivesForDir;
-            for (auto& [path, idx] : assignments_) {
-                // Check if path starts with this dir's relative path
-                if (path.size() > f.relativePath.size() &&
-                    path[f.relativePath.size()] == L'\\' &&
-                    _wcsnicmp(path.c_str(), f.relativePath.c_str(), f.relativePath.size()) == 0) {
-                    drivesForDir.insert(idx);
-                }
-            }
-            for (int driveIdx : drivesForDir) {
+            // Directories go to all drives that have files in them:
+            // add a dir item for each such drive
+            for (int driveIdx = 0; driveIdx < destTree_.GetDriveCount(); driveIdx++) {
+                if (!dirDrives.count((static_cast<uint64_t>(f.path) << 32) | static_cast<uint32_t>(driveIdx)))
+                    continue;
                 MigrationItem dirItem;
-                dirItem.sourcePath = f.sourcePath;
-                dirItem.relativePath = f.relativePath;
+                dirItem.sourcePath = item.sourcePath;
+                dirItem.relativePath = item.relativePath;
                 dirItem.fileSize = 0;
                 dirItem.isDirectory = true;
                 dirItem.destDriveIndex = driveIdx;
@@ -776,7 +1088,7 @@ void MainWindow::StartMigration(bool moveMode) {
         }
 
         // Look up assignment for this file
-        auto assignIt = assignments_.find(f.relativePath);
+        auto assignIt = assignments_.find(f.path);
         if (assignIt == assignments_.end()) continue; // not assigned (transferred or no room)
 
         item.destDriveIndex = assignIt->second;
@@ -793,18 +1105,20 @@ void MainWindow::StartMigration(bool moveMode) {
     params.totalBytes = totalBytes;
     migrationTotalBytes_ = totalBytes;
     SetOperationInProgress(true);
+
+    BufferPool::Instance().ResetPeak();
+    poolStart_ = BufferPool::Instance().GetStats();
+
+    // The migration rewrites the catalog, which Windows refuses while this
+    // copy of the log still has it mapped; OnMigrationComplete reloads it
+    transferLog_.Clear();
     migration_.Start(params);
 }
 
 void MainWindow::UpdateStatusBar() {
     uint64_t selected = fileTree_.GetSelectedSize();
-    uint64_t assigned = 0;
-    for (auto& [path, idx] : assignments_) {
-        auto sizeIt = fileSizes_.find(path);
-        if (sizeIt != fileSizes_.end()) {
-            assigned += sizeIt->second;
-        }
-    }
+    uint64_t selectedFiles = fileTree_.GetSelectedCount();
+    uint64_t assigned = assignedBytes_;
 
     uint64_t totalAvailable = 0;
     int driveCount = destTree_.GetDriveCount();
@@ -812,11 +1126,19 @@ void MainWindow::UpdateStatusBar() {
         totalAvailable += destTree_.GetDrive(i).freeBytes;
     }
 
+    // The drives copy in parallel, so the job takes as long as the slowest
+    double finish = 0;
+    for (double seconds : finishSeconds_) finish = std::max(finish, seconds);
+
     std::wstring status = L"Selected: " + Utils::FormatSize(selected) +
-                          L" | Assigned: " + Utils::FormatSize(assigned) +
-                          L" | Available: " + Utils::FormatSize(totalAvailable) +
-                          L" across " + std::to_wstring(driveCount) + L" drive";
+                          L" (" + std::to_wstring(selectedFiles) + L" files)" +
+                          L" | Assigned: " + Utils::FormatSize(assigned);
+    if (finish > 0) status += L" (~" + Utils::FormatDuration(finish) + L")";
+    status += fillReport_;
+    status += L" | Available: " + Utils::FormatSize(totalAvailable) +
+              L" across " + std::to_wstring(driveCount) + L" drive";
     if (driveCount != 1) status += L"s";
+    status += poolReport_;
     SetWindowTextW(hStatusLabel_, status.c_str());
 
     // Update capacity bar based on assigned vs total available
@@ -835,6 +1157,8 @@ void MainWindow::UpdateStatusBar() {
 }
 
 void MainWindow::SetOperationInProgress(bool inProgress) {
+    migrating_ = inProgress;
+
     ShowWindow(hProgressBar_, inProgress ? SW_SHOW : SW_HIDE);
     ShowWindow(hProgressLabel_, inProgress ? SW_SHOW : SW_HIDE);
     ShowWindow(hSpeedLabel_, inProgress ? SW_SHOW : SW_HIDE);
@@ -843,12 +1167,13 @@ void MainWindow::SetOperationInProgress(bool inProgress) {
     EnableWindow(hBrowseBtn_, !inProgress);
     EnableWindow(hSelectAllBtn_, !inProgress);
     EnableWindow(hDeselectAllBtn_, !inProgress);
-    EnableWindow(hAutoSelectBtn_, !inProgress);
-    EnableWindow(hCopyBtn_, !inProgress);
-    EnableWindow(hMoveBtn_, !inProgress);
+    UpdateActionButtons();
     EnableWindow(hVerifyCheck_, !inProgress);
+    EnableWindow(hVerifyModeCombo_, !inProgress);
     EnableWindow(hAddDriveBtn_, !inProgress);
     EnableWindow(hRemoveDriveBtn_, !inProgress);
+    EnableWindow(hPackMethodCombo_, !inProgress);
+    EnableWindow(hFillBudgetCombo_, !inProgress && GetPackMethod() == PackMethod::OptimalFill);
 
     if (inProgress) {
         SendMessageW(hProgressBar_, PBM_SETPOS, 0, 0);
@@ -858,7 +1183,68 @@ void MainWindow::SetOperationInProgress(bool inProgress) {
     }
 }
 
-void MainWindow::OnMigrationProgress(int progress) {
+// While the source is scanned the tree stays usable (folders can be opened
+// and checked as they fill in); only actions that need the whole tree wait
+void MainWindow::SetScanInProgress(bool inProgress) {
+    ShowWindow(hProgressLabel_, inProgress ? SW_SHOW : SW_HIDE);
+    ShowWindow(hCancelBtn_, inProgress ? SW_SHOW : SW_HIDE);
+
+    UpdateActionButtons();
+
+    if (inProgress) {
+        SetWindowTextW(hProgressLabel_, L"Scanning...");
+        SetTimer(hWnd_, IDT_SCAN_PUMP, SCAN_PUMP_INTERVAL_MS, nullptr);
+    } else {
+        KillTimer(hWnd_, IDT_SCAN_PUMP);
+    }
+}
+
+void MainWindow::OnScanTimer() {
+    fileTree_.PumpScan(SCAN_PUMP_BUDGET_MS);
+
+    const SourceScan& scan = fileTree_.GetScan();
+    wchar_t buf[256];
+    swprintf_s(buf, L"Scanning: %llu folders (%llu unchanged), %llu files, %s",
+        scan.GetFoldersFound(), scan.GetFoldersReused(), scan.GetFilesFound(),
+        Utils::FormatSize(scan.GetBytesFound()).c_str());
+    SetWindowTextW(hProgressLabel_, buf);
+}
+
+void MainWindow::OnScanComplete(bool cancelled) {
+    if (!fileTree_.FinishScan()) return; // stale: a newer scan is running
+
+    SetScanInProgress(false);
+    UpdateAssignments();
+
+    // Apply whatever changed while the scan was running
+    OnSourceChanged();
+
+    if (cancelled) {
+        MessageBoxW(hWnd_, L"Scan was cancelled; the source tree is incomplete.",
+            L"DSplit", MB_OK | MB_ICONWARNING);
+    }
+}
+
+void MainWindow::OnSourceChanged() {
+    SetTimer(hWnd_, IDT_SOURCE_CHANGES, SOURCE_SETTLE_MS, nullptr);
+}
+
+void MainWindow::OnSourceChangesTimer() {
+    KillTimer(hWnd_, IDT_SOURCE_CHANGES);
+
+    // A migration reads the tree; changes wait until it's done (the scan
+    // holds them back on its own)
+    if (migration_.IsRunning()) return;
+
+    FileTree::ChangeDelta delta;
+    bool more = fileTree_.ApplyChanges(SCAN_PUMP_BUDGET_MS, delta);
+    ApplySelectionDelta(delta);
+    if (more) {
+        SetTimer(hWnd_, IDT_SOURCE_CHANGES, SCAN_PUMP_INTERVAL_MS, nullptr);
+    }
+}
+
+void MainWindow::OnMigrationProgress(int progress, int verifyKBps) {
     SendMessageW(hProgressBar_, PBM_SETPOS, progress, 0);
 
     ULONGLONG elapsed = GetTickCount64() - migrationStartTick_;
@@ -882,6 +1268,11 @@ void MainWindow::OnMigrationProgress(int progress) {
             speed += etaBuf;
         }
 
+        // Verify read-back is reported on its own; it isn't part of the copy rate
+        if (verifyKBps > 0) {
+            speed += L"  Verify " + Utils::FormatSizeShort(static_cast<uint64_t>(verifyKBps) * 1024) + L"/s";
+        }
+
         SetWindowTextW(hSpeedLabel_, speed.c_str());
     }
 }
@@ -896,17 +1287,34 @@ void MainWindow::OnMigrationComplete(int status) {
     // Reload JSON transfer log
     transferLog_.Clear();
     transferLog_.Load(jsonLogPath_);
-    fileTree_.SetTransferredPaths(&transferLog_.GetPathMap());
+    fileTree_.SetTransferredPaths(&transferLog_);
 
-    // Refresh drive info for all dest drives
+    // Refresh drive info for all dest drives; the migration has measured
+    // their speed
     for (int i = 0; i < destTree_.GetDriveCount(); i++) {
-        DriveInfo::RefreshDriveSpace(destTree_.GetDrive(i));
+        DriveEntry& drive = destTree_.GetDrive(i);
+        DriveInfo::RefreshDriveSpace(drive);
+        drive.speed = DriveProfile::GetSpeed(driveProfilePath_,
+            TransferLog::FormatSerial(drive.serialNumber), drive.rootPath);
     }
 
-    // Clear assignments and rebuild
-    assignments_.clear();
-    fileSizes_.clear();
-    OnAssignmentsChanged();
+    // How often the migration's I/O buffers came from the pool's free lists
+    // rather than fresh pages, and the most the pool held
+    BufferPoolStats pool = BufferPool::Instance().GetStats();
+    uint64_t acquires = pool.acquires - poolStart_.acquires;
+    poolReport_.clear();
+    if (acquires > 0) {
+        wchar_t buf[96];
+        swprintf_s(buf, L" | Buffers: %.1f%% reused, peak %s",
+            100.0 * (pool.hits - poolStart_.hits) / acquires, Utils::FormatSizeShort(pool.peakBytes).c_str());
+        poolReport_ = buf;
+    }
+
+    // Pack what is still selected and not transferred onto the room left
+    UpdateAssignments();
+
+    // Source changes (a move deletes the copied files) were held back
+    OnSourceChanged();
 
     if (status == 0) {
         MessageBoxW(hWnd_, L"Migration completed successfully.",
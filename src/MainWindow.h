@@ -10,6 +10,9 @@
 #include "DestinationTree.h"
 #include "Migration.h"
 #include "TransferLog.h"
+#include "Packer.h"
+#include "FillSolver.h"
+#include "BufferPool.h"
 
 // Control IDs
 #define IDC_SOURCE_EDIT     1002
@@ -30,10 +33,17 @@
 #define IDC_DEST_TREE       1017
 #define IDC_ADD_DRIVE_BTN   1018
 #define IDC_REMOVE_DRIVE_BTN 1019
+#define IDC_VERIFY_MODE     1020
+#define IDC_PACK_METHOD     1021
+#define IDC_FILL_BUDGET     1022
 
 // Custom messages
 #define WM_TREE_CHECK_CHANGED (WM_USER + 200)
 
+// Timers
+#define IDT_SCAN_PUMP       1       // moves scanned folders into the source tree
+#define IDT_SOURCE_CHANGES  2       // applies changes seen in the source folder
+
 class MainWindow {
 public:
     static bool Register(HINSTANCE hInstance);
@@ -58,18 +68,40 @@ private:
     void OnRemoveDrive();
     void UpdateStatusBar();
     void SetOperationInProgress(bool inProgress);
+    void SetScanInProgress(bool inProgress);
     void StartMigration(bool moveMode);
 
     // Assignment model
     void UpdateAssignments();
     void OnAssignmentsChanged();
+    PackMethod GetPackMethod() const;
+    DWORD GetFillBudget() const;
+    void PackSelection(std::vector<PackItem> items, std::vector<NodeId> nodes);
+    void ApplyPacking(const std::vector<PackItem>& items, const std::vector<int>& placement,
+                      const std::vector<NodeId>& nodes);
+    void OnFillComplete();
+    void UpdateActionButtons();
+    std::vector<PackDrive> GetPackDrives() const;
+    void RecountAssignments();
+    void UpdateDriveLabels();
+    void AssignFile(PathId path, uint64_t size, int drive);
+    int UnassignFile(PathId path);
+    void ApplySelectionDelta(const FileTree::ChangeDelta& delta);
 
     // Message handlers for migration progress
-    void OnMigrationProgress(int progress);
+    void OnMigrationProgress(int progress, int verifyKBps);
     void OnMigrationFile(const wchar_t* filename);
     void OnMigrationComplete(int status);
     void OnMigrationError(const wchar_t* errorMsg);
 
+    // Source scan
+    void OnScanTimer();
+    void OnScanComplete(bool cancelled);
+
+    // Source change tracking
+    void OnSourceChanged();
+    void OnSourceChangesTimer();
+
     HWND hWnd_ = nullptr;
     HINSTANCE hInstance_ = nullptr;
     HFONT hFont_ = nullptr;
@@ -85,6 +117,8 @@ private:
     HWND hDestTreeView_ = nullptr;
     HWND hAddDriveBtn_ = nullptr;
     HWND hRemoveDriveBtn_ = nullptr;
+    HWND hPackMethodCombo_ = nullptr;
+    HWND hFillBudgetCombo_ = nullptr;
 
     // Controls — bottom (shared)
     HWND hStatusLabel_ = nullptr;
@@ -95,6 +129,7 @@ private:
     HWND hCopyBtn_ = nullptr;
     HWND hMoveBtn_ = nullptr;
     HWND hVerifyCheck_ = nullptr;
+    HWND hVerifyModeCombo_ = nullptr;
     HWND hProgressBar_ = nullptr;
     HWND hProgressLabel_ = nullptr;
     HWND hSpeedLabel_ = nullptr;
@@ -107,13 +142,36 @@ private:
     TransferLog transferLog_;
     std::wstring exeDir_;
     std::wstring jsonLogPath_;
+    std::wstring driveProfilePath_;
     ULONGLONG migrationStartTick_ = 0;
     uint64_t migrationTotalBytes_ = 0;
 
-    // Assignment map: relativePath -> driveIndex in destTree_
-    std::unordered_map<std::wstring, int> assignments_;
-    // File sizes for quick lookup: relativePath -> size
-    std::unordered_map<std::wstring, uint64_t> fileSizes_;
+    // Assignment map: path (in fileTree_'s PathStore) -> driveIndex in destTree_
+    std::unordered_map<PathId, int> assignments_;
+    // File sizes for quick lookup: path -> size
+    std::unordered_map<PathId, uint64_t> fileSizes_;
+    // What each drive holds under the plan, kept up to date as it is
+    // patched, and its predicted copy time
+    struct DriveLoad {
+        uint64_t bytes = 0;
+        uint64_t files = 0;
+    };
+    std::vector<DriveLoad> driveLoads_;
+    std::vector<double> finishSeconds_;
+    uint64_t assignedBytes_ = 0;
+    uint64_t churnBytes_ = 0;       // patched in or out since the last full packing
+    std::wstring fillReport_;       // status bar note on the last full optimal fill
+    std::wstring poolReport_;       // status bar note on the last migration's buffer reuse
+    BufferPoolStats poolStart_;     // buffer pool counters when it started
+
+    // Optimal fill searching in the background; the plan is empty until
+    // it is applied
+    BackgroundFill fill_;
+    std::vector<NodeId> fillNodes_;     // auto-select: the items' nodes, to check
+    bool fillPending_ = false;          // started, WM_FILL_COMPLETE not handled yet
+    bool fillStale_ = false;            // the selection or drives changed meanwhile
+
+    bool migrating_ = false;            // between SetOperationInProgress(true) and (false)
 
     static const wchar_t* CLASS_NAME;
 };
@@ -0,0 +1,43 @@
+#include "MappedFile.h"
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::wstring& path) {
+    Close();
+
+    hFile_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile_ == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER liSize;
+    if (!GetFileSizeEx(hFile_, &liSize) || liSize.QuadPart == 0 ||
+        static_cast<uint64_t>(liSize.QuadPart) > SIZE_MAX) {
+        Close();
+        return false;
+    }
+
+    hMapping_ = CreateFileMappingW(hFile_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!hMapping_) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(hMapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        Close();
+        return false;
+    }
+    size_ = static_cast<size_t>(liSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (hMapping_) CloseHandle(hMapping_);
+    if (hFile_ != INVALID_HANDLE_VALUE) CloseHandle(hFile_);
+    data_ = nullptr;
+    hMapping_ = nullptr;
+    hFile_ = INVALID_HANDLE_VALUE;
+    size_ = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+
+// Read-only view of a whole file mapped into memory
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map path for reading. Fails for missing or empty files.
+    bool Open(const std::wstring& path);
+    void Close();
+
+    const char* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    HANDLE hFile_ = INVALID_HANDLE_VALUE;
+    HANDLE hMapping_ = nullptr;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -1,260 +1,54 @@
 #include "Migration.h"
+#include "BufferPool.h"
+#include "CopyEngine.h"
+#include "FileVerify.h"
+#include "SmallFileCopy.h"
 #include "TransferLog.h"
 #include "Utils.h"
 #include <string>
+#include <chrono>
+#include <map>
 
-// Threshold: files >= 4MB use high-performance unbuffered overlapped copy
+// Threshold: files >= 4MB use the unbuffered deep-queue CopyEngine on the drive
+// worker itself; smaller files go to the drive's SmallFilePool
 static const uint64_t FAST_COPY_THRESHOLD = 4 * 1024 * 1024;
-static const DWORD CHUNK_SIZE = 16 * 1024 * 1024; // 16MB per I/O buffer
-static const DWORD SECTOR_ALIGN = 4096;            // 4K sector alignment
-
-static const DWORD VERIFY_BUF_SIZE = 4 * 1024 * 1024; // 4MB verify buffer
-
-// Compare source and destination byte-by-byte. Returns true if they match.
-static bool VerifyFilesMatch(const std::wstring& srcPath, const std::wstring& dstPath,
-                              uint64_t expectedSize, std::atomic<bool>& cancelled) {
-    // Quick size check
-    WIN32_FILE_ATTRIBUTE_DATA fadSrc, fadDst;
-    if (!GetFileAttributesExW(srcPath.c_str(), GetFileExInfoStandard, &fadSrc) ||
-        !GetFileAttributesExW(dstPath.c_str(), GetFileExInfoStandard, &fadDst))
-        return false;
-
-    uint64_t sizeSrc = (uint64_t(fadSrc.nFileSizeHigh) << 32) | fadSrc.nFileSizeLow;
-    uint64_t sizeDst = (uint64_t(fadDst.nFileSizeHigh) << 32) | fadDst.nFileSizeLow;
-    if (sizeSrc != sizeDst || sizeSrc != expectedSize)
-        return false;
 
-    // Byte-by-byte comparison using large buffered reads
-    void* buf1 = VirtualAlloc(nullptr, VERIFY_BUF_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    void* buf2 = VirtualAlloc(nullptr, VERIFY_BUF_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    if (!buf1 || !buf2) {
-        if (buf1) VirtualFree(buf1, 0, MEM_RELEASE);
-        if (buf2) VirtualFree(buf2, 0, MEM_RELEASE);
-        return false;
-    }
+// Buffer pool room per drive besides the copy engine's queue and a buffer
+// per small-file thread: the verify read-back of source and destination
+static const uint64_t VERIFY_POOL_BYTES = 8 * 1024 * 1024;
 
-    HANDLE hSrc = CreateFileW(srcPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
-        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-    HANDLE hDst = CreateFileW(dstPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
-        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
-
-    bool match = true;
-    if (hSrc == INVALID_HANDLE_VALUE || hDst == INVALID_HANDLE_VALUE) {
-        match = false;
-    } else {
-        while (!cancelled) {
-            DWORD read1 = 0, read2 = 0;
-            ReadFile(hSrc, buf1, VERIFY_BUF_SIZE, &read1, nullptr);
-            ReadFile(hDst, buf2, VERIFY_BUF_SIZE, &read2, nullptr);
-            if (read1 != read2 || memcmp(buf1, buf2, read1) != 0) {
-                match = false;
-                break;
-            }
-            if (read1 == 0) break;
-        }
-    }
-
-    if (hSrc != INVALID_HANDLE_VALUE) CloseHandle(hSrc);
-    if (hDst != INVALID_HANDLE_VALUE) CloseHandle(hDst);
-    VirtualFree(buf1, 0, MEM_RELEASE);
-    VirtualFree(buf2, 0, MEM_RELEASE);
-    return match;
-}
+// Transfer log: compact the journal no earlier than this many records, and
+// flush it to disk at most this often
+static const size_t COMPACT_MIN_RECORDS = 10000;
+static const ULONGLONG JOURNAL_FLUSH_MS = 1000;
 
 struct CopyCallbackData {
     Migration* self;
-    HWND hWnd;
-    uint64_t bytesCopiedBefore; // bytes completed in previous files
-    uint64_t totalBytes;
+    std::atomic<uint64_t>* bytesDone; // shared across all drive workers
     std::atomic<bool>* cancelled;
-    int lastProgress;              // last posted progress value (0-1000)
-    ULONGLONG lastPostTime;        // tick of last PostMessage
+    uint64_t bytesReported;           // bytes of the current file already added to bytesDone
 };
 
-// Post throttled progress update
-static void PostProgress(CopyCallbackData* cb, uint64_t bytesInFile) {
-    if (!cb) return;
-    uint64_t current = cb->bytesCopiedBefore + bytesInFile;
-    int progress = cb->totalBytes > 0
-        ? static_cast<int>((current * 1000) / cb->totalBytes) : 0;
-    ULONGLONG now = GetTickCount64();
-    if (progress != cb->lastProgress && (now - cb->lastPostTime >= 50)) {
-        PostMessageW(cb->hWnd, WM_MIGRATION_PROGRESS, progress, 0);
-        cb->lastProgress = progress;
-        cb->lastPostTime = now;
-    }
+// Add this file's newly transferred bytes to the shared counter. The
+// aggregator thread turns the counter into throttled progress messages.
+static void ReportProgress(CopyCallbackData* cb, uint64_t bytesInFile) {
+    if (!cb || bytesInFile <= cb->bytesReported) return;
+    cb->bytesDone->fetch_add(bytesInFile - cb->bytesReported);
+    cb->bytesReported = bytesInFile;
 }
 
-// High-performance copy using unbuffered overlapped I/O with double buffering.
-static bool FastCopyFile(const std::wstring& src, const std::wstring& dst,
-                         uint64_t fileSize, CopyCallbackData* cbData) {
-    // Allocate two sector-aligned buffers
-    void* buffers[2];
-    buffers[0] = VirtualAlloc(nullptr, CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    buffers[1] = VirtualAlloc(nullptr, CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-    if (!buffers[0] || !buffers[1]) {
-        if (buffers[0]) VirtualFree(buffers[0], 0, MEM_RELEASE);
-        if (buffers[1]) VirtualFree(buffers[1], 0, MEM_RELEASE);
-        return false;
-    }
-
-    // Open source: unbuffered + sequential scan + overlapped
-    HANDLE hSrc = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
-        OPEN_EXISTING,
-        FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED,
-        nullptr);
-    if (hSrc == INVALID_HANDLE_VALUE) {
-        VirtualFree(buffers[0], 0, MEM_RELEASE);
-        VirtualFree(buffers[1], 0, MEM_RELEASE);
-        return false;
-    }
-
-    // Open destination: unbuffered + overlapped
-    HANDLE hDst = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr,
-        CREATE_ALWAYS,
-        FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED,
-        nullptr);
-    if (hDst == INVALID_HANDLE_VALUE) {
-        CloseHandle(hSrc);
-        VirtualFree(buffers[0], 0, MEM_RELEASE);
-        VirtualFree(buffers[1], 0, MEM_RELEASE);
-        return false;
-    }
-
-    // Pre-allocate destination to reduce fragmentation on HDDs
-    LARGE_INTEGER preSize;
-    preSize.QuadPart = static_cast<LONGLONG>((fileSize + SECTOR_ALIGN - 1) & ~((uint64_t)SECTOR_ALIGN - 1));
-    SetFilePointerEx(hDst, preSize, nullptr, FILE_BEGIN);
-    SetEndOfFile(hDst);
-
-    OVERLAPPED ovRead = {}, ovWrite = {};
-    ovRead.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
-    ovWrite.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
-
-    bool success = true;
-    uint64_t readPos = 0;
-    uint64_t writePos = 0;
-    int curBuf = 0;
-    bool writePending = false;
-
-    while (readPos < fileSize && success) {
-        if (cbData && *cbData->cancelled) { success = false; break; }
-
-        // Initiate async read into current buffer
-        ovRead.Offset = static_cast<DWORD>(readPos);
-        ovRead.OffsetHigh = static_cast<DWORD>(readPos >> 32);
-        ResetEvent(ovRead.hEvent);
-
-        BOOL readOk = ReadFile(hSrc, buffers[curBuf], CHUNK_SIZE, nullptr, &ovRead);
-        if (!readOk && GetLastError() != ERROR_IO_PENDING) {
-            success = false;
-            break;
-        }
-
-        // While read is in flight, wait for previous write to finish
-        if (writePending) {
-            DWORD bytesWritten;
-            if (!GetOverlappedResult(hDst, &ovWrite, &bytesWritten, TRUE)) {
-                success = false;
-                break;
-            }
-            writePending = false;
-        }
-
-        // Now wait for the read to complete
-        DWORD bytesRead;
-        if (!GetOverlappedResult(hSrc, &ovRead, &bytesRead, TRUE) || bytesRead == 0) {
-            if (readPos < fileSize) success = false;
-            break;
-        }
-
-        readPos += bytesRead;
-
-        // Round up write size to sector boundary (required for unbuffered I/O)
-        DWORD writeSize = (bytesRead + SECTOR_ALIGN - 1) & ~(SECTOR_ALIGN - 1);
-        if (writeSize > bytesRead) {
-            memset(static_cast<char*>(buffers[curBuf]) + bytesRead, 0, writeSize - bytesRead);
-        }
-
-        // Initiate async write from current buffer
-        ovWrite.Offset = static_cast<DWORD>(writePos);
-        ovWrite.OffsetHigh = static_cast<DWORD>(writePos >> 32);
-        ResetEvent(ovWrite.hEvent);
-
-        BOOL writeOk = WriteFile(hDst, buffers[curBuf], writeSize, nullptr, &ovWrite);
-        if (!writeOk && GetLastError() != ERROR_IO_PENDING) {
-            success = false;
-            break;
-        }
-        writePending = true;
-        writePos += writeSize;
-
-        // Swap to other buffer for next iteration
-        curBuf = 1 - curBuf;
-
-        // Update progress
-        PostProgress(cbData, readPos);
-    }
-
-    // Wait for final write to complete
-    if (writePending) {
-        DWORD bytesWritten;
-        if (!GetOverlappedResult(hDst, &ovWrite, &bytesWritten, TRUE)) {
-            success = false;
-        }
-    }
-
-    CloseHandle(ovRead.hEvent);
-    CloseHandle(ovWrite.hEvent);
-    CloseHandle(hSrc);
-    CloseHandle(hDst);
-
-    // Set exact file size (unbuffered writes are sector-padded, may overshoot)
-    if (success) {
-        HANDLE hFix = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr,
-            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-        if (hFix != INVALID_HANDLE_VALUE) {
-            LARGE_INTEGER liExact;
-            liExact.QuadPart = static_cast<LONGLONG>(fileSize);
-            SetFilePointerEx(hFix, liExact, nullptr, FILE_BEGIN);
-            SetEndOfFile(hFix);
-            CloseHandle(hFix);
-        }
-
-        // Copy timestamps from source
-        HANDLE hSrcInfo = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ,
-            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-        if (hSrcInfo != INVALID_HANDLE_VALUE) {
-            FILETIME ftCreate, ftAccess, ftWrite;
-            if (GetFileTime(hSrcInfo, &ftCreate, &ftAccess, &ftWrite)) {
-                HANDLE hDstInfo = CreateFileW(dst.c_str(), FILE_WRITE_ATTRIBUTES, 0,
-                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-                if (hDstInfo != INVALID_HANDLE_VALUE) {
-                    SetFileTime(hDstInfo, &ftCreate, &ftAccess, &ftWrite);
-                    CloseHandle(hDstInfo);
-                }
-            }
-            CloseHandle(hSrcInfo);
-        }
-
-        // Copy file attributes
-        DWORD attrs = GetFileAttributesW(src.c_str());
-        if (attrs != INVALID_FILE_ATTRIBUTES) {
-            SetFileAttributesW(dst.c_str(), attrs);
-        }
-    } else if (!cbData || !*cbData->cancelled) {
-        DeleteFileW(dst.c_str());
-    }
-
-    VirtualFree(buffers[0], 0, MEM_RELEASE);
-    VirtualFree(buffers[1], 0, MEM_RELEASE);
-
-    // Update progress tracking for caller
-    if (success && cbData) {
-        cbData->bytesCopiedBefore += fileSize;
-    }
+// Take back a failed file's partial contribution so progress doesn't overcount
+static void RollbackProgress(CopyCallbackData* cb) {
+    if (!cb || cb->bytesReported == 0) return;
+    cb->bytesDone->fetch_sub(cb->bytesReported);
+    cb->bytesReported = 0;
+}
 
-    return success;
+// CopyEngine progress hook: feed the shared counter, stop on cancel
+static bool EngineProgress(uint64_t bytesInFile, void* context) {
+    auto* cb = static_cast<CopyCallbackData*>(context);
+    ReportProgress(cb, bytesInFile);
+    return !*cb->cancelled;
 }
 
 Migration::Migration() {}
@@ -270,6 +64,11 @@ Migration::~Migration() {
 bool Migration::Start(const MigrationParams& params) {
     if (running_) return false;
 
+    if (hThread_) {
+        CloseHandle(hThread_);
+        hThread_ = nullptr;
+    }
+
     params_ = params;
     cancelled_ = false;
     running_ = true;
@@ -296,150 +95,379 @@ DWORD WINAPI Migration::ThreadProc(LPVOID param) {
     return 0;
 }
 
-void Migration::Run() {
-    uint64_t bytesDone = 0;
-    bool hadError = false;
+DWORD WINAPI Migration::DriveWorkerProc(LPVOID param) {
+    auto* worker = static_cast<DriveWorker*>(param);
+    worker->self->RunDriveWorker(*worker);
+    return 0;
+}
 
-    // Load existing transfer log so we can append
-    TransferLog log;
-    log.Load(params_.jsonLogPath);
-    log.SetSourcePath(params_.sourcePath);
+// Average read-back rate of the verify passes alone (bytes verified over time
+// spent verifying), so it can be shown apart from the copy rate
+LPARAM Migration::VerifyRateKBps() const {
+    uint64_t micros = verifyMicros_;
+    if (micros == 0) return 0;
+    return static_cast<LPARAM>(verifyBytes_ * 1000000 / micros / 1024);
+}
 
-    int saveCounter = 0;
+void Migration::PushEvent(const WorkerEvent& ev) {
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        events_.push_back(ev);
+    }
+    eventCv_.notify_one();
+}
 
-    // First pass: create all necessary directories on each destination drive
-    for (auto& item : params_.items) {
+void Migration::SmallFileJob(size_t itemIndex, int slot, void* context) {
+    auto* worker = static_cast<DriveWorker*>(context);
+    worker->self->ProcessFile(*worker, itemIndex, worker->slotParentCache[slot]);
+}
+
+void Migration::RunDriveWorker(DriveWorker& worker) {
+    const auto& drive = params_.drives[worker.driveIndex];
+    std::wstring destRoot = Utils::CombinePaths(drive.rootPath, params_.sourceFolderName);
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t index : worker.queue) {
         if (cancelled_) break;
-        if (!item.isDirectory) continue;
-        if (item.destDriveIndex < 0 || item.destDriveIndex >= static_cast<int>(params_.drives.size()))
+
+        const auto& item = params_.items[index];
+        if (item.isDirectory) {
+            Utils::EnsureDirectoryExists(Utils::CombinePaths(destRoot, item.relativePath));
             continue;
+        }
 
-        const auto& drive = params_.drives[item.destDriveIndex];
-        std::wstring destPath = Utils::CombinePaths(
-            Utils::CombinePaths(drive.rootPath, params_.sourceFolderName),
-            item.relativePath);
-        Utils::EnsureDirectoryExists(destPath);
+        worker.measured.bytes += item.fileSize;
+        worker.measured.files++;
+
+        if (item.fileSize < FAST_COPY_THRESHOLD) {
+            if (!worker.smallFiles) {
+                int maxThreads = params_.smallFileConcurrency;
+                if (maxThreads < 1) maxThreads = 1;
+                worker.slotParentCache.resize(maxThreads);
+                worker.smallFiles = std::make_unique<SmallFilePool>(maxThreads, SmallFileJob, &worker);
+            }
+            worker.smallFiles->Submit(index);
+        } else {
+            // Large files stream on this thread while the pool keeps small ones moving
+            ProcessFile(worker, index, worker.lastVerifiedParent);
+        }
     }
 
-    // Second pass: copy/move files
-    std::wstring lastVerifiedParent;
-    ULONGLONG lastFilePostTime = 0;
+    if (worker.smallFiles) {
+        worker.smallFiles->WaitIdle();
+        worker.smallFiles.reset();
+    }
+    worker.measured.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    worker.measured.verified = params_.moveMode && params_.verifyBeforeDelete;
 
-    for (auto& item : params_.items) {
-        if (cancelled_) break;
-        if (item.isDirectory) continue;
-        if (item.destDriveIndex < 0 || item.destDriveIndex >= static_cast<int>(params_.drives.size()))
-            continue;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        activeWorkers_--;
+    }
+    eventCv_.notify_one();
+}
 
-        const auto& drive = params_.drives[item.destDriveIndex];
-        std::wstring destPath = Utils::CombinePaths(
-            Utils::CombinePaths(drive.rootPath, params_.sourceFolderName),
-            item.relativePath);
-
-        // Ensure parent directory exists (cached to avoid redundant checks)
-        size_t lastSep = destPath.find_last_of(L"\\/");
-        if (lastSep != std::wstring::npos) {
-            std::wstring parentDir = destPath.substr(0, lastSep);
-            if (parentDir != lastVerifiedParent) {
-                Utils::EnsureDirectoryExists(parentDir);
-                lastVerifiedParent = parentDir;
-            }
+// Copy or move a single file to its assigned drive. Runs on a drive worker
+// thread (large files) or one of its small-file pool threads.
+void Migration::ProcessFile(DriveWorker& worker, size_t itemIndex, std::wstring& lastVerifiedParent) {
+    if (cancelled_) return;
+
+    const auto& item = params_.items[itemIndex];
+    size_t seq = fileSeq_[itemIndex];
+    const auto& drive = params_.drives[worker.driveIndex];
+    std::wstring destPath = Utils::CombinePaths(
+        Utils::CombinePaths(drive.rootPath, params_.sourceFolderName),
+        item.relativePath);
+
+    // Ensure parent directory exists (cached to avoid redundant checks)
+    size_t lastSep = destPath.find_last_of(L"\\/");
+    if (lastSep != std::wstring::npos) {
+        std::wstring parentDir = destPath.substr(0, lastSep);
+        if (parentDir != lastVerifiedParent) {
+            Utils::EnsureDirectoryExists(parentDir);
+            lastVerifiedParent = parentDir;
         }
+    }
 
-        // Throttle file name updates
-        ULONGLONG now = GetTickCount64();
-        if (now - lastFilePostTime >= 80) {
-            wchar_t* fileMsg = _wcsdup(item.relativePath.c_str());
-            PostMessageW(params_.hWndNotify, WM_MIGRATION_FILE, 0, reinterpret_cast<LPARAM>(fileMsg));
-            lastFilePostTime = now;
+    PushEvent({ WorkerEvent::FileStarted, itemIndex, seq, false, false, 0, 0, NO_MISMATCH_OFFSET, 0 });
+
+    CopyCallbackData cbData;
+    cbData.self = this;
+    cbData.bytesDone = &bytesDone_;
+    cbData.cancelled = &cancelled_;
+    cbData.bytesReported = 0;
+
+    // Both copy paths hash the data as it streams through, for the log and
+    // for hash verification
+    uint64_t digest = 0;
+    auto copyFile = [&]() -> bool {
+        if (item.fileSize >= FAST_COPY_THRESHOLD) {
+            // The drive's write rate is timed on the copy alone, and only
+            // while its small-file pool is idle (this thread is the only one
+            // feeding the pool, so it stays idle until the copy is done)
+            bool alone = !worker.smallFiles || worker.smallFiles->IsIdle();
+            auto copyStart = std::chrono::steady_clock::now();
+            bool copied = worker.engine->Copy(item.sourcePath, destPath,
+                item.fileSize, &cancelled_, EngineProgress, &cbData, &digest);
+            if (copied && alone) {
+                worker.measured.streamBytes += item.fileSize;
+                worker.measured.streamSeconds += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - copyStart).count();
+            }
+            return copied;
         }
+        return CopySmallFile(item.sourcePath, destPath, item.fileSize, EngineProgress, &cbData, &digest);
+    };
 
-        CopyCallbackData cbData;
-        cbData.self = this;
-        cbData.hWnd = params_.hWndNotify;
-        cbData.bytesCopiedBefore = bytesDone;
-        cbData.totalBytes = params_.totalBytes;
-        cbData.cancelled = &cancelled_;
-        cbData.lastProgress = -1;
-        cbData.lastPostTime = 0;
-
-        BOOL success;
-        bool useFastCopy = (item.fileSize >= FAST_COPY_THRESHOLD);
-
-        if (params_.moveMode) {
-            // Try MoveFileEx first (same volume = instant rename, no verify needed)
-            success = MoveFileExW(item.sourcePath.c_str(), destPath.c_str(),
-                MOVEFILE_COPY_ALLOWED);
-            if (success) {
-                bytesDone += item.fileSize;
-                int progress = params_.totalBytes > 0
-                    ? static_cast<int>((bytesDone * 1000) / params_.totalBytes) : 0;
-                PostMessageW(params_.hWndNotify, WM_MIGRATION_PROGRESS, progress, 0);
-            } else {
-                // Cross-volume: copy, verify (optional), then delete
-                if (useFastCopy) {
-                    success = FastCopyFile(item.sourcePath, destPath,
-                        item.fileSize, &cbData);
-                } else {
-                    success = CopyFileExW(item.sourcePath.c_str(), destPath.c_str(),
-                        CopyProgressRoutine, &cbData, nullptr, 0);
-                }
-                if (success) {
-                    bytesDone = cbData.bytesCopiedBefore;
-
-                    if (params_.verifyBeforeDelete && !cancelled_) {
-                        std::wstring verifyMsg = L"Verifying: " + item.relativePath;
-                        wchar_t* vMsg = _wcsdup(verifyMsg.c_str());
-                        PostMessageW(params_.hWndNotify, WM_MIGRATION_FILE, 0, reinterpret_cast<LPARAM>(vMsg));
-
-                        if (!VerifyFilesMatch(item.sourcePath, destPath, item.fileSize, cancelled_)) {
-                            wchar_t errBuf[512];
-                            swprintf_s(errBuf, L"Verify FAILED (source kept): %s",
-                                item.relativePath.c_str());
-                            wchar_t* errMsg = _wcsdup(errBuf);
-                            PostMessageW(params_.hWndNotify, WM_MIGRATION_ERROR, 0, reinterpret_cast<LPARAM>(errMsg));
-                            hadError = true;
-                            continue;
-                        }
-                    }
+    bool success;
 
-                    DeleteFileW(item.sourcePath.c_str());
-                }
-            }
+    if (params_.moveMode) {
+        // Try a same-volume rename first (instant, no verify needed). Cross-volume
+        // moves fail here and fall through to our own copy + verify + delete.
+        success = MoveFileExW(item.sourcePath.c_str(), destPath.c_str(), 0) != FALSE;
+        if (success) {
+            ReportProgress(&cbData, item.fileSize);
         } else {
-            if (useFastCopy) {
-                success = FastCopyFile(item.sourcePath, destPath,
-                    item.fileSize, &cbData);
-            } else {
-                success = CopyFileExW(item.sourcePath.c_str(), destPath.c_str(),
-                    CopyProgressRoutine, &cbData, nullptr, 0);
-            }
+            success = copyFile();
             if (success) {
-                bytesDone = cbData.bytesCopiedBefore;
+                ReportProgress(&cbData, item.fileSize);
+
+                if (params_.verifyBeforeDelete && !cancelled_) {
+                    PushEvent({ WorkerEvent::FileVerifying, itemIndex, seq, false, false, 0, 0, NO_MISMATCH_OFFSET, 0 });
+
+                    auto verifyStart = std::chrono::steady_clock::now();
+                    uint64_t mismatchOffset = NO_MISMATCH_OFFSET;
+                    bool match = params_.verifyMethod == VerifyMethod::Hash
+                        ? VerifyDestinationHash(destPath, item.fileSize, digest, cancelled_)
+                        : VerifyFilesMatch(item.sourcePath, destPath, item.fileSize, cancelled_, &mismatchOffset);
+                    verifyMicros_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - verifyStart).count();
+                    verifyBytes_ += item.fileSize;
+                    if (!match) {
+                        PushEvent({ WorkerEvent::FileDone, itemIndex, seq, false, true, 0, 0, mismatchOffset, 0 });
+                        return;
+                    }
+                }
+
+                DeleteFileW(item.sourcePath.c_str());
             }
         }
-
-        // Log successful transfer to JSON
+    } else {
+        success = copyFile();
         if (success) {
-            log.AddEntry(item.relativePath, drive.serialHex, item.fileSize);
-            saveCounter++;
-            // Save every 10 files for crash resilience
-            if (saveCounter >= 10) {
-                log.Save(params_.jsonLogPath);
-                saveCounter = 0;
-            }
+            ReportProgress(&cbData, item.fileSize);
+        }
+    }
+
+    DWORD err = success ? 0 : GetLastError();
+    if (!success) RollbackProgress(&cbData);
+
+    // The catalog keeps the copy's timestamp so a later scan can tell whether
+    // the destination file was touched since
+    uint64_t mtime = 0;
+    WIN32_FILE_ATTRIBUTE_DATA destInfo;
+    if (success && GetFileAttributesExW(destPath.c_str(), GetFileExInfoStandard, &destInfo)) {
+        mtime = (static_cast<uint64_t>(destInfo.ftLastWriteTime.dwHighDateTime) << 32) |
+                destInfo.ftLastWriteTime.dwLowDateTime;
+    }
+    PushEvent({ WorkerEvent::FileDone, itemIndex, seq, success, false, err, digest, NO_MISMATCH_OFFSET, mtime });
+}
+
+void Migration::Run() {
+    bool hadError = false;
+    bytesDone_ = 0;
+    verifyBytes_ = 0;
+    verifyMicros_ = 0;
+    events_.clear();
+
+    // Load existing transfer log (snapshot + journal) and append to its journal.
+    // Without a journal, fall back to rewriting the snapshot every 10 files.
+    TransferLog log;
+    log.Load(params_.jsonLogPath);
+    log.SetSourcePath(params_.sourcePath);
+    bool journaled = log.OpenJournal(params_.jsonLogPath);
+
+    int saveCounter = 0;
+    ULONGLONG lastJournalFlushTime = GetTickCount64();
+
+    // Dispatch: split items into one queue per destination drive, keeping tree
+    // order within each drive. Directories go first so they exist before files.
+    std::vector<DriveWorker> workers(params_.drives.size());
+    CopyEngineOptions engineOptions;
+    engineOptions.queueDepth = params_.ioQueueDepth;
+    engineOptions.chunkSize = params_.ioChunkSize;
+
+    // Let the pool hold every drive's buffers at full depth at once
+    int smallThreads = params_.smallFileConcurrency < 1 ? 1 : params_.smallFileConcurrency;
+    uint64_t poolBudget = (static_cast<uint64_t>(engineOptions.queueDepth) * engineOptions.chunkSize +
+        smallThreads * FAST_COPY_THRESHOLD + VERIFY_POOL_BYTES) * workers.size();
+    if (poolBudget < BufferPool::DEFAULT_BUDGET) poolBudget = BufferPool::DEFAULT_BUDGET;
+    BufferPool::Instance().SetBudget(poolBudget);
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].self = this;
+        workers[i].driveIndex = static_cast<int>(i);
+        workers[i].engine = std::make_unique<CopyEngine>(engineOptions);
+    }
+    fileSeq_.assign(params_.items.size(), 0);
+    std::vector<size_t> fileCounts(workers.size(), 0);
+    for (int pass = 0; pass < 2; pass++) {
+        bool wantDirs = (pass == 0);
+        for (size_t i = 0; i < params_.items.size(); i++) {
+            const auto& item = params_.items[i];
+            if (item.isDirectory != wantDirs) continue;
+            if (item.destDriveIndex < 0 || item.destDriveIndex >= static_cast<int>(workers.size()))
+                continue;
+            workers[item.destDriveIndex].queue.push_back(i);
+            if (!wantDirs) fileSeq_[i] = fileCounts[item.destDriveIndex]++;
+        }
+    }
+
+    // Start one worker per drive that has something to do; each drive is its
+    // own spindle, so they all write concurrently.
+    std::vector<HANDLE> workerThreads;
+    for (auto& worker : workers) {
+        if (worker.queue.empty()) continue;
+        activeWorkers_++;
+        worker.hThread = CreateThread(nullptr, 0, DriveWorkerProc, &worker, 0, nullptr);
+        if (!worker.hThread) {
+            activeWorkers_--;
+            hadError = true;
+            continue;
         }
+        workerThreads.push_back(worker.hThread);
+    }
 
-        if (!success && !cancelled_) {
-            DWORD err = GetLastError();
+    // Aggregate: the only place that touches the log and posts to the UI
+    int lastProgress = -1;
+    ULONGLONG lastProgressPostTime = 0;
+    ULONGLONG lastFilePostTime = 0;
+    std::deque<WorkerEvent> pending;
+
+    // Small files finish out of order. Completions are held back until every
+    // earlier file on the same drive has finished, so each drive's log entries
+    // stay in tree order and are only written for fully completed files.
+    std::vector<std::map<size_t, WorkerEvent>> reorder(workers.size());
+    std::vector<size_t> nextSeq(workers.size(), 0);
+
+    auto commit = [&](const WorkerEvent& ev) {
+        const auto& item = params_.items[ev.itemIndex];
+        if (ev.success) {
+            // Log successful transfer: one journal record
+            log.AddEntry(item.relativePath, params_.drives[item.destDriveIndex].serialHex,
+                item.fileSize, ev.contentHash, ev.mtime);
+            if (journaled) {
+                // Compact once the journal outgrows the catalog, keeping total
+                // log bytes written linear in the number of transfers
+                size_t records = log.GetJournalRecords();
+                if (records >= COMPACT_MIN_RECORDS && records >= log.GetCatalogCount()) {
+                    log.Compact(params_.jsonLogPath);
+                }
+            } else if (++saveCounter >= 10) {
+                log.Compact(params_.jsonLogPath);
+                saveCounter = 0;
+            }
+        } else if (ev.verifyFailed) {
+            wchar_t errBuf[512];
+            if (ev.mismatchOffset != NO_MISMATCH_OFFSET) {
+                swprintf_s(errBuf, L"Verify FAILED at byte %llu (source kept): %s",
+                    ev.mismatchOffset, item.relativePath.c_str());
+            } else {
+                swprintf_s(errBuf, L"Verify FAILED (source kept): %s",
+                    item.relativePath.c_str());
+            }
+            wchar_t* errMsg = _wcsdup(errBuf);
+            PostMessageW(params_.hWndNotify, WM_MIGRATION_ERROR, 0, reinterpret_cast<LPARAM>(errMsg));
+            hadError = true;
+        } else if (!cancelled_) {
             wchar_t errBuf[512];
             swprintf_s(errBuf, L"Error processing: %s\nError code: %lu",
-                item.relativePath.c_str(), err);
+                item.relativePath.c_str(), ev.error);
             hadError = true;
 
             wchar_t* errMsg = _wcsdup(errBuf);
             PostMessageW(params_.hWndNotify, WM_MIGRATION_ERROR, 0, reinterpret_cast<LPARAM>(errMsg));
         }
+    };
+
+    for (;;) {
+        bool finished;
+        {
+            std::unique_lock<std::mutex> lock(eventMutex_);
+            eventCv_.wait_for(lock, std::chrono::milliseconds(50),
+                [this] { return !events_.empty() || activeWorkers_ == 0; });
+            pending.swap(events_);
+            finished = (activeWorkers_ == 0);
+        }
+
+        for (const auto& ev : pending) {
+            const auto& item = params_.items[ev.itemIndex];
+
+            if (ev.kind == WorkerEvent::FileStarted) {
+                // Throttle file name updates
+                ULONGLONG now = GetTickCount64();
+                if (now - lastFilePostTime >= 80) {
+                    wchar_t* fileMsg = _wcsdup(item.relativePath.c_str());
+                    PostMessageW(params_.hWndNotify, WM_MIGRATION_FILE, 0, reinterpret_cast<LPARAM>(fileMsg));
+                    lastFilePostTime = now;
+                }
+            } else if (ev.kind == WorkerEvent::FileVerifying) {
+                std::wstring verifyMsg = L"Verifying: " + item.relativePath;
+                wchar_t* vMsg = _wcsdup(verifyMsg.c_str());
+                PostMessageW(params_.hWndNotify, WM_MIGRATION_FILE, 0, reinterpret_cast<LPARAM>(vMsg));
+            } else {
+                auto& held = reorder[item.destDriveIndex];
+                size_t& next = nextSeq[item.destDriveIndex];
+                held.emplace(ev.seq, ev);
+                while (!held.empty() && held.begin()->first == next) {
+                    commit(held.begin()->second);
+                    held.erase(held.begin());
+                    next++;
+                }
+            }
+        }
+        pending.clear();
+
+        // Bound what a power loss can take to about a second of records
+        if (journaled && GetTickCount64() - lastJournalFlushTime >= JOURNAL_FLUSH_MS) {
+            log.FlushJournal();
+            lastJournalFlushTime = GetTickCount64();
+        }
+
+        // Post throttled aggregate progress across all drives
+        uint64_t done = bytesDone_;
+        int progress = params_.totalBytes > 0
+            ? static_cast<int>((done * 1000) / params_.totalBytes) : 0;
+        ULONGLONG now = GetTickCount64();
+        if (progress != lastProgress && (finished || now - lastProgressPostTime >= 50)) {
+            PostMessageW(params_.hWndNotify, WM_MIGRATION_PROGRESS, progress, VerifyRateKBps());
+            lastProgress = progress;
+            lastProgressPostTime = now;
+        }
+
+        if (finished) break;
+    }
+
+    // After a cancel some earlier files never ran; still record the ones that finished
+    for (auto& held : reorder) {
+        for (auto& [seq, ev] : held) {
+            commit(ev);
+        }
+    }
+
+    for (HANDLE h : workerThreads) {
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+    }
+
+    // What each drive managed goes into its profile for planning the next
+    // migration; a cancelled run stopped partway, so it says little
+    if (!params_.driveProfilePath.empty() && !cancelled_) {
+        for (auto& worker : workers) {
+            const auto& drive = params_.drives[worker.driveIndex];
+            DriveProfile::Record(params_.driveProfilePath, drive.serialHex, drive.rootPath, worker.measured);
+        }
     }
 
     // For move mode, try to remove empty source directories (bottom-up)
@@ -451,8 +479,13 @@ void Migration::Run() {
         }
     }
 
-    // Final save of the JSON log
+    // Fold the journal into a final catalog, and refresh the JSON export
+    log.Compact(params_.jsonLogPath);
     log.Save(params_.jsonLogPath);
+    log.CloseJournal();
+
+    // Hand idle buffers back to the OS
+    BufferPool::Instance().Trim();
 
     // Signal completion
     PostMessageW(params_.hWndNotify, WM_MIGRATION_COMPLETE,
@@ -460,30 +493,3 @@ void Migration::Run() {
 
     running_ = false;
 }
-
-DWORD CALLBACK Migration::CopyProgressRoutine(
-    LARGE_INTEGER totalFileSize,
-    LARGE_INTEGER totalBytesTransferred,
-    LARGE_INTEGER /*streamSize*/,
-    LARGE_INTEGER /*streamBytesTransferred*/,
-    DWORD /*dwStreamNumber*/,
-    DWORD /*dwCallbackReason*/,
-    HANDLE /*hSourceFile*/,
-    HANDLE /*hDestinationFile*/,
-    LPVOID lpData)
-{
-    auto* data = static_cast<CopyCallbackData*>(lpData);
-
-    if (*data->cancelled) {
-        return PROGRESS_CANCEL;
-    }
-
-    PostProgress(data, totalBytesTransferred.QuadPart);
-
-    // Update bytesCopiedBefore when file completes
-    if (totalBytesTransferred.QuadPart == totalFileSize.QuadPart) {
-        data->bytesCopiedBefore += totalFileSize.QuadPart;
-    }
-
-    return PROGRESS_CONTINUE;
-}
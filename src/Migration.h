@@ -4,9 +4,17 @@
 #include <vector>
 #include <cstdint>
 #include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include "DriveProfile.h"
+
+class CopyEngine;
+class SmallFilePool;
 
 // Custom messages posted from background thread to UI
-#define WM_MIGRATION_PROGRESS   (WM_USER + 100)
+#define WM_MIGRATION_PROGRESS   (WM_USER + 100)     // wParam = progress 0-1000, lParam = verify KB/s
 #define WM_MIGRATION_FILE       (WM_USER + 101)
 #define WM_MIGRATION_COMPLETE   (WM_USER + 102)
 #define WM_MIGRATION_ERROR      (WM_USER + 103)
@@ -26,6 +34,12 @@ struct MigrationItem {
     int destDriveIndex;         // index into MigrationParams::drives
 };
 
+// How verify-before-delete checks a copied file
+enum class VerifyMethod {
+    Hash,       // read the destination back and compare with the hash taken while copying
+    Compare     // re-read source and destination and compare byte-by-byte
+};
+
 struct MigrationParams {
     HWND hWndNotify;                            // Window to post progress messages to
     std::wstring sourcePath;                    // Source root path
@@ -34,8 +48,13 @@ struct MigrationParams {
     std::vector<MigrationItem> items;           // Files/folders to process
     bool moveMode;                              // true = move, false = copy
     bool verifyBeforeDelete;                    // verify copy matches source before deleting
+    VerifyMethod verifyMethod = VerifyMethod::Hash;
     uint64_t totalBytes;                        // Total bytes to transfer
     std::wstring jsonLogPath;                   // Path to JSON transfer log
+    std::wstring driveProfilePath;              // Drive speeds measured here are recorded (empty = not recorded)
+    DWORD ioQueueDepth = 8;                     // Large-file copy: I/O requests in flight
+    DWORD ioChunkSize = 4 * 1024 * 1024;        // Large-file copy: bytes per request
+    int smallFileConcurrency = 8;               // Small-file copy: max threads per drive
 };
 
 class Migration {
@@ -53,24 +72,55 @@ public:
     bool IsRunning() const;
 
 private:
+    // One worker thread per destination drive, fed with the items assigned to it
+    struct DriveWorker {
+        Migration* self = nullptr;
+        int driveIndex = -1;
+        std::vector<size_t> queue;          // indices into params_.items (dirs first, then files)
+        HANDLE hThread = nullptr;
+        std::wstring lastVerifiedParent;    // cached to avoid redundant directory checks
+        std::unique_ptr<CopyEngine> engine; // large-file copy engine, reused across files
+        std::unique_ptr<SmallFilePool> smallFiles;      // created on the first small file
+        std::vector<std::wstring> slotParentCache;      // lastVerifiedParent per pool slot
+
+        // Measured for the drive profile
+        DriveMeasurement measured;
+    };
+
+    // Event sent from a drive worker to the aggregator (the Run thread)
+    struct WorkerEvent {
+        enum Kind { FileStarted, FileVerifying, FileDone } kind;
+        size_t itemIndex;
+        size_t seq;                         // position among this drive's files
+        bool success;
+        bool verifyFailed;
+        DWORD error;                        // GetLastError() captured on the worker thread
+        uint64_t contentHash;               // hash taken while copying (0 = none)
+        uint64_t mismatchOffset;            // first differing byte on a failed compare
+        uint64_t mtime;                     // destination last-write FILETIME (0 = unknown)
+    };
+
     static DWORD WINAPI ThreadProc(LPVOID param);
+    static DWORD WINAPI DriveWorkerProc(LPVOID param);
+    static void SmallFileJob(size_t itemIndex, int slot, void* context);
     void Run();
+    void RunDriveWorker(DriveWorker& worker);
+    void ProcessFile(DriveWorker& worker, size_t itemIndex, std::wstring& lastVerifiedParent);
+    void PushEvent(const WorkerEvent& ev);
+    LPARAM VerifyRateKBps() const;
 
     MigrationParams params_;
     HANDLE hThread_ = nullptr;
     std::atomic<bool> cancelled_{ false };
     std::atomic<bool> running_{ false };
 
-    // Progress callback for CopyFileEx
-    static DWORD CALLBACK CopyProgressRoutine(
-        LARGE_INTEGER totalFileSize,
-        LARGE_INTEGER totalBytesTransferred,
-        LARGE_INTEGER streamSize,
-        LARGE_INTEGER streamBytesTransferred,
-        DWORD dwStreamNumber,
-        DWORD dwCallbackReason,
-        HANDLE hSourceFile,
-        HANDLE hDestinationFile,
-        LPVOID lpData
-    );
+    // Shared between drive workers and the aggregator
+    std::atomic<uint64_t> bytesDone_{ 0 };
+    std::atomic<uint64_t> verifyBytes_{ 0 };
+    std::atomic<uint64_t> verifyMicros_{ 0 };   // summed across workers
+    std::vector<size_t> fileSeq_;           // item index -> position among its drive's files
+    std::atomic<int> activeWorkers_{ 0 };
+    std::mutex eventMutex_;
+    std::condition_variable eventCv_;
+    std::deque<WorkerEvent> events_;
 };
@@ -0,0 +1,169 @@
+#include "NodeTable.h"
+#include <vector>
+#include <cstring>
+
+NodeTable::NodeTable()
+    : chunks_(new std::unique_ptr<Chunk>[MAX_CHUNKS]),
+      nameChunks_(new std::unique_ptr<wchar_t[]>[MAX_NAME_CHUNKS]) {}
+
+NodeTable::~NodeTable() {}
+
+void NodeTable::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < chunkCount_; i++) chunks_[i].reset();
+    for (size_t i = 0; i < nameChunkCount_; i++) nameChunks_[i].reset();
+    count_ = 0;
+    chunkCount_ = 0;
+    nameChars_ = 0;
+    nameChunkCount_ = 0;
+}
+
+NodeId NodeTable::Reset(const std::wstring& rootName) {
+    Clear();
+    NodeEntry root;
+    root.name = rootName;
+    root.isDirectory = true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t nameOffset;
+    NodeId id = Allocate(1);
+    if (id == NO_NODE || !StoreName(root.name, nameOffset)) return NO_NODE;
+    Fill(id, NO_NODE, root, nameOffset);
+    return id;
+}
+
+NodeId NodeTable::Allocate(size_t count) {
+    size_t first = count_;
+    if (first + count > static_cast<size_t>(MAX_CHUNKS) * CHUNK_NODES) return NO_NODE;
+    while (chunkCount_ * CHUNK_NODES < first + count) {
+        chunks_[chunkCount_++].reset(new Chunk);
+    }
+    count_ = first + count;
+    return static_cast<NodeId>(first);
+}
+
+bool NodeTable::StoreName(const std::wstring& name, uint32_t& offset) {
+    // Only the last chunk is being filled, and a name never straddles two:
+    // if it doesn't fit, the rest of the chunk is left unused
+    size_t length = name.size() + 1;
+    size_t capacity = nameChunkCount_ * static_cast<size_t>(NAME_CHUNK_CHARS);
+    if (nameChars_ + length > capacity) {
+        if (nameChunkCount_ == MAX_NAME_CHUNKS || length > NAME_CHUNK_CHARS) return false;
+        nameChunks_[nameChunkCount_++].reset(new wchar_t[NAME_CHUNK_CHARS]);
+        nameChars_ = capacity;
+    }
+    wchar_t* dest = nameChunks_[nameChars_ >> NAME_CHUNK_SHIFT].get() + (nameChars_ & (NAME_CHUNK_CHARS - 1));
+    memcpy(dest, name.c_str(), length * sizeof(wchar_t));
+    offset = static_cast<uint32_t>(nameChars_);
+    nameChars_ += length;
+    return true;
+}
+
+void NodeTable::Fill(NodeId id, NodeId parent, const NodeEntry& entry, uint32_t nameOffset) {
+    Chunk& chunk = ChunkOf(id);
+    uint32_t slot = Slot(id);
+    chunk.parent[slot] = parent;
+    chunk.firstChild[slot] = NO_NODE;
+    chunk.nextSibling[slot] = NO_NODE;
+    chunk.size[slot] = entry.isDirectory ? 0 : entry.size;
+    chunk.mtime[slot] = entry.mtime;
+    chunk.fileId[slot] = entry.fileId;
+    chunk.nameOffset[slot] = nameOffset;
+    chunk.nameLength[slot] = static_cast<uint16_t>(entry.name.size());
+    chunk.flags[slot] = entry.isDirectory ? FLAG_DIRECTORY : 0;
+}
+
+NodeId NodeTable::AppendChildren(NodeId parent, const NodeEntry* entries, size_t count) {
+    if (count == 0) return NO_NODE;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    NodeId first = Allocate(count);
+    if (first == NO_NODE) return NO_NODE;
+    for (size_t i = 0; i < count; i++) {
+        NodeId id = first + static_cast<NodeId>(i);
+        uint32_t nameOffset = 0;
+        if (!StoreName(entries[i].name, nameOffset)) {
+            count_ = first;     // out of name space; nothing was linked in yet
+            return NO_NODE;
+        }
+        Fill(id, parent, entries[i], nameOffset);
+        if (i + 1 < count) ChunkOf(id).nextSibling[Slot(id)] = id + 1;
+    }
+    ChunkOf(parent).firstChild[Slot(parent)] = first;
+    return first;
+}
+
+NodeId NodeTable::InsertChild(NodeId parent, NodeId after, const NodeEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t nameOffset = 0;
+    NodeId id = Allocate(1);
+    if (id == NO_NODE) return NO_NODE;
+    if (!StoreName(entry.name, nameOffset)) {
+        count_ = id;
+        return NO_NODE;
+    }
+    Fill(id, parent, entry, nameOffset);
+
+    NodeId& link = after == NO_NODE ? ChunkOf(parent).firstChild[Slot(parent)]
+                                    : ChunkOf(after).nextSibling[Slot(after)];
+    ChunkOf(id).nextSibling[Slot(id)] = link;
+    link = id;
+    return id;
+}
+
+void NodeTable::Unlink(NodeId node, NodeId previous) {
+    NodeId parent = GetParent(node);
+    NodeId& link = previous == NO_NODE ? ChunkOf(parent).firstChild[Slot(parent)]
+                                       : ChunkOf(previous).nextSibling[Slot(previous)];
+    link = GetNextSibling(node);
+    ChunkOf(node).flags[Slot(node)] |= FLAG_UNLINKED;
+}
+
+const wchar_t* NodeTable::GetName(NodeId id) const {
+    uint32_t offset = ChunkOf(id).nameOffset[Slot(id)];
+    return nameChunks_[offset >> NAME_CHUNK_SHIFT].get() + (offset & (NAME_CHUNK_CHARS - 1));
+}
+
+std::wstring NodeTable::GetPath(NodeId id) const {
+    // Collect the chain up to (not including) the root, then join it
+    std::vector<NodeId> chain;
+    size_t length = 0;
+    for (NodeId n = id; n != NO_NODE && GetParent(n) != NO_NODE; n = GetParent(n)) {
+        chain.push_back(n);
+        length += GetNameLength(n) + 1;
+    }
+
+    std::wstring path;
+    path.reserve(length);
+    for (size_t i = chain.size(); i-- > 0;) {
+        if (!path.empty()) path += L'\\';
+        path.append(GetName(chain[i]), GetNameLength(chain[i]));
+    }
+    return path;
+}
+
+void NodeTable::SumFolderSizes() {
+    size_t count = count_;
+    for (size_t i = 0; i < count; i++) {
+        NodeId id = static_cast<NodeId>(i);
+        if (IsDirectory(id)) SetSize(id, 0);
+    }
+    // Children come after their parents, so by the time a node is reached
+    // going down, everything below it has been added in
+    for (size_t i = count; i-- > 1;) {
+        NodeId id = static_cast<NodeId>(i);
+        const Chunk& chunk = ChunkOf(id);
+        uint32_t slot = Slot(id);
+        if (chunk.flags[slot] & FLAG_UNLINKED) continue;
+        NodeId parent = chunk.parent[slot];
+        if (parent != NO_NODE) {
+            ChunkOf(parent).size[Slot(parent)] += chunk.size[slot];
+        }
+    }
+}
+
+size_t NodeTable::GetMemoryUsage() const {
+    return chunkCount_ * sizeof(Chunk) +
+           nameChunkCount_ * static_cast<size_t>(NAME_CHUNK_CHARS) * sizeof(wchar_t) +
+           (MAX_CHUNKS + MAX_NAME_CHUNKS) * sizeof(void*);
+}
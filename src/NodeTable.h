@@ -0,0 +1,125 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Index of a node in a NodeTable
+typedef uint32_t NodeId;
+static const NodeId NO_NODE = 0xFFFFFFFF;
+
+// One directory entry as listed, before it goes into a NodeTable
+struct NodeEntry {
+    std::wstring name;
+    uint64_t size = 0;      // files; folders are totalled later
+    uint64_t mtime = 0;     // last-write FILETIME
+    uint64_t fileId = 0;    // folders: file ID, to notice a folder replaced by another
+    bool isDirectory = false;
+};
+
+// The scanned source tree as a structure of arrays: parent, first child and
+// next sibling links, size, times and flags each live in their own array,
+// and names sit back to back in a character arena. A node costs about 40
+// bytes plus its name and there is no allocation per node, so totalling
+// folder sizes is a linear pass rather than a pointer chase. Full paths are
+// rebuilt from the parent links when asked for.
+//
+// Storage grows in fixed chunks that never move, so nodes handed to another
+// thread after being added stay readable while more are appended. A node's
+// children always get higher ids than the node itself.
+class NodeTable {
+public:
+    NodeTable();
+    ~NodeTable();
+
+    NodeTable(const NodeTable&) = delete;
+    NodeTable& operator=(const NodeTable&) = delete;
+
+    // Start over with a single folder node, the root (id 0)
+    NodeId Reset(const std::wstring& rootName);
+    void Clear();
+
+    // Add entries, in order, as the children of parent, which must have none
+    // yet. Safe to call from several threads at once. Returns the id of the
+    // first; the rest follow it. NO_NODE if the table is full.
+    NodeId AppendChildren(NodeId parent, const NodeEntry* entries, size_t count);
+
+    // Add one entry to parent's children right after sibling `after`
+    // (NO_NODE: as the first child). Not safe against concurrent appends.
+    NodeId InsertChild(NodeId parent, NodeId after, const NodeEntry& entry);
+
+    // Unlink node, and with it its subtree, from its parent's children;
+    // previous is the sibling before it (NO_NODE if it is the first)
+    void Unlink(NodeId node, NodeId previous);
+
+    NodeId GetRoot() const { return count_ > 0 ? 0 : NO_NODE; }
+    NodeId GetParent(NodeId id) const { return ChunkOf(id).parent[Slot(id)]; }
+    NodeId GetFirstChild(NodeId id) const { return ChunkOf(id).firstChild[Slot(id)]; }
+    NodeId GetNextSibling(NodeId id) const { return ChunkOf(id).nextSibling[Slot(id)]; }
+    bool IsDirectory(NodeId id) const { return (ChunkOf(id).flags[Slot(id)] & FLAG_DIRECTORY) != 0; }
+
+    // Name, null-terminated, owned by the table
+    const wchar_t* GetName(NodeId id) const;
+    size_t GetNameLength(NodeId id) const { return ChunkOf(id).nameLength[Slot(id)]; }
+
+    uint64_t GetSize(NodeId id) const { return ChunkOf(id).size[Slot(id)]; }
+    void SetSize(NodeId id, uint64_t size) { ChunkOf(id).size[Slot(id)] = size; }
+    uint64_t GetMtime(NodeId id) const { return ChunkOf(id).mtime[Slot(id)]; }
+    void SetMtime(NodeId id, uint64_t mtime) { ChunkOf(id).mtime[Slot(id)] = mtime; }
+    uint64_t GetFileId(NodeId id) const { return ChunkOf(id).fileId[Slot(id)]; }
+    void SetFileId(NodeId id, uint64_t fileId) { ChunkOf(id).fileId[Slot(id)] = fileId; }
+
+    // Path of id relative to the root (L"" for the root itself)
+    std::wstring GetPath(NodeId id) const;
+
+    // Set every folder's size to the sum of its children's, in one pass
+    // from the highest id down (children come after their parents)
+    void SumFolderSizes();
+
+    // Ids handed out so far, unlinked ones included
+    size_t GetCount() const { return count_; }
+
+    // Heap bytes held by the table
+    size_t GetMemoryUsage() const;
+
+private:
+    static const uint32_t CHUNK_SHIFT = 14;
+    static const uint32_t CHUNK_NODES = 1u << CHUNK_SHIFT;
+    static const uint32_t MAX_CHUNKS = 1u << 14;            // 268M nodes
+    static const uint32_t NAME_CHUNK_SHIFT = 20;
+    static const uint32_t NAME_CHUNK_CHARS = 1u << NAME_CHUNK_SHIFT;
+    static const uint32_t MAX_NAME_CHUNKS = 1u << 12;       // 4G characters
+
+    static const uint8_t FLAG_DIRECTORY = 1;
+    static const uint8_t FLAG_UNLINKED = 2;
+
+    struct Chunk {
+        NodeId parent[CHUNK_NODES];
+        NodeId firstChild[CHUNK_NODES];
+        NodeId nextSibling[CHUNK_NODES];
+        uint64_t size[CHUNK_NODES];
+        uint64_t mtime[CHUNK_NODES];
+        uint64_t fileId[CHUNK_NODES];
+        uint32_t nameOffset[CHUNK_NODES];
+        uint16_t nameLength[CHUNK_NODES];
+        uint8_t flags[CHUNK_NODES];
+    };
+
+    static uint32_t Slot(NodeId id) { return id & (CHUNK_NODES - 1); }
+    Chunk& ChunkOf(NodeId id) const { return *chunks_[id >> CHUNK_SHIFT]; }
+
+    // Called with mutex_ held
+    NodeId Allocate(size_t count);
+    bool StoreName(const std::wstring& name, uint32_t& offset);
+    void Fill(NodeId id, NodeId parent, const NodeEntry& entry, uint32_t nameOffset);
+
+    std::mutex mutex_;
+    std::unique_ptr<std::unique_ptr<Chunk>[]> chunks_;
+    std::unique_ptr<std::unique_ptr<wchar_t[]>[]> nameChunks_;
+    std::atomic<size_t> count_{ 0 };   // nodes in use
+    size_t chunkCount_ = 0;
+    size_t nameChars_ = 0;      // arena characters in use, as an offset
+    size_t nameChunkCount_ = 0;
+};
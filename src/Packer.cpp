@@ -0,0 +1,352 @@
+#include "Packer.h"
+#include "FillSolver.h"
+#include <algorithm>
+#include <set>
+
+namespace {
+
+const uint32_t NO_SLOT = 0xFFFFFFFF;    // a path that isn't a folder of the items (yet)
+
+// Largest room left over a range of drives, as a binary tree over the drive
+// indices, to find the first drive a file fits on in O(log drives)
+class RoomTree {
+public:
+    explicit RoomTree(const std::vector<uint64_t>& available) {
+        leaves_ = 1;
+        while (leaves_ < available.size()) leaves_ *= 2;
+        room_.assign(2 * leaves_, 0);
+        for (size_t i = 0; i < available.size(); i++) room_[leaves_ + i] = available[i];
+        for (size_t i = leaves_ - 1; i > 0; i--) room_[i] = std::max(room_[2 * i], room_[2 * i + 1]);
+    }
+
+    // Lowest drive with at least size bytes left, or -1
+    int FindFirst(uint64_t size) const {
+        if (room_[1] < size) return -1;
+        size_t i = 1;
+        while (i < leaves_) {
+            i = room_[2 * i] >= size ? 2 * i : 2 * i + 1;
+        }
+        return static_cast<int>(i - leaves_);
+    }
+
+    void Set(int drive, uint64_t room) {
+        size_t i = leaves_ + drive;
+        room_[i] = room;
+        for (i /= 2; i > 0; i /= 2) room_[i] = std::max(room_[2 * i], room_[2 * i + 1]);
+    }
+
+private:
+    size_t leaves_;
+    std::vector<uint64_t> room_;
+};
+
+// Drives ordered by room left, then by index, for best and worst fit in
+// O(log drives). Takes placed bytes off available as it goes.
+class Rooms {
+public:
+    explicit Rooms(std::vector<uint64_t>& available) : available_(available) {
+        for (size_t i = 0; i < available.size(); i++) {
+            rooms_.emplace(available[i], static_cast<int>(i));
+        }
+    }
+
+    bool Fits(int drive, uint64_t size) const {
+        return drive >= 0 && drive < static_cast<int>(available_.size()) && available_[drive] >= size;
+    }
+
+    // Drive with the least room that still holds size (the lowest among
+    // equals), or -1
+    int BestFit(uint64_t size) const {
+        auto it = rooms_.lower_bound({ size, 0 });
+        return it != rooms_.end() ? it->second : -1;
+    }
+
+    // Drive with the most room (the lowest among equals)
+    int Roomiest() const {
+        return rooms_.lower_bound({ std::prev(rooms_.end())->first, 0 })->second;
+    }
+
+    void Take(int drive, uint64_t size) {
+        rooms_.erase({ available_[drive], drive });
+        available_[drive] -= size;
+        rooms_.emplace(available_[drive], drive);
+    }
+
+private:
+    std::vector<uint64_t>& available_;
+    std::set<std::pair<uint64_t, int>> rooms_;
+};
+
+// Packs folders whole where they fit, and splits only those that don't, so
+// each folder ends up on as few drives as possible
+class FolderPacker {
+public:
+    FolderPacker(const std::vector<PackItem>& items, const PathStore& paths,
+                 std::vector<uint64_t>& available, std::vector<int>& placement)
+        : items_(items), paths_(paths), rooms_(available), placement_(placement) {}
+
+    void Pack() {
+        // Items joining a folder that is already on a drive go there while
+        // it has room; the rest are packed by folder
+        for (uint32_t k = 0; k < items_.size(); k++) {
+            int home = items_[k].home;
+            if (!rooms_.Fits(home, items_[k].size)) continue;
+            placement_[k] = home;
+            rooms_.Take(home, items_[k].size);
+        }
+        Build();
+        PlaceFolder(0, -1);
+    }
+
+private:
+    struct Folder {
+        uint32_t parent = 0;
+        uint64_t size = 0;                  // the items below it
+        std::vector<uint32_t> folders;
+        std::vector<uint32_t> files;        // indices into items_
+    };
+
+    // Something to place when a folder is split
+    struct Child {
+        uint64_t size;
+        uint32_t index;
+        bool isFolder;
+    };
+
+    // Folders of the items, from their paths; a folder always comes after
+    // its parent, so sizes add up in one backward pass
+    void Build() {
+        folders_.assign(1, Folder());       // 0: the source root
+        slots_.assign(paths_.GetCount(), NO_SLOT);
+        std::vector<PathId> missing;
+        for (uint32_t k = 0; k < items_.size(); k++) {
+            if (placement_[k] >= 0) continue;
+            PathId dir = paths_.GetParent(items_[k].path);
+            missing.clear();
+            while (dir != NO_PATH && slots_[dir] == NO_SLOT) {
+                missing.push_back(dir);
+                dir = paths_.GetParent(dir);
+            }
+            uint32_t parent = dir == NO_PATH ? 0 : slots_[dir];
+            for (size_t m = missing.size(); m-- > 0;) {
+                uint32_t slot = static_cast<uint32_t>(folders_.size());
+                folders_.emplace_back();
+                folders_[slot].parent = parent;
+                folders_[parent].folders.push_back(slot);
+                slots_[missing[m]] = slot;
+                parent = slot;
+            }
+            folders_[parent].files.push_back(k);
+            folders_[parent].size += items_[k].size;
+        }
+        for (size_t f = folders_.size(); f-- > 1;) {
+            folders_[folders_[f].parent].size += folders_[f].size;
+        }
+    }
+
+    void PlaceFolder(uint32_t f, int preferred) {
+        const Folder& folder = folders_[f];
+
+        // Whole: on the drive its parent is using if it fits there, else on
+        // the drive it fits most tightly
+        int drive = rooms_.Fits(preferred, folder.size) ? preferred : rooms_.BestFit(folder.size);
+        if (drive >= 0) {
+            AssignFolder(f, drive);
+            rooms_.Take(drive, folder.size);
+            return;
+        }
+
+        // Too big for any one drive: split it. Largest first, its contents
+        // go onto one drive while they fit; the rest are placed one by one,
+        // folders again whole where possible.
+        std::vector<Child> children;
+        children.reserve(folder.folders.size() + folder.files.size());
+        for (uint32_t sub : folder.folders) children.push_back({ folders_[sub].size, sub, true });
+        for (uint32_t k : folder.files) children.push_back({ items_[k].size, k, false });
+        std::sort(children.begin(), children.end(), [](const Child& a, const Child& b) {
+            return a.size > b.size;
+        });
+
+        int current = rooms_.Fits(preferred, 1) ? preferred : rooms_.Roomiest();
+        std::vector<Child> rest;
+        for (const Child& child : children) {
+            if (child.size > 0 && !rooms_.Fits(current, child.size)) {
+                rest.push_back(child);
+                continue;
+            }
+            if (child.isFolder) AssignFolder(child.index, current);
+            else placement_[child.index] = current;
+            rooms_.Take(current, child.size);
+        }
+        for (const Child& child : rest) {
+            if (child.isFolder) {
+                PlaceFolder(child.index, -1);
+            } else {
+                drive = rooms_.BestFit(child.size);
+                if (drive < 0) continue;        // fits nowhere
+                placement_[child.index] = drive;
+                rooms_.Take(drive, child.size);
+            }
+        }
+    }
+
+    void AssignFolder(uint32_t f, int drive) {
+        std::vector<uint32_t> stack{ f };
+        while (!stack.empty()) {
+            const Folder& folder = folders_[stack.back()];
+            stack.pop_back();
+            for (uint32_t k : folder.files) placement_[k] = drive;
+            stack.insert(stack.end(), folder.folders.begin(), folder.folders.end());
+        }
+    }
+
+    const std::vector<PackItem>& items_;
+    const PathStore& paths_;
+    Rooms rooms_;
+    std::vector<int>& placement_;
+    std::vector<Folder> folders_;
+    std::vector<uint32_t> slots_;           // folder of each path id, by PathId
+};
+
+} // namespace
+
+// Pack with the drives' room in available, taking placed bytes off it
+static void PackInto(PackMethod method, const std::vector<PackItem>& items, const PathStore& paths,
+                     const std::vector<PackDrive>& drives,
+                     std::vector<uint64_t>& available, std::vector<int>& placement) {
+    if (method == PackMethod::KeepFoldersTogether) {
+        FolderPacker(items, paths, available, placement).Pack();
+        return;
+    }
+
+    // Placement order: as given, or largest first (ties keep their order,
+    // so equal files stay together in tree order)
+    std::vector<uint32_t> order(items.size());
+    if (method == PackMethod::FirstFit) {
+        for (size_t k = 0; k < items.size(); k++) order[k] = static_cast<uint32_t>(k);
+    } else {
+        // Sort the keys next to the indices rather than through them, so the
+        // sort stays in cache
+        std::vector<std::pair<uint64_t, uint32_t>> keys(items.size());
+        for (size_t k = 0; k < items.size(); k++) keys[k] = { items[k].size, static_cast<uint32_t>(k) };
+        std::sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first > b.first;
+            return a.second < b.second;
+        });
+        for (size_t k = 0; k < keys.size(); k++) order[k] = keys[k].second;
+    }
+
+    if (method == PackMethod::FirstFit || method == PackMethod::FirstFitDecreasing) {
+        RoomTree tree(available);
+        for (uint32_t k : order) {
+            int drive = tree.FindFirst(items[k].size);
+            if (drive < 0) continue;
+            available[drive] -= items[k].size;
+            tree.Set(drive, available[drive]);
+            placement[k] = drive;
+        }
+        return;
+    }
+
+    if (method == PackMethod::FinishTogether) {
+        // Each file on the drive with room that would finish it first;
+        // largest first, so the small files at the end even out the finish
+        // times
+        std::vector<double> finish(available.size());
+        for (size_t i = 0; i < drives.size(); i++) finish[i] = drives[i].seconds;
+        for (uint32_t k : order) {
+            uint64_t size = items[k].size;
+            int drive = -1;
+            double best = 0;
+            for (size_t i = 0; i < available.size(); i++) {
+                if (available[i] < size) continue;
+                double done = finish[i] + drives[i].speed.Predict(size, 1);
+                if (drive < 0 || done < best) {
+                    drive = static_cast<int>(i);
+                    best = done;
+                }
+            }
+            if (drive < 0) continue;
+            available[drive] -= size;
+            finish[drive] = best;
+            placement[k] = drive;
+        }
+        return;
+    }
+
+    // Best fit: least room that still holds the file; worst fit: most room
+    Rooms rooms(available);
+    for (uint32_t k : order) {
+        uint64_t size = items[k].size;
+        int drive = rooms.BestFit(size);
+        if (drive < 0) continue;
+        if (method == PackMethod::WorstFitDecreasing) drive = rooms.Roomiest();
+        rooms.Take(drive, size);
+        placement[k] = drive;
+    }
+}
+
+void Packer::Pack(PackMethod method, const std::vector<PackItem>& items, const PathStore& paths,
+                  std::vector<PackDrive>& drives, std::vector<int>& placement,
+                  FillReport* fill) {
+    placement.assign(items.size(), -1);
+    if (items.empty() || drives.empty()) return;
+
+    std::vector<uint64_t> available(drives.size());
+    for (size_t i = 0; i < drives.size(); i++) available[i] = drives[i].available;
+    if (method == PackMethod::OptimalFill) {
+        FillReport defaults;
+        if (!fill) fill = &defaults;
+        fill->room = 0;
+        for (uint64_t room : available) fill->room += room;
+
+        // Greedy fill of the same room, to report against
+        std::vector<uint64_t> greedyAvailable = available;
+        std::vector<int> greedyPlacement(items.size(), -1);
+        PackInto(PackMethod::FirstFitDecreasing, items, paths, drives, greedyAvailable, greedyPlacement);
+        fill->greedyBytes = 0;
+        for (size_t i = 0; i < drives.size(); i++) fill->greedyBytes += available[i] - greedyAvailable[i];
+
+        FillSolver solver(fill->budgetMs, 0, fill->cancel);
+        solver.Solve(items, available, placement);
+        fill->placedBytes = 0;
+        for (size_t i = 0; i < drives.size(); i++) fill->placedBytes += drives[i].available - available[i];
+        fill->optimal = solver.IsOptimal();
+    } else {
+        PackInto(method, items, paths, drives, available, placement);
+    }
+
+    for (size_t i = 0; i < drives.size(); i++) drives[i].available = available[i];
+    for (size_t k = 0; k < items.size(); k++) {
+        if (placement[k] >= 0) drives[placement[k]].seconds += drives[placement[k]].speed.Predict(items[k].size, 1);
+    }
+}
+
+std::vector<double> Packer::Simulate(const std::vector<PackItem>& items, const std::vector<int>& drives,
+                                     const std::vector<DriveSpeed>& speeds) {
+    std::vector<uint64_t> bytes(speeds.size(), 0), files(speeds.size(), 0);
+    for (size_t k = 0; k < items.size(); k++) {
+        int drive = drives[k];
+        if (drive < 0 || drive >= static_cast<int>(speeds.size())) continue;
+        bytes[drive] += items[k].size;
+        files[drive]++;
+    }
+    std::vector<double> seconds(speeds.size());
+    for (size_t i = 0; i < speeds.size(); i++) {
+        seconds[i] = speeds[i].Predict(bytes[i], files[i]);
+    }
+    return seconds;
+}
+
+const wchar_t* Packer::GetName(PackMethod method) {
+    switch (method) {
+    case PackMethod::FirstFit:              return L"First fit (tree order)";
+    case PackMethod::FirstFitDecreasing:    return L"First fit, largest first";
+    case PackMethod::BestFitDecreasing:     return L"Best fit, largest first";
+    case PackMethod::WorstFitDecreasing:    return L"Balance drives";
+    case PackMethod::KeepFoldersTogether:   return L"Keep folders together";
+    case PackMethod::FinishTogether:        return L"Finish drives together";
+    case PackMethod::OptimalFill:           return L"Fill drives fully";
+    default:                                return L"";
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "PathStore.h"
+#include "DriveProfile.h"
+
+// How files are spread over the destination drives
+enum class PackMethod {
+    FirstFit,               // tree order, each file on the first drive with room
+    FirstFitDecreasing,     // largest first, each on the first drive with room
+    BestFitDecreasing,      // largest first, each on the drive it leaves the least room on
+    WorstFitDecreasing,     // largest first, each on the drive with the most room (balances drives)
+    KeepFoldersTogether,    // whole folders where they fit; only the ones that don't are split
+    FinishTogether,         // largest first, each on the drive that would be done with it soonest
+    OptimalFill,            // each drive in turn filled as fully as any set of files can, within a time budget
+    Count
+};
+
+// One file to place
+struct PackItem {
+    PathId path;
+    uint64_t size;
+    int home = -1;              // drive its folder is already on (KeepFoldersTogether), or -1
+};
+
+// A destination drive as the packer sees it
+struct PackDrive {
+    uint64_t available = 0;     // room left for files
+    DriveSpeed speed;
+    double seconds = 0;         // predicted time to write what it already holds
+};
+
+// How an OptimalFill pack went, against a greedy fill of the same drives
+struct FillReport {
+    DWORD budgetMs = 2000;      // time the search may take, over all drives
+    const std::atomic<bool>* cancel = nullptr;  // stops the search early when set
+    uint64_t room = 0;          // room the drives had
+    uint64_t greedyBytes = 0;   // placed by first fit, largest first
+    uint64_t placedBytes = 0;   // placed by the search
+    bool optimal = false;       // every drive's search ran to the end
+};
+
+// Bin packing of files onto destination drives. Every method is O(n log n)
+// for n files: a sort by size, then a log-time lookup of the drive for each
+// file (a max tree over the drives for first fit, a balanced tree of the
+// drives keyed by room left for best and worst fit). Keeping folders
+// together works on the folder tree instead: a folder that fits on a drive
+// goes there whole; one that doesn't is split, its largest contents first,
+// and only as far down as needed, so few folders span several drives. Items
+// with a home drive (added to a plan whose folders are already placed) go
+// there first while it has room.
+// Finishing together weighs each drive's speed rather than its room: the
+// drives copy in parallel, so the job takes as long as the slowest drive's
+// share, and each file goes where it would be done soonest (O(drives) per
+// file, by the drives' predicted time so far). Optimal fill is a search,
+// not a heuristic (see FillSolver), bounded by a time budget instead.
+class Packer {
+public:
+    // Place items on drives, on top of what they already hold, taking what
+    // is placed off their room and adding it to their time. placement[k] is
+    // set to the drive items[k] went to, or -1 if it fits on none. paths
+    // holds the items' paths (their folders matter to KeepFoldersTogether).
+    // fill sets OptimalFill's budget and gets its report (null: default
+    // budget, no report).
+    static void Pack(PackMethod method, const std::vector<PackItem>& items, const PathStore& paths,
+                     std::vector<PackDrive>& drives, std::vector<int>& placement,
+                     FillReport* fill = nullptr);
+
+    // Predicted seconds each drive takes to write its share of a plan
+    // (drives as Pack sets it), all drives copying at once; the largest is
+    // how long the whole job takes
+    static std::vector<double> Simulate(const std::vector<PackItem>& items, const std::vector<int>& drives,
+                                        const std::vector<DriveSpeed>& speeds);
+
+    // Name for the UI
+    static const wchar_t* GetName(PackMethod method);
+};
@@ -0,0 +1,124 @@
+#include "PathStore.h"
+#include "ContentHash.h"
+#include <cwchar>
+
+uint64_t PathStore::HashName(PathId parent, const wchar_t* name, size_t length) {
+    return ContentHash::Compute(name, length * sizeof(wchar_t), parent);
+}
+
+PathId PathStore::Lookup(PathId parent, const wchar_t* name, size_t length, uint64_t hash) const {
+    if (table_.empty()) return NO_PATH;
+    size_t mask = table_.size() - 1;
+    for (size_t slot = static_cast<size_t>(hash) & mask; ; slot = (slot + 1) & mask) {
+        PathId id = table_[slot];
+        if (id == NO_PATH) return NO_PATH;
+        const Node& node = nodes_[id];
+        if (node.parent == parent && node.nameLength == length &&
+            wmemcmp(names_.data() + node.nameOffset, name, length) == 0) {
+            return id;
+        }
+    }
+}
+
+// Keep the table at most half full so probe runs stay short
+void PathStore::Grow() {
+    size_t slots = table_.empty() ? 1024 : table_.size() * 2;
+    table_.assign(slots, NO_PATH);
+    size_t mask = slots - 1;
+    for (PathId id = 0; id < nodes_.size(); id++) {
+        const Node& node = nodes_[id];
+        size_t slot = static_cast<size_t>(
+            HashName(node.parent, names_.data() + node.nameOffset, node.nameLength)) & mask;
+        while (table_[slot] != NO_PATH) slot = (slot + 1) & mask;
+        table_[slot] = id;
+    }
+}
+
+PathId PathStore::Child(PathId parent, const wchar_t* name, size_t length) {
+    uint64_t hash = HashName(parent, name, length);
+    PathId id = Lookup(parent, name, length, hash);
+    if (id != NO_PATH) return id;
+
+    if ((nodes_.size() + 1) * 2 > table_.size()) Grow();
+
+    id = static_cast<PathId>(nodes_.size());
+    nodes_.push_back({ parent, static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(length) });
+    names_.append(name, length);
+
+    size_t mask = table_.size() - 1;
+    size_t slot = static_cast<size_t>(hash) & mask;
+    while (table_[slot] != NO_PATH) slot = (slot + 1) & mask;
+    table_[slot] = id;
+    return id;
+}
+
+PathId PathStore::Intern(const std::wstring& relativePath) {
+    PathId id = NO_PATH;
+    size_t start = 0;
+    for (;;) {
+        size_t sep = relativePath.find(L'\\', start);
+        size_t end = (sep == std::wstring::npos) ? relativePath.size() : sep;
+        id = Child(id, relativePath.data() + start, end - start);
+        if (sep == std::wstring::npos) return id;
+        start = sep + 1;
+    }
+}
+
+PathId PathStore::Find(const std::wstring& relativePath) const {
+    PathId id = NO_PATH;
+    size_t start = 0;
+    for (;;) {
+        size_t sep = relativePath.find(L'\\', start);
+        size_t end = (sep == std::wstring::npos) ? relativePath.size() : sep;
+        const wchar_t* name = relativePath.data() + start;
+        id = Lookup(id, name, end - start, HashName(id, name, end - start));
+        if (id == NO_PATH || sep == std::wstring::npos) return id;
+        start = sep + 1;
+    }
+}
+
+std::wstring PathStore::GetName(PathId id) const {
+    const Node& node = nodes_[id];
+    return names_.substr(node.nameOffset, node.nameLength);
+}
+
+std::wstring PathStore::GetPath(PathId id) const {
+    // Size the result first, then fill it right to left
+    size_t length = 0;
+    for (PathId p = id; p != NO_PATH; p = nodes_[p].parent) {
+        length += nodes_[p].nameLength + 1;
+    }
+    if (length == 0) return L"";
+
+    std::wstring path(length - 1, L'\\');
+    size_t pos = length - 1;
+    for (PathId p = id; p != NO_PATH; p = nodes_[p].parent) {
+        const Node& node = nodes_[p];
+        pos -= node.nameLength;
+        wmemcpy(&path[pos], names_.data() + node.nameOffset, node.nameLength);
+        if (pos > 0) pos--;
+    }
+    return path;
+}
+
+bool PathStore::IsUnder(PathId id, PathId ancestor) const {
+    for (PathId p = nodes_[id].parent; p != NO_PATH; p = nodes_[p].parent) {
+        if (p == ancestor) return true;
+    }
+    return false;
+}
+
+size_t PathStore::GetMemoryUsage() const {
+    return nodes_.capacity() * sizeof(Node) +
+           names_.capacity() * sizeof(wchar_t) +
+           table_.capacity() * sizeof(PathId);
+}
+
+void PathStore::Clear() {
+    nodes_.clear();
+    nodes_.shrink_to_fit();
+    names_.clear();
+    names_.shrink_to_fit();
+    table_.clear();
+    table_.shrink_to_fit();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Compact integer handle for a relative path held in a PathStore
+typedef uint32_t PathId;
+static const PathId NO_PATH = 0xFFFFFFFF;
+
+// Interned relative paths, stored as a table of (parent id, name) nodes so a
+// deep prefix like "Photos\2019\vacation" is kept once no matter how many
+// files sit under it. Ids are dense, start at 0 and stay valid until Clear.
+// Lookups hash (parent, name) into one open-addressed table of ids; there is
+// no per-path heap allocation.
+class PathStore {
+public:
+    PathStore() = default;
+
+    PathStore(const PathStore&) = delete;
+    PathStore& operator=(const PathStore&) = delete;
+
+    // Id of name inside parent (NO_PATH for a top-level item), added if new
+    PathId Child(PathId parent, const wchar_t* name, size_t length);
+    PathId Child(PathId parent, const std::wstring& name) { return Child(parent, name.data(), name.size()); }
+
+    // Id of a backslash-separated relative path, adding it and any missing
+    // ancestors if new
+    PathId Intern(const std::wstring& relativePath);
+
+    // Id of a relative path, or NO_PATH if it was never added
+    PathId Find(const std::wstring& relativePath) const;
+
+    PathId GetParent(PathId id) const { return nodes_[id].parent; }
+    std::wstring GetName(PathId id) const;
+    std::wstring GetPath(PathId id) const;
+
+    // True if ancestor is a proper ancestor of id
+    bool IsUnder(PathId id, PathId ancestor) const;
+
+    size_t GetCount() const { return nodes_.size(); }
+
+    // Heap bytes held by the store (nodes, name text and lookup table)
+    size_t GetMemoryUsage() const;
+
+    void Clear();
+
+private:
+    struct Node {
+        PathId parent;
+        uint32_t nameOffset;    // into names_
+        uint32_t nameLength;    // in characters
+    };
+
+    PathId Lookup(PathId parent, const wchar_t* name, size_t length, uint64_t hash) const;
+    static uint64_t HashName(PathId parent, const wchar_t* name, size_t length);
+    void Grow();
+
+    std::vector<Node> nodes_;
+    std::wstring names_;            // every node's name, back to back
+    std::vector<PathId> table_;     // open-addressed, NO_PATH = empty slot
+};
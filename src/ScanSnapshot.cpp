@@ -0,0 +1,178 @@
+#include "ScanSnapshot.h"
+#include "MappedFile.h"
+#include <vector>
+#include <cstring>
+
+static const char SNAPSHOT_MAGIC[4] = { 'D', 'S', 'S', 'N' };
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const size_t WRITE_CHUNK = 1024 * 1024;
+
+namespace {
+
+// Buffers output and writes it out a chunk at a time
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(HANDLE hFile) : hFile_(hFile) { buf_.reserve(WRITE_CHUNK * 2); }
+
+    void Put(const void* data, size_t length) {
+        const char* p = static_cast<const char*>(data);
+        buf_.insert(buf_.end(), p, p + length);
+        if (buf_.size() >= WRITE_CHUNK) Flush();
+    }
+
+    template <typename T>
+    void PutValue(T value) { Put(&value, sizeof(value)); }
+
+    bool Flush() {
+        if (ok_ && !buf_.empty()) {
+            DWORD written = 0;
+            ok_ = WriteFile(hFile_, buf_.data(), static_cast<DWORD>(buf_.size()), &written, nullptr) &&
+                  written == buf_.size();
+        }
+        buf_.clear();
+        return ok_;
+    }
+
+    bool Ok() const { return ok_; }
+
+private:
+    HANDLE hFile_;
+    std::vector<char> buf_;
+    bool ok_ = true;
+};
+
+// Bounds-checked cursor over the mapped file
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+    bool Get(void* out, size_t length) {
+        if (static_cast<size_t>(end_ - pos_) < length) return false;
+        memcpy(out, pos_, length);
+        pos_ += length;
+        return true;
+    }
+
+    template <typename T>
+    bool GetValue(T& value) { return Get(&value, sizeof(value)); }
+
+    bool GetString(std::wstring& s, size_t chars) {
+        if (static_cast<size_t>(end_ - pos_) / sizeof(wchar_t) < chars) return false;
+        s.resize(chars);
+        return Get(&s[0], chars * sizeof(wchar_t));
+    }
+
+    size_t Remaining() const { return end_ - pos_; }
+
+private:
+    const char* pos_;
+    const char* end_;
+};
+
+// Smallest encoded node: flag, name length, size, mtime, fileId
+const size_t MIN_NODE_BYTES = 1 + 2 + 3 * sizeof(uint64_t);
+
+void WriteNode(SnapshotWriter& out, const NodeTable& nodes, NodeId id) {
+    uint16_t nameChars = static_cast<uint16_t>(nodes.GetNameLength(id));
+    out.PutValue<uint8_t>(nodes.IsDirectory(id) ? 1 : 0);
+    out.PutValue(nameChars);
+    out.Put(nodes.GetName(id), nameChars * sizeof(wchar_t));
+    out.PutValue(nodes.GetSize(id));
+    out.PutValue(nodes.GetMtime(id));
+    out.PutValue(nodes.GetFileId(id));
+    if (nodes.IsDirectory(id)) {
+        uint32_t childCount = 0;
+        for (NodeId c = nodes.GetFirstChild(id); c != NO_NODE; c = nodes.GetNextSibling(c)) {
+            childCount++;
+        }
+        out.PutValue(childCount);
+        for (NodeId c = nodes.GetFirstChild(id); c != NO_NODE; c = nodes.GetNextSibling(c)) {
+            WriteNode(out, nodes, c);
+        }
+    }
+}
+
+bool ReadEntry(SnapshotReader& in, NodeEntry& entry) {
+    uint8_t isDirectory;
+    uint16_t nameChars;
+    if (!in.GetValue(isDirectory) || !in.GetValue(nameChars) ||
+        !in.GetString(entry.name, nameChars) ||
+        !in.GetValue(entry.size) || !in.GetValue(entry.mtime) || !in.GetValue(entry.fileId)) {
+        return false;
+    }
+    entry.isDirectory = isDirectory != 0;
+    return true;
+}
+
+bool ReadChildren(SnapshotReader& in, NodeTable& nodes, NodeId parent) {
+    uint32_t childCount;
+    if (!in.GetValue(childCount) || childCount > in.Remaining() / MIN_NODE_BYTES) return false;
+
+    NodeEntry entry;
+    NodeId previous = NO_NODE;
+    for (uint32_t i = 0; i < childCount; i++) {
+        if (!ReadEntry(in, entry)) return false;
+        NodeId id = nodes.InsertChild(parent, previous, entry);
+        if (id == NO_NODE) return false;
+        if (entry.isDirectory) {
+            nodes.SetSize(id, entry.size);
+            if (!ReadChildren(in, nodes, id)) return false;
+        }
+        previous = id;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ScanSnapshot::Save(const std::wstring& path, const std::wstring& sourcePath, const NodeTable& nodes) {
+    if (nodes.GetRoot() == NO_NODE) return false;
+
+    std::wstring tempPath = path + L".tmp";
+    HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    SnapshotWriter out(hFile);
+    out.Put(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    out.PutValue(SNAPSHOT_VERSION);
+    out.PutValue(static_cast<uint32_t>(sourcePath.size()));
+    out.Put(sourcePath.data(), sourcePath.size() * sizeof(wchar_t));
+    WriteNode(out, nodes, nodes.GetRoot());
+    bool ok = out.Flush();
+    CloseHandle(hFile);
+
+    if (!ok || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ScanSnapshot::Load(const std::wstring& path, const std::wstring& sourcePath, NodeTable& nodes) {
+    MappedFile file;
+    if (!file.Open(path)) return false;
+
+    SnapshotReader in(file.Data(), file.Size());
+    char magic[4];
+    uint32_t version, sourceChars;
+    std::wstring source;
+    if (!in.Get(magic, sizeof(magic)) || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 ||
+        !in.GetValue(version) || version != SNAPSHOT_VERSION ||
+        !in.GetValue(sourceChars) || !in.GetString(source, sourceChars) ||
+        _wcsicmp(source.c_str(), sourcePath.c_str()) != 0) {
+        return false;
+    }
+
+    NodeEntry rootEntry;
+    if (!ReadEntry(in, rootEntry) || !rootEntry.isDirectory) return false;
+    NodeId root = nodes.Reset(rootEntry.name);
+    nodes.SetSize(root, rootEntry.size);
+    nodes.SetMtime(root, rootEntry.mtime);
+    nodes.SetFileId(root, rootEntry.fileId);
+    if (!ReadChildren(in, nodes, root)) {
+        nodes.Clear();
+        return false;
+    }
+    return true;
+}
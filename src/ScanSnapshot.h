@@ -0,0 +1,25 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+#include "NodeTable.h"
+
+// Binary snapshot of a scanned source tree (DSplit_{hash}.scan, beside the
+// transfer log), so reopening a source only re-lists the folders that
+// changed since. Layout, all little-endian:
+//   magic "DSSN" | uint32 version | uint32 sourceChars | source (UTF-16)
+//   root node
+// where each node, in pre-order, is
+//   uint8 isDirectory | uint16 nameChars | name (UTF-16) |
+//   uint64 size | uint64 mtime | uint64 fileId | [uint32 childCount, children]
+// and only folders have the bracketed part.
+class ScanSnapshot {
+public:
+    // Write the tree in nodes (the scan of sourcePath) to path via a temp
+    // file and rename
+    static bool Save(const std::wstring& path, const std::wstring& sourcePath, const NodeTable& nodes);
+
+    // Read a snapshot into nodes, replacing what they held. Fails if the
+    // file is missing, damaged, or was taken of a different source folder.
+    static bool Load(const std::wstring& path, const std::wstring& sourcePath, NodeTable& nodes);
+};
@@ -0,0 +1,214 @@
+#include "SmallFileCopy.h"
+#include "BufferPool.h"
+#include "ContentHash.h"
+
+static const size_t MAX_BACKLOG = 256;          // queued jobs before Submit blocks
+static const ULONGLONG ADJUST_WINDOW_MS = 250;  // min measurement window per step
+
+// True if the open file has data streams besides the unnamed one. Volumes
+// without named streams (FAT, some shares) fail the query: none.
+static bool HasExtraStreams(HANDLE hFile) {
+    LONGLONG buf[128];
+    if (!GetFileInformationByHandleEx(hFile, FileStreamInfo, buf, sizeof(buf))) {
+        return GetLastError() == ERROR_MORE_DATA;
+    }
+    return reinterpret_cast<const FILE_STREAM_INFO*>(buf)->NextEntryOffset != 0;
+}
+
+bool CopySmallFile(const std::wstring& src, const std::wstring& dst, uint64_t fileSize,
+                   CopyProgressFn progress, void* context, uint64_t* digest) {
+    // One extra byte lets us notice a file that grew since it was scanned
+    PooledBuffer buffer(static_cast<size_t>(fileSize) + 1);
+    if (!buffer) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+
+    HANDLE hSrc = CreateFileW(src.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hSrc == INVALID_HANDLE_VALUE) return false;
+
+    DWORD total = 0;
+    bool ok = true;
+    while (ok && total <= fileSize) {
+        DWORD bytesRead = 0;
+        ok = ReadFile(hSrc, static_cast<char*>(buffer.Get()) + total,
+            static_cast<DWORD>(fileSize + 1 - total), &bytesRead, nullptr) != FALSE;
+        if (bytesRead == 0) break;
+        total += bytesRead;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    ok = ok && GetFileInformationByHandle(hSrc, &info);
+    // Named streams and encryption are only carried over by CopyFileExW
+    bool copyWhole = ok && ((info.dwFileAttributes & FILE_ATTRIBUTE_ENCRYPTED) || HasExtraStreams(hSrc));
+    DWORD err = ok ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(hSrc);
+    if (!ok) {
+        SetLastError(err);
+        return false;
+    }
+    if (total != fileSize) {
+        SetLastError(ERROR_FILE_INVALID);
+        return false;
+    }
+    if (digest) {
+        *digest = ContentHash::Compute(buffer.Get(), total);
+    }
+
+    if (copyWhole) {
+        if (!CopyFileExW(src.c_str(), dst.c_str(), nullptr, nullptr, nullptr, 0)) return false;
+        if (progress) progress(fileSize, context);
+        return true;
+    }
+
+    HANDLE hDst = CreateFileW(dst.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hDst == INVALID_HANDLE_VALUE) return false;
+
+    DWORD written = 0;
+    ok = total == 0 || (WriteFile(hDst, buffer.Get(), total, &written, nullptr) && written == total);
+    if (ok) {
+        SetFileTime(hDst, &info.ftCreationTime, &info.ftLastAccessTime, &info.ftLastWriteTime);
+    }
+    err = ok ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(hDst);
+
+    if (!ok) {
+        DeleteFileW(dst.c_str());
+        SetLastError(err);
+        return false;
+    }
+
+    // Copy file attributes (after the write, as read-only would refuse it)
+    SetFileAttributesW(dst.c_str(), info.dwFileAttributes);
+
+    if (progress) progress(fileSize, context);
+    return true;
+}
+
+// --- SmallFilePool ---
+
+SmallFilePool::SmallFilePool(int maxThreads, JobFn fn, void* context)
+    : fn_(fn), context_(context), maxThreads_(maxThreads < 1 ? 1 : maxThreads) {
+    limit_ = maxThreads_ < 4 ? maxThreads_ : 4;
+    windowStart_ = GetTickCount64();
+
+    starts_.resize(maxThreads_);
+    for (int i = 0; i < maxThreads_; i++) {
+        starts_[i] = { this, i };
+        HANDLE h = CreateThread(nullptr, 0, ThreadProc, &starts_[i], 0, nullptr);
+        // Slots run 0..n-1, so stop at the first thread that won't start
+        if (!h) break;
+        threads_.push_back(h);
+    }
+
+    // Adapt between 1 and the threads there are; with none, Submit runs jobs itself
+    std::lock_guard<std::mutex> lock(mutex_);
+    int started = static_cast<int>(threads_.size());
+    if (started < maxThreads_) {
+        maxThreads_ = started > 0 ? started : 1;
+        if (limit_ > maxThreads_) limit_ = maxThreads_;
+    }
+}
+
+SmallFilePool::~SmallFilePool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (HANDLE h : threads_) {
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+    }
+}
+
+DWORD WINAPI SmallFilePool::ThreadProc(LPVOID param) {
+    auto* start = static_cast<ThreadStart*>(param);
+    start->pool->WorkerLoop(start->slot);
+    return 0;
+}
+
+void SmallFilePool::Submit(size_t job) {
+    if (threads_.empty()) {
+        fn_(job, 0, context_);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        spaceCv_.wait(lock, [this] { return jobs_.size() < MAX_BACKLOG; });
+        jobs_.push_back(job);
+    }
+    // notify_all: a parked thread above the limit must not swallow the wakeup
+    workCv_.notify_all();
+}
+
+void SmallFilePool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    spaceCv_.wait(lock, [this] { return jobs_.empty() && running_ == 0; });
+}
+
+bool SmallFilePool::IsIdle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.empty() && running_ == 0;
+}
+
+int SmallFilePool::GetConcurrency() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+void SmallFilePool::WorkerLoop(int slot) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        // Threads with slot >= limit_ park here until the limit rises
+        workCv_.wait(lock, [&] {
+            return stopping_ || (!jobs_.empty() && running_ < limit_ && slot < limit_);
+        });
+        if (jobs_.empty() && stopping_) break;
+        if (jobs_.empty()) continue;
+
+        size_t job = jobs_.front();
+        jobs_.pop_front();
+        running_++;
+        lock.unlock();
+        spaceCv_.notify_all();
+
+        fn_(job, slot, context_);
+
+        lock.lock();
+        running_--;
+        windowCompleted_++;
+        AdjustConcurrency();
+        spaceCv_.notify_all();
+    }
+}
+
+// Hill climbing: after each measurement window, keep stepping the limit in the
+// same direction while jobs/second improves; reverse when it drops. Caller
+// holds mutex_.
+void SmallFilePool::AdjustConcurrency() {
+    ULONGLONG now = GetTickCount64();
+    ULONGLONG elapsed = now - windowStart_;
+    if (elapsed < ADJUST_WINDOW_MS || windowCompleted_ < static_cast<uint64_t>(limit_) * 4)
+        return;
+
+    double rate = windowCompleted_ * 1000.0 / elapsed;
+    if (rate < lastRate_ * 0.95) {
+        direction_ = -direction_;
+    }
+    lastRate_ = rate;
+
+    int next = limit_ + direction_;
+    if (next < 1 || next > maxThreads_) {
+        direction_ = -direction_;
+        next = limit_ + direction_;
+        if (next < 1 || next > maxThreads_) next = limit_;
+    }
+    if (next > limit_) workCv_.notify_all();
+    limit_ = next;
+
+    windowStart_ = now;
+    windowCompleted_ = 0;
+}
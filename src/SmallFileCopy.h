@@ -0,0 +1,77 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "CopyEngine.h"
+
+// Copy a small file with one buffered read and one write through a pooled
+// buffer, then copy timestamps and attributes. Files with named streams or
+// EFS encryption are read the same way but written by CopyFileExW, which
+// keeps those. Fails with ERROR_FILE_INVALID if the source size no longer
+// matches fileSize. If digest is non-null, the content hash of the bytes
+// read is stored there.
+bool CopySmallFile(const std::wstring& src, const std::wstring& dst, uint64_t fileSize,
+                   CopyProgressFn progress, void* context, uint64_t* digest = nullptr);
+
+// Bounded pool of threads for small-file jobs. Many files are in their
+// open/read/create/write/close sequence at once, so per-file latency overlaps
+// instead of adding up. The number of jobs allowed to run concurrently
+// adapts between 1 and maxThreads by hill climbing on completed jobs/second.
+class SmallFilePool {
+public:
+    // job: opaque id passed to Submit; slot: 0..maxThreads-1, stable per thread
+    typedef void (*JobFn)(size_t job, int slot, void* context);
+
+    SmallFilePool(int maxThreads, JobFn fn, void* context);
+    ~SmallFilePool();
+
+    SmallFilePool(const SmallFilePool&) = delete;
+    SmallFilePool& operator=(const SmallFilePool&) = delete;
+
+    // Queue a job. Blocks while the backlog is full. If no thread could be
+    // started, runs the job on the caller's thread (slot 0) instead.
+    void Submit(size_t job);
+
+    // Block until every submitted job has finished
+    void WaitIdle();
+
+    // True if no job is queued or running
+    bool IsIdle() const;
+
+    int GetConcurrency() const;
+
+private:
+    struct ThreadStart {
+        SmallFilePool* pool;
+        int slot;
+    };
+
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    void WorkerLoop(int slot);
+    void AdjustConcurrency();
+
+    JobFn fn_;
+    void* context_;
+    int maxThreads_;
+    std::vector<ThreadStart> starts_;
+    std::vector<HANDLE> threads_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable workCv_;    // jobs available or limit raised
+    std::condition_variable spaceCv_;   // backlog drained or pool idle
+    std::deque<size_t> jobs_;
+    int running_ = 0;
+    int limit_;
+    bool stopping_ = false;
+
+    // Hill climbing state
+    ULONGLONG windowStart_ = 0;
+    uint64_t windowCompleted_ = 0;
+    double lastRate_ = 0.0;
+    int direction_ = 1;
+};
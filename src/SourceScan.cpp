@@ -0,0 +1,109 @@
+#include "SourceScan.h"
+#include "ScanSnapshot.h"
+#include "Utils.h"
+
+SourceScan::SourceScan() {}
+
+SourceScan::~SourceScan() {
+    Cancel();
+    Wait();
+}
+
+bool SourceScan::Start(HWND hWndNotify, const std::wstring& path, NodeTable& nodes,
+                       const std::wstring& snapshotPath, int threads) {
+    Cancel();
+    Wait();
+
+    hWndNotify_ = hWndNotify;
+    path_ = path;
+    snapshotPath_ = snapshotPath;
+    nodes_ = &nodes;
+    threads_ = threads;
+    cancelled_ = false;
+    finished_ = false;
+    listed_.clear();
+    foldersFound_ = 0;
+    foldersReused_ = 0;
+    filesFound_ = 0;
+    bytesFound_ = 0;
+
+    hThread_ = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+    return hThread_ != nullptr;
+}
+
+void SourceScan::Cancel() {
+    cancelled_ = true;
+}
+
+void SourceScan::Wait() {
+    if (hThread_) {
+        WaitForSingleObject(hThread_, INFINITE);
+        CloseHandle(hThread_);
+        hThread_ = nullptr;
+    }
+}
+
+DWORD WINAPI SourceScan::ThreadProc(LPVOID param) {
+    auto* self = static_cast<SourceScan*>(param);
+
+    NodeTable previous;
+    bool havePrevious = !self->snapshotPath_.empty() &&
+        ScanSnapshot::Load(self->snapshotPath_, self->path_, previous);
+
+    DirectoryScanner scanner(self->threads_);
+    scanner.Scan(self->path_, *self->nodes_, self->nodes_->GetRoot(),
+        havePrevious ? &previous : nullptr, &self->cancelled_, OnListed, self);
+
+    // A cancelled scan has holes; keep the old snapshot rather than save them
+    if (!self->cancelled_ && !self->snapshotPath_.empty()) {
+        size_t sep = self->snapshotPath_.find_last_of(L"\\/");
+        if (sep != std::wstring::npos) {
+            Utils::EnsureDirectoryExists(self->snapshotPath_.substr(0, sep));
+        }
+        ScanSnapshot::Save(self->snapshotPath_, self->path_, *self->nodes_);
+    }
+
+    self->finished_ = true;
+    if (self->hWndNotify_) {
+        PostMessageW(self->hWndNotify_, WM_SCAN_COMPLETE, self->cancelled_ ? 1 : 0, 0);
+    }
+    return 0;
+}
+
+void SourceScan::OnListed(NodeId dir, bool reused, void* context) {
+    auto* self = static_cast<SourceScan*>(context);
+    const NodeTable& nodes = *self->nodes_;
+
+    uint64_t files = 0, bytes = 0;
+    size_t items = 1;
+    for (NodeId c = nodes.GetFirstChild(dir); c != NO_NODE; c = nodes.GetNextSibling(c)) {
+        items++;
+        if (!nodes.IsDirectory(c)) {
+            files++;
+            bytes += nodes.GetSize(c);
+        }
+    }
+    self->foldersFound_++;
+    if (reused) self->foldersReused_++;
+    self->filesFound_ += files;
+    self->bytesFound_ += bytes;
+
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    self->listed_.push_back({ dir, items });
+}
+
+bool SourceScan::TakeBatch(std::vector<NodeId>& out, size_t maxItems) {
+    // Read before draining: if the scan was finished then, nothing can be
+    // queued after the drain below
+    bool finished = finished_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t items = 0;
+    while (!listed_.empty() && items < maxItems) {
+        const Listed& dir = listed_.front();
+        items += dir.items;
+        out.push_back(dir.dir);
+        listed_.pop_front();
+    }
+    return !(finished && listed_.empty());
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include "DirectoryScanner.h"
+
+// Posted when the scan thread has finished (wParam = 1 if it was cancelled)
+#define WM_SCAN_COMPLETE        (WM_USER + 110)
+
+// Background scan of a source folder. A DirectoryScanner runs on its own
+// thread and queues each folder as soon as it has been listed; the consumer
+// drains the queue in bounded batches with TakeBatch, on its own schedule
+// (the UI pulls from a timer, so a flood of results never starves input).
+// Nothing here touches a window except the final WM_SCAN_COMPLETE, so a
+// consumer without one can poll TakeBatch until it returns false.
+class SourceScan {
+public:
+    SourceScan();
+    ~SourceScan();
+
+    SourceScan(const SourceScan&) = delete;
+    SourceScan& operator=(const SourceScan&) = delete;
+
+    // Scan path into nodes, under its root, on a background thread. nodes
+    // must stay alive, and only the folders handed out by TakeBatch may be
+    // read, until the scan has been waited for. hWndNotify may be null.
+    // snapshotPath (optional): a ScanSnapshot of an earlier scan is used to
+    // skip unchanged folders, and is replaced with this scan once it
+    // completes.
+    bool Start(HWND hWndNotify, const std::wstring& path, NodeTable& nodes,
+               const std::wstring& snapshotPath = L"", int threads = 0);
+
+    // Request cancellation; folders not listed yet are left empty
+    void Cancel();
+
+    // Block until the scan thread has exited
+    void Wait();
+
+    // True until the scan thread has finished (or was never started)
+    bool IsRunning() const { return hThread_ != nullptr && !finished_; }
+    bool WasCancelled() const { return cancelled_; }
+
+    // Move listed folders into out, in listing order (a folder always comes
+    // after its parent), stopping once they hold maxItems children between
+    // them. Once the scan has finished, folder sizes are final too. Returns
+    // false when the scan has finished and everything has been handed out.
+    bool TakeBatch(std::vector<NodeId>& out, size_t maxItems);
+
+    // Live counters, readable from any thread
+    uint64_t GetFoldersFound() const { return foldersFound_; }
+    uint64_t GetFoldersReused() const { return foldersReused_; }      // unchanged since the snapshot
+    uint64_t GetFilesFound() const { return filesFound_; }
+    uint64_t GetBytesFound() const { return bytesFound_; }
+
+private:
+    static DWORD WINAPI ThreadProc(LPVOID param);
+    static void OnListed(NodeId dir, bool reused, void* context);
+
+    HWND hWndNotify_ = nullptr;
+    std::wstring path_;
+    std::wstring snapshotPath_;
+    NodeTable* nodes_ = nullptr;
+    int threads_ = 0;
+    HANDLE hThread_ = nullptr;
+    std::atomic<bool> cancelled_{ false };
+    std::atomic<bool> finished_{ false };
+
+    std::mutex mutex_;
+    struct Listed {
+        NodeId dir;
+        size_t items;       // children, plus one for the folder itself
+    };
+    std::deque<Listed> listed_;             // folders listed but not yet taken
+
+    std::atomic<uint64_t> foldersFound_{ 0 };
+    std::atomic<uint64_t> foldersReused_{ 0 };
+    std::atomic<uint64_t> filesFound_{ 0 };
+    std::atomic<uint64_t> bytesFound_{ 0 };
+};
@@ -0,0 +1,267 @@
+#include "TransferCatalog.h"
+#include "TransferLog.h"
+#include "ContentHash.h"
+#include <unordered_map>
+#include <cstring>
+
+static const char CATALOG_MAGIC[4] = { 'D', 'S', 'C', 'T' };
+static const uint32_t CATALOG_VERSION = 1;
+
+uint64_t TransferCatalog::HashPath(const wchar_t* path, size_t length) {
+    return ContentHash::Compute(path, length * sizeof(wchar_t));
+}
+
+bool TransferCatalog::Open(const std::wstring& path) {
+    Close();
+    if (!file_.Open(path)) return false;
+
+    const char* base = file_.Data();
+    uint64_t size = file_.Size();
+    if (size < sizeof(CatalogHeader)) {
+        Close();
+        return false;
+    }
+
+    auto* header = reinterpret_cast<const CatalogHeader*>(base);
+    auto fits = [size](uint64_t pos, uint64_t count, uint64_t elemSize) {
+        return pos <= size && count <= (size - pos) / elemSize;
+    };
+    bool valid = memcmp(header->magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) == 0 &&
+        header->version == CATALOG_VERSION &&
+        header->indexSlots != 0 && (header->indexSlots & (header->indexSlots - 1)) == 0 &&
+        header->indexSlots > header->recordCount &&
+        header->sourceString < header->stringCount &&
+        fits(header->stringOffsetsPos, header->stringCount + 1ull, sizeof(uint32_t)) &&
+        fits(header->nodesPos, header->nodeCount, sizeof(CatalogNode)) &&
+        fits(header->recordsPos, header->recordCount, sizeof(CatalogRecord)) &&
+        fits(header->indexPos, header->indexSlots, sizeof(uint32_t));
+    if (valid) {
+        auto* offsets = reinterpret_cast<const uint32_t*>(base + header->stringOffsetsPos);
+        valid = fits(header->stringBlobPos, offsets[header->stringCount], sizeof(wchar_t));
+    }
+    if (!valid) {
+        Close();
+        return false;
+    }
+
+    header_ = header;
+    stringOffsets_ = reinterpret_cast<const uint32_t*>(base + header->stringOffsetsPos);
+    stringBlob_ = reinterpret_cast<const wchar_t*>(base + header->stringBlobPos);
+    nodes_ = reinterpret_cast<const CatalogNode*>(base + header->nodesPos);
+    records_ = reinterpret_cast<const CatalogRecord*>(base + header->recordsPos);
+    index_ = reinterpret_cast<const uint32_t*>(base + header->indexPos);
+    return true;
+}
+
+void TransferCatalog::Close() {
+    file_.Close();
+    header_ = nullptr;
+    stringOffsets_ = nullptr;
+    stringBlob_ = nullptr;
+    nodes_ = nullptr;
+    records_ = nullptr;
+    index_ = nullptr;
+}
+
+size_t TransferCatalog::GetCount() const {
+    return header_ ? header_->recordCount : 0;
+}
+
+const wchar_t* TransferCatalog::String(uint32_t id, size_t& length) const {
+    if (id >= header_->stringCount || stringOffsets_[id + 1] < stringOffsets_[id] ||
+        stringOffsets_[id + 1] > stringOffsets_[header_->stringCount]) {
+        length = 0;
+        return L"";
+    }
+    length = stringOffsets_[id + 1] - stringOffsets_[id];
+    return stringBlob_ + stringOffsets_[id];
+}
+
+std::wstring TransferCatalog::GetSourcePath() const {
+    if (!header_) return L"";
+    size_t length;
+    const wchar_t* s = String(header_->sourceString, length);
+    return std::wstring(s, length);
+}
+
+// Compare a node chain against a path right to left, one component at a
+// time, without building the stored path
+bool TransferCatalog::PathEquals(uint32_t node, const std::wstring& path) const {
+    size_t pos = path.size();
+    for (uint32_t depth = 0; depth <= header_->nodeCount; depth++) {
+        if (node >= header_->nodeCount) return false;
+        size_t length;
+        const wchar_t* name = String(nodes_[node].name, length);
+        if (length > pos || wmemcmp(path.data() + pos - length, name, length) != 0)
+            return false;
+        pos -= length;
+
+        node = nodes_[node].parent;
+        if (node == NO_NODE) return pos == 0;
+        if (pos == 0 || path[pos - 1] != L'\\') return false;
+        pos--;
+    }
+    return false; // cycle in a corrupt file
+}
+
+std::wstring TransferCatalog::BuildPath(uint32_t node) const {
+    std::vector<uint32_t> chain;
+    while (node < header_->nodeCount && chain.size() <= header_->nodeCount) {
+        chain.push_back(node);
+        node = nodes_[node].parent;
+    }
+
+    std::wstring path;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if (it != chain.rbegin()) path += L'\\';
+        size_t length;
+        const wchar_t* name = String(nodes_[*it].name, length);
+        path.append(name, length);
+    }
+    return path;
+}
+
+ptrdiff_t TransferCatalog::Find(const std::wstring& relativePath) const {
+    if (!header_ || header_->recordCount == 0) return -1;
+
+    uint32_t mask = header_->indexSlots - 1;
+    uint32_t slot = static_cast<uint32_t>(HashPath(relativePath.data(), relativePath.size())) & mask;
+    for (uint32_t probe = 0; probe < header_->indexSlots; probe++) {
+        uint32_t entry = index_[slot];
+        if (entry == 0) return -1;
+        uint32_t record = entry - 1;
+        if (record < header_->recordCount && PathEquals(records_[record].node, relativePath))
+            return record;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void TransferCatalog::GetEntry(size_t index, TransferEntry& out) const {
+    const CatalogRecord& rec = records_[index];
+    out.relativePath = BuildPath(rec.node);
+    out.serialHex = GetSerial(index);
+    out.size = rec.size;
+    out.contentHash = rec.contentHash;
+    out.mtime = rec.mtime;
+}
+
+std::wstring TransferCatalog::GetSerial(size_t index) const {
+    size_t length;
+    const wchar_t* s = String(records_[index].serial, length);
+    return std::wstring(s, length);
+}
+
+// --- Writer ---
+
+template <typename T>
+static void AppendRaw(std::vector<char>& out, const T* data, size_t count) {
+    const char* p = reinterpret_cast<const char*>(data);
+    out.insert(out.end(), p, p + count * sizeof(T));
+}
+
+static uint64_t AlignTo8(std::vector<char>& out) {
+    out.resize((out.size() + 7) & ~size_t(7), 0);
+    return out.size();
+}
+
+bool TransferCatalog::Write(const std::wstring& path, const std::wstring& sourcePath,
+                            const std::vector<TransferEntry>& entries) {
+    // Intern every path component and serial into one string table
+    std::unordered_map<std::wstring, uint32_t> stringIds;
+    std::wstring blob;
+    std::vector<uint32_t> offsets{ 0 };
+    auto intern = [&](const wchar_t* s, size_t length) -> uint32_t {
+        auto [it, inserted] = stringIds.try_emplace(std::wstring(s, length),
+            static_cast<uint32_t>(offsets.size() - 1));
+        if (inserted) {
+            blob.append(s, length);
+            offsets.push_back(static_cast<uint32_t>(blob.size()));
+        }
+        return it->second;
+    };
+
+    uint32_t sourceString = intern(sourcePath.data(), sourcePath.size());
+
+    // One node per distinct (parent, name)
+    std::unordered_map<uint64_t, uint32_t> nodeIds;
+    std::vector<CatalogNode> nodes;
+    std::vector<CatalogRecord> records;
+    records.reserve(entries.size());
+    for (const auto& e : entries) {
+        uint32_t node = NO_NODE;
+        size_t start = 0;
+        for (;;) {
+            size_t sep = e.relativePath.find(L'\\', start);
+            size_t end = (sep == std::wstring::npos) ? e.relativePath.size() : sep;
+            uint32_t name = intern(e.relativePath.data() + start, end - start);
+            uint64_t key = (static_cast<uint64_t>(node) << 32) | name;
+            auto [it, inserted] = nodeIds.try_emplace(key, static_cast<uint32_t>(nodes.size()));
+            if (inserted) nodes.push_back({ node, name });
+            node = it->second;
+            if (sep == std::wstring::npos) break;
+            start = sep + 1;
+        }
+        records.push_back({ node, intern(e.serialHex.data(), e.serialHex.size()),
+            e.size, e.contentHash, e.mtime });
+    }
+
+    // Hash index at most half full so probes stay short
+    uint32_t slots = 16;
+    while (slots < records.size() * 2) slots <<= 1;
+    std::vector<uint32_t> index(slots, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const std::wstring& p = entries[i].relativePath;
+        uint32_t slot = static_cast<uint32_t>(HashPath(p.data(), p.size())) & (slots - 1);
+        while (index[slot] != 0) slot = (slot + 1) & (slots - 1);
+        index[slot] = static_cast<uint32_t>(i + 1);
+    }
+
+    CatalogHeader header = {};
+    memcpy(header.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    header.version = CATALOG_VERSION;
+    header.recordCount = static_cast<uint32_t>(records.size());
+    header.nodeCount = static_cast<uint32_t>(nodes.size());
+    header.stringCount = static_cast<uint32_t>(offsets.size() - 1);
+    header.indexSlots = slots;
+    header.sourceString = sourceString;
+
+    std::vector<char> out;
+    out.reserve(sizeof(header) + offsets.size() * 4 + blob.size() * 2 +
+        nodes.size() * sizeof(CatalogNode) + records.size() * sizeof(CatalogRecord) + slots * 4 + 64);
+    AppendRaw(out, &header, 1);
+    header.stringOffsetsPos = AlignTo8(out);
+    AppendRaw(out, offsets.data(), offsets.size());
+    header.stringBlobPos = AlignTo8(out);
+    AppendRaw(out, blob.data(), blob.size());
+    header.nodesPos = AlignTo8(out);
+    AppendRaw(out, nodes.data(), nodes.size());
+    header.recordsPos = AlignTo8(out);
+    AppendRaw(out, records.data(), records.size());
+    header.indexPos = AlignTo8(out);
+    AppendRaw(out, index.data(), index.size());
+    memcpy(out.data(), &header, sizeof(header));
+
+    // Write to a temp file, then swap it in
+    std::wstring tempPath = path + L".tmp";
+    HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    bool ok = true;
+    for (size_t pos = 0; ok && pos < out.size(); ) {
+        DWORD chunk = static_cast<DWORD>(out.size() - pos < (1u << 30) ? out.size() - pos : (1u << 30));
+        DWORD written = 0;
+        ok = WriteFile(hFile, out.data() + pos, chunk, &written, nullptr) && written == chunk;
+        pos += chunk;
+    }
+    ok = ok && FlushFileBuffers(hFile);
+    CloseHandle(hFile);
+
+    if (!ok || !MoveFileExW(tempPath.c_str(), path.c_str(),
+                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+
+struct TransferEntry;
+
+// Binary transfer catalog (DSplit_{hash}.catalog), memory-mapped and queried
+// in place. Layout, all little-endian:
+//   CatalogHeader
+//   string offsets: uint32[stringCount + 1], in UTF-16 units into the blob
+//   string blob:    UTF-16 path components, serials and the source path
+//   nodes:          CatalogNode[nodeCount], one per distinct directory or file
+//   records:        CatalogRecord[recordCount]
+//   index:          uint32[indexSlots], open-addressed by path hash, record + 1
+// Each path is stored once as a chain of (parent node, name) pairs, so deep
+// shared prefixes cost one node per directory rather than one copy per file.
+class TransferCatalog {
+public:
+    TransferCatalog() = default;
+
+    TransferCatalog(const TransferCatalog&) = delete;
+    TransferCatalog& operator=(const TransferCatalog&) = delete;
+
+    // Map a catalog file and validate its header. Nothing is deserialized.
+    bool Open(const std::wstring& path);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+
+    size_t GetCount() const;
+    std::wstring GetSourcePath() const;
+
+    // Look up a relative path. Returns the record index or -1.
+    ptrdiff_t Find(const std::wstring& relativePath) const;
+
+    // Materialize one record
+    void GetEntry(size_t index, TransferEntry& out) const;
+    std::wstring GetSerial(size_t index) const;
+
+    // Build a catalog from entries and write it to path (via a temp file
+    // renamed into place). The destination must not be mapped by anyone.
+    static bool Write(const std::wstring& path, const std::wstring& sourcePath,
+                      const std::vector<TransferEntry>& entries);
+
+    static const uint32_t NO_NODE = 0xFFFFFFFF;
+
+private:
+    struct CatalogHeader {
+        char magic[4];              // "DSCT"
+        uint32_t version;
+        uint32_t recordCount;
+        uint32_t nodeCount;
+        uint32_t stringCount;
+        uint32_t indexSlots;        // power of two
+        uint32_t sourceString;      // string id of the source path
+        uint32_t reserved;
+        uint64_t stringOffsetsPos;  // byte positions of each section
+        uint64_t stringBlobPos;
+        uint64_t nodesPos;
+        uint64_t recordsPos;
+        uint64_t indexPos;
+    };
+
+    struct CatalogNode {
+        uint32_t parent;            // NO_NODE for top-level names
+        uint32_t name;              // string id
+    };
+
+    struct CatalogRecord {
+        uint32_t node;              // the file's path node
+        uint32_t serial;            // string id of the destination serial
+        uint64_t size;
+        uint64_t contentHash;
+        uint64_t mtime;             // FILETIME of the copied file
+    };
+
+    const wchar_t* String(uint32_t id, size_t& length) const;
+    bool PathEquals(uint32_t node, const std::wstring& path) const;
+    std::wstring BuildPath(uint32_t node) const;
+
+    static uint64_t HashPath(const wchar_t* path, size_t length);
+
+    MappedFile file_;
+    const CatalogHeader* header_ = nullptr;
+    const uint32_t* stringOffsets_ = nullptr;
+    const wchar_t* stringBlob_ = nullptr;
+    const CatalogNode* nodes_ = nullptr;
+    const CatalogRecord* records_ = nullptr;
+    const uint32_t* index_ = nullptr;
+};
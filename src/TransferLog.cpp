@@ -1,10 +1,29 @@
 #include "TransferLog.h"
+#include "ContentHash.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+#include "TransferCatalog.h"
 #include "Utils.h"
 #include <string>
 #include <vector>
+#include <cstring>
+
+// Journal layout: JOURNAL_MAGIC, then records of
+//   uint32 payloadBytes | uint64 XXH64(payload) | payload
+// where payload = uint64 size | uint64 contentHash | uint64 mtime |
+//   uint16 serialChars | uint16 pathChars | serial (UTF-16) | path (UTF-16)
+// Version 1 journals have no mtime field; they are still replayed.
+static const char JOURNAL_MAGIC[4] = { 'D', 'S', 'J', '2' };
+static const char JOURNAL_MAGIC_V1[4] = { 'D', 'S', 'J', '1' };
+static const size_t RECORD_HEADER_BYTES = sizeof(uint32_t) + sizeof(uint64_t);
+static const size_t PAYLOAD_FIXED_BYTES = 3 * sizeof(uint64_t) + 2 * sizeof(uint16_t);
+static const size_t PAYLOAD_FIXED_BYTES_V1 = 2 * sizeof(uint64_t) + 2 * sizeof(uint16_t);
 
 TransferLog::TransferLog() {}
-TransferLog::~TransferLog() {}
+
+TransferLog::~TransferLog() {
+    CloseJournal();
+}
 
 std::wstring TransferLog::FormatSerial(DWORD serial) {
     wchar_t buf[16];
@@ -33,179 +52,111 @@ std::wstring TransferLog::GetLogPath(const std::wstring& exeDir, const std::wstr
     return Utils::CombinePaths(logsDir, L"DSplit_" + HashSourcePath(sourcePath) + L".json");
 }
 
-// --- Simple JSON helpers for fixed schema ---
-
-static void SkipWS(const std::wstring& s, size_t& pos) {
-    while (pos < s.size() && (s[pos] == L' ' || s[pos] == L'\t' ||
-           s[pos] == L'\r' || s[pos] == L'\n'))
-        pos++;
-}
-
-static bool Expect(const std::wstring& s, size_t& pos, wchar_t ch) {
-    SkipWS(s, pos);
-    if (pos < s.size() && s[pos] == ch) { pos++; return true; }
-    return false;
+// Swap the extension of logPath for ext
+static std::wstring ReplaceExtension(const std::wstring& logPath, const wchar_t* ext) {
+    size_t dot = logPath.find_last_of(L'.');
+    size_t sep = logPath.find_last_of(L"\\/");
+    if (dot == std::wstring::npos || (sep != std::wstring::npos && dot < sep))
+        return logPath + ext;
+    return logPath.substr(0, dot) + ext;
 }
 
-static std::wstring ParseString(const std::wstring& s, size_t& pos) {
-    SkipWS(s, pos);
-    if (pos >= s.size() || s[pos] != L'"') return L"";
-    pos++; // skip opening quote
-    std::wstring result;
-    while (pos < s.size() && s[pos] != L'"') {
-        if (s[pos] == L'\\' && pos + 1 < s.size()) {
-            pos++;
-            switch (s[pos]) {
-            case L'"':  result += L'"'; break;
-            case L'\\': result += L'\\'; break;
-            case L'/':  result += L'/'; break;
-            case L'n':  result += L'\n'; break;
-            case L't':  result += L'\t'; break;
-            case L'r':  result += L'\r'; break;
-            default:    result += s[pos]; break;
-            }
-        } else {
-            result += s[pos];
-        }
-        pos++;
-    }
-    if (pos < s.size()) pos++; // skip closing quote
-    return result;
+std::wstring TransferLog::GetJournalPath(const std::wstring& logPath) {
+    return ReplaceExtension(logPath, L".journal");
 }
 
-static uint64_t ParseNumber(const std::wstring& s, size_t& pos) {
-    SkipWS(s, pos);
-    uint64_t val = 0;
-    while (pos < s.size() && s[pos] >= L'0' && s[pos] <= L'9') {
-        val = val * 10 + (s[pos] - L'0');
-        pos++;
-    }
-    return val;
+std::wstring TransferLog::GetCatalogPath(const std::wstring& logPath) {
+    return ReplaceExtension(logPath, L".catalog");
 }
 
-// Skip a JSON value (string, number, object, array)
-static void SkipValue(const std::wstring& s, size_t& pos) {
-    SkipWS(s, pos);
-    if (pos >= s.size()) return;
-    if (s[pos] == L'"') {
-        ParseString(s, pos);
-    } else if (s[pos] == L'{') {
-        int depth = 1; pos++;
-        while (pos < s.size() && depth > 0) {
-            if (s[pos] == L'{') depth++;
-            else if (s[pos] == L'}') depth--;
-            else if (s[pos] == L'"') { ParseString(s, pos); continue; }
-            pos++;
-        }
-    } else if (s[pos] == L'[') {
-        int depth = 1; pos++;
-        while (pos < s.size() && depth > 0) {
-            if (s[pos] == L'[') depth++;
-            else if (s[pos] == L']') depth--;
-            else if (s[pos] == L'"') { ParseString(s, pos); continue; }
-            pos++;
-        }
-    } else {
-        // number, true, false, null
-        while (pos < s.size() && s[pos] != L',' && s[pos] != L'}' && s[pos] != L']'
-               && s[pos] != L' ' && s[pos] != L'\t' && s[pos] != L'\r' && s[pos] != L'\n')
-            pos++;
-    }
+std::wstring TransferLog::GetScanPath(const std::wstring& logPath) {
+    return ReplaceExtension(logPath, L".scan");
 }
 
 bool TransferLog::Load(const std::wstring& logPath) {
     Clear();
-
-    HANDLE hFile = CreateFileW(logPath.c_str(), GENERIC_READ, FILE_SHARE_READ,
-        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (hFile == INVALID_HANDLE_VALUE) return false;
-
-    DWORD fileSize = GetFileSize(hFile, nullptr);
-    if (fileSize == 0 || fileSize == INVALID_FILE_SIZE) {
-        CloseHandle(hFile);
-        return false;
-    }
-
-    std::vector<char> buf(fileSize);
-    DWORD bytesRead;
-    if (!ReadFile(hFile, buf.data(), fileSize, &bytesRead, nullptr)) {
-        CloseHandle(hFile);
-        return false;
-    }
-    CloseHandle(hFile);
-
-    // Skip UTF-8 BOM if present
-    size_t start = 0;
-    if (bytesRead >= 3 &&
-        (unsigned char)buf[0] == 0xEF &&
-        (unsigned char)buf[1] == 0xBB &&
-        (unsigned char)buf[2] == 0xBF) {
-        start = 3;
+    bool haveSnapshot;
+    if (catalog_.Open(GetCatalogPath(logPath))) {
+        sourcePath_ = catalog_.GetSourcePath();
+        haveSnapshot = true;
+    } else {
+        haveSnapshot = ImportJson(logPath);
     }
+    size_t replayed = ReplayJournal(GetJournalPath(logPath));
+    return haveSnapshot || replayed > 0;
+}
 
-    // Convert UTF-8 to wide string
-    int wideLen = MultiByteToWideChar(CP_UTF8, 0, buf.data() + start,
-        (int)(bytesRead - start), nullptr, 0);
-    if (wideLen <= 0) return false;
+bool TransferLog::ImportJson(const std::wstring& jsonPath) {
+    // Parse straight out of the mapped UTF-8 file: no read buffer, no
+    // whole-file wide copy
+    MappedFile file;
+    if (!file.Open(jsonPath)) return false;
 
-    std::wstring content(wideLen, L'\0');
-    MultiByteToWideChar(CP_UTF8, 0, buf.data() + start,
-        (int)(bytesRead - start), &content[0], wideLen);
+    // Entries run about 80-100 bytes each; reserving up front avoids
+    // rehashing the index while a big log loads
+    size_t estimate = file.Size() / 80;
+    entries_.reserve(entries_.size() + estimate);
+    index_.reserve(index_.size() + estimate);
 
     // Parse JSON: { "source": "...", "transfers": [ {...}, ... ] }
-    size_t pos = 0;
-    if (!Expect(content, pos, L'{')) return false;
+    JsonReader json(file.Data(), file.Size());
+    if (!json.Expect('{')) return false;
 
-    while (pos < content.size()) {
-        SkipWS(content, pos);
-        if (pos < content.size() && content[pos] == L'}') break;
+    std::wstring scratch;
+    while (!json.AtEnd()) {
+        if (json.Peek('}')) break;
 
         // Skip comma between keys
-        if (pos < content.size() && content[pos] == L',') pos++;
+        json.Expect(',');
 
-        std::wstring key = ParseString(content, pos);
-        if (!Expect(content, pos, L':')) break;
+        const char* key;
+        size_t keyLen;
+        if (!json.ParseKey(key, keyLen) || !json.Expect(':')) break;
 
-        if (key == L"source") {
-            sourcePath_ = ParseString(content, pos);
-        } else if (key == L"transfers") {
-            if (!Expect(content, pos, L'[')) break;
+        if (JsonReader::KeyIs(key, keyLen, "source")) {
+            json.ParseString(sourcePath_);
+        } else if (JsonReader::KeyIs(key, keyLen, "transfers")) {
+            if (!json.Expect('[')) break;
 
-            while (pos < content.size()) {
-                SkipWS(content, pos);
-                if (pos < content.size() && content[pos] == L']') { pos++; break; }
-                if (pos < content.size() && content[pos] == L',') pos++;
+            while (!json.AtEnd()) {
+                if (json.Expect(']')) break;
+                json.Expect(',');
 
                 // Parse transfer object
-                if (!Expect(content, pos, L'{')) break;
+                if (!json.Expect('{')) break;
 
                 TransferEntry entry;
-                while (pos < content.size()) {
-                    SkipWS(content, pos);
-                    if (pos < content.size() && content[pos] == L'}') { pos++; break; }
-                    if (pos < content.size() && content[pos] == L',') pos++;
-
-                    std::wstring field = ParseString(content, pos);
-                    if (!Expect(content, pos, L':')) break;
-
-                    if (field == L"path") {
-                        entry.relativePath = ParseString(content, pos);
-                    } else if (field == L"serial") {
-                        entry.serialHex = ParseString(content, pos);
-                    } else if (field == L"size") {
-                        entry.size = ParseNumber(content, pos);
+                entry.size = 0;
+                while (!json.AtEnd()) {
+                    if (json.Expect('}')) break;
+                    json.Expect(',');
+
+                    const char* field;
+                    size_t fieldLen;
+                    if (!json.ParseKey(field, fieldLen) || !json.Expect(':')) break;
+
+                    if (JsonReader::KeyIs(field, fieldLen, "path")) {
+                        json.ParseString(entry.relativePath);
+                    } else if (JsonReader::KeyIs(field, fieldLen, "serial")) {
+                        json.ParseString(entry.serialHex);
+                    } else if (JsonReader::KeyIs(field, fieldLen, "size")) {
+                        entry.size = json.ParseNumber();
+                    } else if (JsonReader::KeyIs(field, fieldLen, "xxh64")) {
+                        json.ParseString(scratch);
+                        ContentHash::Parse(scratch, entry.contentHash);
+                    } else if (JsonReader::KeyIs(field, fieldLen, "mtime")) {
+                        entry.mtime = json.ParseNumber();
                     } else {
-                        SkipValue(content, pos);
+                        json.SkipValue();
                     }
                 }
 
                 if (!entry.relativePath.empty()) {
-                    pathMap_[entry.relativePath] = entry.serialHex;
-                    entries_.push_back(std::move(entry));
+                    ApplyEntry(entry);
                 }
             }
         } else {
-            SkipValue(content, pos);
+            json.SkipValue();
         }
     }
 
@@ -225,16 +176,24 @@ bool TransferLog::Save(const std::wstring& logPath) const {
     json += L"  \"source\": \"" + Utils::JsonEscape(sourcePath_) + L"\",\n";
     json += L"  \"transfers\": [\n";
 
-    for (size_t i = 0; i < entries_.size(); i++) {
-        const auto& e = entries_[i];
+    std::vector<TransferEntry> entries = CollectEntries();
+    for (size_t i = 0; i < entries.size(); i++) {
+        const auto& e = entries[i];
         json += L"    {\"path\": \"" + Utils::JsonEscape(e.relativePath) +
                 L"\", \"serial\": \"" + e.serialHex +
                 L"\", \"size\": ";
         wchar_t sizeBuf[32];
         swprintf_s(sizeBuf, L"%llu", e.size);
         json += sizeBuf;
+        if (e.contentHash != 0) {
+            json += L", \"xxh64\": \"" + ContentHash::Format(e.contentHash) + L"\"";
+        }
+        if (e.mtime != 0) {
+            swprintf_s(sizeBuf, L", \"mtime\": %llu", e.mtime);
+            json += sizeBuf;
+        }
         json += L"}";
-        if (i + 1 < entries_.size()) json += L",";
+        if (i + 1 < entries.size()) json += L",";
         json += L"\n";
     }
 
@@ -250,48 +209,313 @@ bool TransferLog::Save(const std::wstring& logPath) const {
     WideCharToMultiByte(CP_UTF8, 0, json.c_str(), (int)json.size(),
         &utf8[0], needed, nullptr, nullptr);
 
-    // Write file
-    HANDLE hFile = CreateFileW(logPath.c_str(), GENERIC_WRITE, 0, nullptr,
+    // Write to a temp file, then swap it in
+    std::wstring tempPath = logPath + L".tmp";
+    HANDLE hFile = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
         CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
     if (hFile == INVALID_HANDLE_VALUE) return false;
 
     // Write UTF-8 BOM
     const unsigned char bom[] = { 0xEF, 0xBB, 0xBF };
     DWORD written;
-    WriteFile(hFile, bom, 3, &written, nullptr);
+    bool ok = WriteFile(hFile, bom, 3, &written, nullptr) &&
+              WriteFile(hFile, utf8.c_str(), (DWORD)utf8.size(), &written, nullptr) &&
+              written == utf8.size() &&
+              FlushFileBuffers(hFile);
+    CloseHandle(hFile);
+
+    if (!ok || !MoveFileExW(tempPath.c_str(), logPath.c_str(),
+                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// --- Journal ---
+
+// Walk the records in a journal image. Returns the length of the valid
+// prefix; parsing stops at the first truncated or corrupt record. Entries
+// are appended to out if given.
+static size_t ParseJournal(const char* data, size_t size, std::vector<TransferEntry>* out) {
+    if (size < sizeof(JOURNAL_MAGIC)) return 0;
+    bool v1 = memcmp(data, JOURNAL_MAGIC_V1, sizeof(JOURNAL_MAGIC_V1)) == 0;
+    if (!v1 && memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) return 0;
+    size_t fixedBytes = v1 ? PAYLOAD_FIXED_BYTES_V1 : PAYLOAD_FIXED_BYTES;
+
+    size_t pos = sizeof(JOURNAL_MAGIC);
+    while (size - pos >= RECORD_HEADER_BYTES) {
+        uint32_t payloadBytes;
+        uint64_t checksum;
+        memcpy(&payloadBytes, data + pos, sizeof(payloadBytes));
+        memcpy(&checksum, data + pos + sizeof(payloadBytes), sizeof(checksum));
+        const char* payload = data + pos + RECORD_HEADER_BYTES;
+
+        if (payloadBytes < fixedBytes || payloadBytes > size - pos - RECORD_HEADER_BYTES)
+            break;
+        if (ContentHash::Compute(payload, payloadBytes) != checksum)
+            break;
+
+        TransferEntry entry;
+        uint16_t serialChars, pathChars;
+        const char* field = payload;
+        memcpy(&entry.size, field, sizeof(uint64_t));
+        memcpy(&entry.contentHash, field + 8, sizeof(uint64_t));
+        field += 16;
+        if (!v1) {
+            memcpy(&entry.mtime, field, sizeof(uint64_t));
+            field += 8;
+        }
+        memcpy(&serialChars, field, sizeof(uint16_t));
+        memcpy(&pathChars, field + 2, sizeof(uint16_t));
+        if (fixedBytes + (serialChars + pathChars) * sizeof(wchar_t) != payloadBytes)
+            break;
+
+        if (out) {
+            const char* text = payload + fixedBytes;
+            entry.serialHex.assign(reinterpret_cast<const wchar_t*>(text), serialChars);
+            entry.relativePath.assign(reinterpret_cast<const wchar_t*>(text + serialChars * sizeof(wchar_t)),
+                pathChars);
+            out->push_back(std::move(entry));
+        }
+        pos += RECORD_HEADER_BYTES + payloadBytes;
+    }
+    return pos;
+}
 
-    WriteFile(hFile, utf8.c_str(), (DWORD)utf8.size(), &written, nullptr);
+static bool ReadWholeFile(HANDLE hFile, std::vector<char>& buf) {
+    LARGE_INTEGER liSize;
+    if (!GetFileSizeEx(hFile, &liSize) || liSize.QuadPart > 0x7FFFFFFF) return false;
+    buf.resize(static_cast<size_t>(liSize.QuadPart));
+    DWORD bytesRead = 0;
+    if (!buf.empty() && !ReadFile(hFile, buf.data(), (DWORD)buf.size(), &bytesRead, nullptr))
+        return false;
+    buf.resize(bytesRead);
+    return true;
+}
+
+size_t TransferLog::ReplayJournal(const std::wstring& journalPath) {
+    HANDLE hFile = CreateFileW(journalPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return 0;
+
+    std::vector<char> buf;
+    bool ok = ReadWholeFile(hFile, buf);
     CloseHandle(hFile);
+    if (!ok) return 0;
+
+    std::vector<TransferEntry> records;
+    ParseJournal(buf.data(), buf.size(), &records);
+    for (const auto& entry : records) {
+        ApplyEntry(entry);
+    }
+    return records.size();
+}
+
+bool TransferLog::OpenJournal(const std::wstring& logPath) {
+    CloseJournal();
+
+    size_t sep = logPath.find_last_of(L"\\/");
+    if (sep != std::wstring::npos) {
+        Utils::EnsureDirectoryExists(logPath.substr(0, sep));
+    }
+
+    std::wstring journalPath = GetJournalPath(logPath);
+    HANDLE hFile = CreateFileW(journalPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    // Keep only the valid prefix so new records aren't appended after garbage
+    std::vector<char> buf;
+    if (!ReadWholeFile(hFile, buf)) {
+        CloseHandle(hFile);
+        return false;
+    }
+    std::vector<TransferEntry> records;
+    size_t validBytes = ParseJournal(buf.data(), buf.size(), &records);
+
+    // A version 1 journal is rewritten in the current format below, since
+    // new records can't be appended to it
+    bool upgrade = validBytes > 0 &&
+        memcmp(buf.data(), JOURNAL_MAGIC_V1, sizeof(JOURNAL_MAGIC_V1)) == 0;
+    if (upgrade) validBytes = 0;
+
+    LARGE_INTEGER liPos;
+    liPos.QuadPart = static_cast<LONGLONG>(validBytes);
+    bool ok = SetFilePointerEx(hFile, liPos, nullptr, FILE_BEGIN) && SetEndOfFile(hFile);
+    if (ok && validBytes == 0) {
+        DWORD written;
+        ok = WriteFile(hFile, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC), &written, nullptr) &&
+             written == sizeof(JOURNAL_MAGIC);
+    }
+    if (!ok) {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    hJournal_ = hFile;
+    journalRecords_ = upgrade ? 0 : records.size();
+    for (size_t i = 0; upgrade && i < records.size(); i++) {
+        if (!AppendRecord(records[i])) {
+            CloseJournal();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TransferLog::CloseJournal() {
+    if (hJournal_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(hJournal_);
+        hJournal_ = INVALID_HANDLE_VALUE;
+    }
+}
+
+void TransferLog::FlushJournal() {
+    if (hJournal_ != INVALID_HANDLE_VALUE) {
+        FlushFileBuffers(hJournal_);
+    }
+}
+
+bool TransferLog::AppendRecord(const TransferEntry& entry) {
+    uint16_t serialChars = static_cast<uint16_t>(entry.serialHex.size());
+    uint16_t pathChars = static_cast<uint16_t>(entry.relativePath.size());
+    uint32_t payloadBytes = static_cast<uint32_t>(
+        PAYLOAD_FIXED_BYTES + (serialChars + pathChars) * sizeof(wchar_t));
+
+    // Build the whole frame so it goes out in a single write
+    std::vector<char> frame(RECORD_HEADER_BYTES + payloadBytes);
+    char* payload = frame.data() + RECORD_HEADER_BYTES;
+    memcpy(payload, &entry.size, sizeof(uint64_t));
+    memcpy(payload + 8, &entry.contentHash, sizeof(uint64_t));
+    memcpy(payload + 16, &entry.mtime, sizeof(uint64_t));
+    memcpy(payload + 24, &serialChars, sizeof(uint16_t));
+    memcpy(payload + 26, &pathChars, sizeof(uint16_t));
+    memcpy(payload + PAYLOAD_FIXED_BYTES, entry.serialHex.data(), serialChars * sizeof(wchar_t));
+    memcpy(payload + PAYLOAD_FIXED_BYTES + serialChars * sizeof(wchar_t),
+        entry.relativePath.data(), pathChars * sizeof(wchar_t));
+
+    uint64_t checksum = ContentHash::Compute(payload, payloadBytes);
+    memcpy(frame.data(), &payloadBytes, sizeof(payloadBytes));
+    memcpy(frame.data() + sizeof(payloadBytes), &checksum, sizeof(checksum));
+
+    DWORD written;
+    if (!WriteFile(hJournal_, frame.data(), (DWORD)frame.size(), &written, nullptr) ||
+        written != frame.size()) {
+        return false;
+    }
+    journalRecords_++;
     return true;
 }
 
+bool TransferLog::Compact(const std::wstring& logPath) {
+    // Windows won't replace a file while a view of it is mapped, so build the
+    // new catalog from a copy and release the old mapping before the swap
+    std::wstring catalogPath = GetCatalogPath(logPath);
+    std::vector<TransferEntry> all = CollectEntries();
+    catalog_.Close();
+
+    size_t sep = logPath.find_last_of(L"\\/");
+    if (sep != std::wstring::npos) {
+        Utils::EnsureDirectoryExists(logPath.substr(0, sep));
+    }
+    bool written = TransferCatalog::Write(catalogPath, sourcePath_, all);
+    bool reopened = catalog_.Open(catalogPath);
+    if (!written || !reopened) {
+        // The journal is left alone. If the old catalog is back, the overlay
+        // still sits on top of it; otherwise the overlay takes everything.
+        if (!reopened) {
+            ClearOverlay();
+            for (const auto& e : all) ApplyEntry(e);
+        }
+        return false;
+    }
+
+    ClearOverlay();
+
+    // The catalog now holds everything; a crash before the truncate only
+    // means the same records get replayed onto it again, which is harmless
+    if (hJournal_ != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER liPos;
+        liPos.QuadPart = sizeof(JOURNAL_MAGIC);
+        SetFilePointerEx(hJournal_, liPos, nullptr, FILE_BEGIN);
+        SetEndOfFile(hJournal_);
+    } else {
+        DeleteFileW(GetJournalPath(logPath).c_str());
+    }
+    journalRecords_ = 0;
+    return true;
+}
+
+std::vector<TransferEntry> TransferLog::CollectEntries() const {
+    std::vector<TransferEntry> all;
+    all.reserve(GetEntryCount());
+
+    TransferEntry entry;
+    for (size_t i = 0; i < catalog_.GetCount(); i++) {
+        catalog_.GetEntry(i, entry);
+        if (!FindOverlay(entry.relativePath)) all.push_back(std::move(entry));
+    }
+    for (const auto& e : entries_) {
+        all.push_back({ paths_.GetPath(e.path), e.serialHex, e.size, e.contentHash, e.mtime });
+    }
+    return all;
+}
+
+const TransferLog::OverlayEntry* TransferLog::FindOverlay(const std::wstring& relativePath) const {
+    if (entries_.empty()) return nullptr;
+    PathId path = paths_.Find(relativePath);
+    if (path == NO_PATH) return nullptr;
+    auto it = index_.find(path);
+    return (it != index_.end()) ? &entries_[it->second] : nullptr;
+}
+
 bool TransferLog::Contains(const std::wstring& relativePath) const {
-    return pathMap_.count(relativePath) > 0;
+    return FindOverlay(relativePath) || catalog_.Find(relativePath) >= 0;
 }
 
 std::wstring TransferLog::GetSerial(const std::wstring& relativePath) const {
-    auto it = pathMap_.find(relativePath);
-    return (it != pathMap_.end()) ? it->second : L"";
+    if (const OverlayEntry* e = FindOverlay(relativePath)) return e->serialHex;
+    ptrdiff_t record = catalog_.Find(relativePath);
+    return record >= 0 ? catalog_.GetSerial(record) : L"";
 }
 
-void TransferLog::AddEntry(const std::wstring& relativePath, const std::wstring& serialHex, uint64_t size) {
-    // Update map (overwrite if duplicate path)
-    pathMap_[relativePath] = serialHex;
+void TransferLog::AddEntry(const std::wstring& relativePath, const std::wstring& serialHex, uint64_t size,
+                           uint64_t contentHash, uint64_t mtime) {
+    TransferEntry entry{ relativePath, serialHex, size, contentHash, mtime };
+    ApplyEntry(entry);
+    if (hJournal_ != INVALID_HANDLE_VALUE) {
+        AppendRecord(entry);
+    }
+}
 
-    // Check if entry already exists (update it)
-    for (auto& e : entries_) {
-        if (e.relativePath == relativePath) {
-            e.serialHex = serialHex;
-            e.size = size;
-            return;
-        }
+void TransferLog::ApplyEntry(const TransferEntry& entry) {
+    // One hash lookup either finds the existing entry (update it) or
+    // reserves the slot the new entry is about to take
+    PathId path = paths_.Intern(entry.relativePath);
+    auto [it, inserted] = index_.try_emplace(path, entries_.size());
+    if (!inserted) {
+        OverlayEntry& e = entries_[it->second];
+        e.serialHex = entry.serialHex;
+        e.size = entry.size;
+        e.contentHash = entry.contentHash;
+        e.mtime = entry.mtime;
+        return;
     }
 
-    entries_.push_back({ relativePath, serialHex, size });
+    if (catalog_.Find(entry.relativePath) < 0) overlayNew_++;
+    entries_.push_back({ path, entry.serialHex, entry.size, entry.contentHash, entry.mtime });
+}
+
+void TransferLog::ClearOverlay() {
+    entries_.clear();
+    index_.clear();
+    paths_.Clear();
+    overlayNew_ = 0;
 }
 
 void TransferLog::Clear() {
     sourcePath_.clear();
-    entries_.clear();
-    pathMap_.clear();
+    catalog_.Close();
+    ClearOverlay();
 }
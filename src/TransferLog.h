@@ -4,38 +4,82 @@
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
+#include "TransferCatalog.h"
+#include "PathStore.h"
 
 struct TransferEntry {
     std::wstring relativePath;
     std::wstring serialHex;  // destination drive serial
     uint64_t size;
+    uint64_t contentHash = 0;    // XXH64 of the file as copied (0 = not recorded)
+    uint64_t mtime = 0;          // last-write FILETIME of the copy (0 = not recorded)
 };
 
+// Transfer log for one source folder, kept as three files in the logs folder:
+//   DSplit_{hash}.catalog  binary snapshot, memory-mapped and queried in place
+//   DSplit_{hash}.journal  append-only records of transfers since the snapshot
+//   DSplit_{hash}.json     JSON export for other tools; imported when there is
+//                          no catalog yet (logs from older versions)
+// Entries from the journal and new AddEntry calls live in an in-memory
+// overlay on top of the catalog. While the journal is open, each AddEntry
+// appends one framed, checksummed record, so recording a transfer costs O(1)
+// bytes; Compact folds the overlay into a new catalog. Every path argument
+// named logPath is the .json path; the other two sit beside it.
 class TransferLog {
 public:
     TransferLog();
     ~TransferLog();
 
-    // Load JSON log from file. Returns true if file existed and parsed.
+    TransferLog(const TransferLog&) = delete;
+    TransferLog& operator=(const TransferLog&) = delete;
+
+    // Map the catalog (or import the JSON log if there is no catalog), then
+    // replay the journal on top of it. A torn or corrupt record ends the
+    // replay. Returns true if any of the files had data.
     bool Load(const std::wstring& logPath);
 
-    // Save all entries to JSON file via CreateFileW/WriteFile.
+    // Export all entries as JSON. Written to a temp file and then renamed
+    // over the old file, so a crash never leaves a partial file.
     bool Save(const std::wstring& logPath) const;
 
+    // Merge the entries of a JSON log into the overlay
+    bool ImportJson(const std::wstring& jsonPath);
+
+    // Open (creating if needed) the journal for logPath for appending. A torn
+    // record at its end from an earlier crash is cut off first.
+    bool OpenJournal(const std::wstring& logPath);
+    void CloseJournal();
+    bool IsJournalOpen() const { return hJournal_ != INVALID_HANDLE_VALUE; }
+
+    // Push appended records to the disk
+    void FlushJournal();
+
+    // Records appended to the journal since the last compaction
+    size_t GetJournalRecords() const { return journalRecords_; }
+
+    // Write a new catalog holding every entry, then empty the journal. Fails
+    // (keeping the journal) if another TransferLog has the catalog mapped.
+    bool Compact(const std::wstring& logPath);
+
     // Check if a relative path has been transferred
     bool Contains(const std::wstring& relativePath) const;
 
     // Get the destination serial for a transferred path (empty if not found)
     std::wstring GetSerial(const std::wstring& relativePath) const;
 
-    // Add a new transfer entry
-    void AddEntry(const std::wstring& relativePath, const std::wstring& serialHex, uint64_t size);
+    // Add a new transfer entry (and journal it if the journal is open)
+    void AddEntry(const std::wstring& relativePath, const std::wstring& serialHex, uint64_t size,
+                  uint64_t contentHash = 0, uint64_t mtime = 0);
 
-    // Get all entries
-    const std::vector<TransferEntry>& GetEntries() const { return entries_; }
+    // Number of distinct transferred paths
+    size_t GetEntryCount() const { return catalog_.GetCount() + overlayNew_; }
 
-    // Get the path->serial map
-    const std::unordered_map<std::wstring, std::wstring>& GetPathMap() const { return pathMap_; }
+    // Number of entries in the catalog, not counting the journal's
+    size_t GetCatalogCount() const { return catalog_.GetCount(); }
+
+    // Materialize every entry (catalog entries superseded by the overlay
+    // are replaced by their newer version)
+    std::vector<TransferEntry> CollectEntries() const;
 
     // Get/set source path stored in the log
     const std::wstring& GetSourcePath() const { return sourcePath_; }
@@ -53,8 +97,34 @@ public:
     // Build the log file path for a given source folder under exeDir
     static std::wstring GetLogPath(const std::wstring& exeDir, const std::wstring& sourcePath);
 
+    // Journal, catalog and scan snapshot paths that go with a log path
+    static std::wstring GetJournalPath(const std::wstring& logPath);
+    static std::wstring GetCatalogPath(const std::wstring& logPath);
+    static std::wstring GetScanPath(const std::wstring& logPath);
+
 private:
+    size_t ReplayJournal(const std::wstring& journalPath);
+    void ApplyEntry(const TransferEntry& entry);
+    bool AppendRecord(const TransferEntry& entry);
+
+    // Overlay entry; the path lives in paths_
+    struct OverlayEntry {
+        PathId path;
+        std::wstring serialHex;
+        uint64_t size;
+        uint64_t contentHash;
+        uint64_t mtime;
+    };
+
+    const OverlayEntry* FindOverlay(const std::wstring& relativePath) const;
+    void ClearOverlay();
+
+    HANDLE hJournal_ = INVALID_HANDLE_VALUE;
+    size_t journalRecords_ = 0;
     std::wstring sourcePath_;
-    std::vector<TransferEntry> entries_;
-    std::unordered_map<std::wstring, std::wstring> pathMap_; // relativePath -> serialHex
+    TransferCatalog catalog_;
+    PathStore paths_;                               // overlay paths
+    std::vector<OverlayEntry> entries_;             // overlay
+    std::unordered_map<PathId, size_t> index_;      // path -> index into entries_
+    size_t overlayNew_ = 0;                         // overlay entries not in the catalog
 };
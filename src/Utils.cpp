@@ -45,6 +45,23 @@ std::wstring FormatSizeShort(uint64_t bytes) {
     return buf;
 }
 
+std::wstring FormatDuration(double seconds) {
+    uint64_t total = seconds > 0 ? static_cast<uint64_t>(seconds + 0.5) : 0;
+    uint64_t hours = total / 3600;
+    uint64_t mins = (total / 60) % 60;
+    uint64_t secs = total % 60;
+
+    wchar_t buf[32];
+    if (hours > 0) {
+        swprintf_s(buf, L"%llu:%02llu:%02llu", hours, mins, secs);
+    } else if (mins > 0) {
+        swprintf_s(buf, L"%llu:%02llu", mins, secs);
+    } else {
+        swprintf_s(buf, L"%llus", secs);
+    }
+    return buf;
+}
+
 std::wstring CombinePaths(const std::wstring& base, const std::wstring& relative) {
     if (base.empty()) return relative;
     if (relative.empty()) return base;
@@ -11,6 +11,9 @@ std::wstring FormatSize(uint64_t bytes);
 // Format a byte count as a short string without decimals for small values
 std::wstring FormatSizeShort(uint64_t bytes);
 
+// Format a duration as "45s", "12:05" or "1:02:05"
+std::wstring FormatDuration(double seconds);
+
 // Combine a base path and a relative path with backslash separator
 std::wstring CombinePaths(const std::wstring& base, const std::wstring& relative);
 
@@ -2,6 +2,7 @@
 #include <objbase.h>
 #include <commctrl.h>
 #include "MainWindow.h"
+#include "BufferPool.h"
 
 #pragma comment(lib, "comctl32.lib")
 
@@ -15,6 +16,10 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
     // Initialize COM for IFileDialog
     CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 
+    // Copy buffers on large pages where the account may lock memory pages;
+    // must happen before the first buffer is checked out
+    BufferPool::Instance().EnableLargePages();
+
     if (!MainWindow::Register(hInstance)) {
         MessageBoxW(nullptr, L"Failed to register window class.", L"DSplit", MB_OK | MB_ICONERROR);
         return 1;